@@ -0,0 +1,309 @@
+// batch analysis of positions from a file, for reviewing games offline
+//
+// input, one position per line, '#' starts a comment
+//   <piece> <next> <hold> <row masks>
+// output, one line per position in input order
+//   <line> <rotation>:<x> <score> ...      best placement first, then up to --top alternatives
+//   <line> error <message>
+//
+// pieces are letters of OLJITSZ or their numbers 0 to 6, '-' when there is no next or hold piece. row masks are
+// <height> hex numbers as in the bot server's state line: top row first, bit 0 = leftmost column. placements are those
+// of the bot server's place command. the engine has no hold key, so hold is shown on the board but not searched
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "bot.h"
+#include "thread_pool.h"
+#include "analysis.h"
+
+static void parse_position(analysis_slot_t* slot, char* text, int width, int height);
+static bool parse_piece(const char* token, bool b_optional, int* piece);
+static void analyze_position(void* ctx, int index);
+static int compare_candidate(const void* a, const void* b);
+static void print_position(const analysis_slot_t* slot, int top_count);
+static void free_analysis_slots(analysis_slot_t slots[], int count);
+
+// --------------------------------------------------
+// analysis functions
+// --------------------------------------------------
+
+// positions are read in batches and analyzed on the pool, a finished batch is printed in input order.
+// path "-" reads stdin
+int run_analysis(const char* path, int top_count, int thread_count, int width, int height) {
+    thread_pool_t pool;
+    char* text = NULL;
+    size_t text_size = 0;
+    int line = 0;
+    long position_count = 0;
+    long error_count = 0;
+    struct timespec begin;
+    struct timespec end;
+
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if(file == NULL) {
+        perror(path);
+        return 1;
+    }
+    if(!init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        if(file != stdin) {
+            fclose(file);
+        }
+        return 1;
+    }
+    // pool 이 고친 thread 수로 batch 크기를 정함
+    const int batch_size = pool.thread_count * ANALYSIS_POSITIONS_PER_THREAD;
+    analysis_slot_t* slots = calloc(batch_size, sizeof(analysis_slot_t));
+    if(slots == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        if(file != stdin) {
+            fclose(file);
+        }
+        return 1;
+    }
+    for(int i = 0; i < batch_size; ++i) {
+        analysis_slot_t* slot = &slots[i];
+        slot->masks = malloc(sizeof(uint64_t) * height);
+        const bool b_boards = create_board(&slot->board, width, height) && create_board(&slot->after, width, height)
+            && create_board(&slot->next_board, width, height) && create_board(&slot->scratch, width, height);
+        if(slot->masks == NULL || !b_boards) {
+            fprintf(stderr, "tetris: out of memory\n");
+            free_analysis_slots(slots, batch_size);
+            free_thread_pool(&pool);
+            if(file != stdin) {
+                fclose(file);
+            }
+            return 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    bool b_more = true;
+    while(b_more) {
+        int count = 0;
+        while(count < batch_size) {
+            if(getline(&text, &text_size, file) < 0) {
+                b_more = false;
+                break;
+            }
+            ++line;
+
+            char* comment = strchr(text, '#');
+            if(comment != NULL) {
+                *comment = '\0';
+            }
+            if(strspn(text, " \t\r\n") == strlen(text)) {
+                continue;
+            }
+
+            slots[count].line = line;
+            parse_position(&slots[count], text, width, height);
+            ++count;
+        }
+
+        run_thread_pool(&pool, count, analyze_position, slots);
+
+        for(int i = 0; i < count; ++i) {
+            print_position(&slots[i], top_count);
+            error_count += slots[i].error[0] != '\0';
+        }
+        position_count += count;
+        fflush(stdout);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1.0e9;
+
+    int result = 0;
+    if(ferror(file)) {
+        perror(path);
+        result = 1;
+    }
+    fprintf(stderr, "%ld positions, %ld errors, %.0f positions/s on %d threads\n",
+        position_count, error_count, seconds > 0 ? position_count / seconds : 0.0, pool.thread_count);
+
+    free(text);
+    if(file != stdin) {
+        fclose(file);
+    }
+    free_analysis_slots(slots, batch_size);
+    free_thread_pool(&pool);
+
+    return result;
+}
+
+// main thread side. a bad line becomes an error result, so the output still has one line per position
+static void parse_position(analysis_slot_t* slot, char* text, int width, int height) {
+    const uint64_t row_mask = width == 64 ? UINT64_MAX : ((uint64_t)1 << width) - 1;
+    char* save;
+    char* token;
+    int row = 0;
+
+    slot->error[0] = '\0';
+
+    const char* piece = strtok_r(text, " \t\r\n", &save);
+    const char* next = strtok_r(NULL, " \t\r\n", &save);
+    const char* hold = strtok_r(NULL, " \t\r\n", &save);
+    if(!parse_piece(piece, false, &slot->piece) || !parse_piece(next, true, &slot->next) || !parse_piece(hold, true, &slot->hold)) {
+        snprintf(slot->error, sizeof(slot->error), "bad piece");
+        return;
+    }
+
+    while((token = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+        char* end;
+        const uint64_t mask = strtoull(token, &end, 16);
+        if(*end != '\0' || (mask & ~row_mask) != 0) {
+            snprintf(slot->error, sizeof(slot->error), "bad row mask %d", row + 1);
+            return;
+        }
+        if(row < height) {
+            slot->masks[row] = mask;
+        }
+        ++row;
+    }
+    if(row != height) {
+        snprintf(slot->error, sizeof(slot->error), "%d row masks, expected %d", row, height);
+        return;
+    }
+}
+
+static bool parse_piece(const char* token, bool b_optional, int* piece) {
+    static const char piece_names[] = "OLJITSZ";
+
+    if(token == NULL || token[0] == '\0' || token[1] != '\0') {
+        return false;
+    }
+    if(b_optional && token[0] == '-') {
+        *piece = -1;
+        return true;
+    }
+    if(token[0] >= '0' && token[0] <= '6') {
+        *piece = token[0] - '0';
+        return true;
+    }
+
+    const char* name = strchr(piece_names, token[0]);
+    if(name == NULL) {
+        return false;
+    }
+    *piece = (int)(name - piece_names);
+
+    return true;
+}
+
+// pool side: the board is built from the masks and every rotation and column is played out as the bot would
+static void analyze_position(void* ctx, int index) {
+    analysis_slot_t* slot = &((analysis_slot_t*)ctx)[index];
+    board_t* board = &slot->board;
+    const int width = board->width;
+    bot_t defaults;
+
+    slot->candidate_count = 0;
+    if(slot->error[0] != '\0') {
+        return;
+    }
+
+    init_board(board, 0);
+    set_begin_game(&board->game_state, true);
+    set_row_masks(board, slot->masks);
+    set_hold_piece_num(&board->game_state, slot->hold);
+    if(slot->hold >= 0) {
+        set_piece_shape(board->hold_piece, slot->hold);
+    }
+    if(!spawn_chosen_piece(board, slot->piece)) {
+        snprintf(slot->error, sizeof(slot->error), "piece does not fit");
+        return;
+    }
+
+    reset_bot(&defaults);
+    for(int rotation = 0; rotation < 4; ++rotation) {
+        for(int x = PLACEMENT_MIN_X; x <= width; ++x) {
+            const placement_t target = { rotation, x };
+            double score;
+
+            copy_board(&slot->after, board);
+            if(!simulate_placement(&slot->after, target) || slot->after.game_state.b_game_over) {
+                continue;
+            }
+
+            const uint64_t hash = hash_grid(&slot->after);
+            bool b_seen = false;
+            for(int k = 0; k < slot->candidate_count && !b_seen; ++k) {
+                b_seen = slot->candidates[k].hash == hash;
+            }
+            if(b_seen) {
+                continue;
+            }
+
+            // preview 가 있으면 그 블록의 가장 좋은 수까지 두고 평가
+            if(slot->next >= 0) {
+                copy_board(&slot->next_board, &slot->after);
+                if(!spawn_chosen_piece(&slot->next_board, slot->next)) {
+                    continue;
+                }
+                find_best_placement(&defaults.weights, &slot->next_board, &slot->scratch, &score);
+                if(score == -DBL_MAX) {
+                    continue;
+                }
+            } else {
+                score = evaluate_grid(&defaults.weights, &slot->after);
+            }
+
+            analysis_candidate_t* candidate = &slot->candidates[slot->candidate_count];
+            candidate->placement = target;
+            candidate->score = score;
+            candidate->hash = hash;
+            candidate->order = slot->candidate_count;
+            ++slot->candidate_count;
+        }
+    }
+
+    if(slot->candidate_count == 0) {
+        snprintf(slot->error, sizeof(slot->error), "no placement survives");
+        return;
+    }
+    qsort(slot->candidates, slot->candidate_count, sizeof(analysis_candidate_t), compare_candidate);
+}
+
+static int compare_candidate(const void* a, const void* b) {
+    const analysis_candidate_t* x = a;
+    const analysis_candidate_t* y = b;
+
+    if(x->score != y->score) {
+        return x->score < y->score ? 1 : -1;
+    }
+    return x->order - y->order;
+}
+
+static void print_position(const analysis_slot_t* slot, int top_count) {
+    if(slot->error[0] != '\0') {
+        printf("%d error %s\n", slot->line, slot->error);
+        return;
+    }
+
+    printf("%d", slot->line);
+    for(int k = 0; k < slot->candidate_count && k <= top_count; ++k) {
+        const analysis_candidate_t* candidate = &slot->candidates[k];
+        printf(" %d:%d %.3f", candidate->placement.rotation, candidate->placement.x, candidate->score);
+    }
+    printf("\n");
+}
+
+static void free_analysis_slots(analysis_slot_t slots[], int count) {
+    for(int i = 0; i < count; ++i) {
+        free_board(&slots[i].board);
+        free_board(&slots[i].after);
+        free_board(&slots[i].next_board);
+        free_board(&slots[i].scratch);
+        free(slots[i].masks);
+    }
+    free(slots);
+}
@@ -0,0 +1,49 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "engine.h"
+#include "bot.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    ANALYSIS_POSITIONS_PER_THREAD = 16, // 한 batch 에서 thread 당 position 수
+    ANALYSIS_DEFAULT_TOP = 3, // best 말고 몇 개의 대안을 보여줄지
+    ANALYSIS_MAX_CANDIDATES = 4 * (BOARD_MAX_WIDTH - PLACEMENT_MIN_X + 1),
+    ANALYSIS_ERROR_SIZE = 64
+};
+
+// one legal placement of the current piece. score is the static evaluation after it, or after it and the best
+// placement of the preview piece when there is one
+typedef struct analysis_candidate_t {
+    placement_t placement;
+    double score;
+    uint64_t hash; // 놓은 뒤의 grid. 같은 결과가 되는 수는 하나만 남김
+    int order; // 같은 점수면 먼저 찾은 수가 앞
+} analysis_candidate_t;
+
+// one position of a batch. boards are created once per batch slot, the task fills candidates or error
+typedef struct analysis_slot_t {
+    int line; // 입력 파일의 줄 번호
+    int piece;
+    int next; // -1 이면 preview 없음
+    int hold;
+    uint64_t* masks; // height 개, 맨 윗줄부터
+    board_t board;
+    board_t after; // 후보 수를 둔 뒤
+    board_t next_board; // 그 뒤에 preview 블록이 나온 board
+    board_t scratch;
+    analysis_candidate_t candidates[ANALYSIS_MAX_CANDIDATES];
+    int candidate_count;
+    char error[ANALYSIS_ERROR_SIZE];
+} analysis_slot_t;
+
+// analysis functions
+
+int run_analysis(const char* path, int top_count, int thread_count, int width, int height);
+
+#endif /* ANALYSIS_H */
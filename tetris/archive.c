@@ -0,0 +1,501 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "replay.h"
+#include "archive.h"
+
+typedef struct key_id_t {
+    int64_t key;
+    uint32_t id;
+} key_id_t;
+
+static void print_entry(const archive_t* self, uint32_t id);
+static bool finish_segment(archive_writer_t* self);
+static bool write_index(archive_writer_t* self);
+static bool sync_dir(const char* dir);
+static int compare_key_id(const void* a, const void* b);
+static size_t lower_bound(const archive_t* self, archive_key_t key, int64_t value);
+static bool is_index_valid(const archive_t* self);
+static bool is_index_missing(const char* dir);
+
+// --------------------------------------------------
+// archive functions
+// --------------------------------------------------
+
+// new replays always go to a new segment after the ones the index already knows. an index that is there but cannot be
+// read is never written over, the writer is refused instead
+bool open_archive_writer(archive_writer_t* self, const char* dir) {
+    archive_t archive;
+
+    if(mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    snprintf(self->dir, sizeof(self->dir), "%s", dir);
+    self->segment_file = NULL;
+    self->segment = 0;
+    self->segment_size = 0;
+    self->pending = NULL;
+    self->pending_count = 0;
+    self->pending_capacity = 0;
+    self->write_buffer = malloc(ARCHIVE_WRITE_BUFFER_SIZE);
+    if(self->write_buffer == NULL) {
+        return false;
+    }
+
+    if(open_archive(&archive, dir)) {
+        self->segment = archive.header.segment_count;
+        close_archive(&archive);
+    } else if(!is_index_missing(dir)) {
+        free(self->write_buffer);
+        errno = EINVAL;
+        return false;
+    }
+
+    return true;
+}
+
+// buffered append to the open segment. a full segment is synced and indexed before the next one starts
+bool add_archive_replay(archive_writer_t* self, const replay_t* replay) {
+    if(self->segment_file == NULL) {
+        char path[ARCHIVE_PATH_SIZE + 32];
+        snprintf(path, sizeof(path), "%s/segment_%06u.seg", self->dir, self->segment);
+
+        self->segment_file = fopen(path, "wb");
+        if(self->segment_file == NULL) {
+            return false;
+        }
+        setvbuf(self->segment_file, self->write_buffer, _IOFBF, ARCHIVE_WRITE_BUFFER_SIZE);
+        self->segment_size = 0;
+    }
+
+    if(self->pending_count == self->pending_capacity) {
+        const size_t capacity = self->pending_capacity == 0 ? 1024 : self->pending_capacity * 2;
+        archive_entry_t* pending = realloc(self->pending, sizeof(archive_entry_t) * capacity);
+        if(pending == NULL) {
+            return false;
+        }
+        self->pending = pending;
+        self->pending_capacity = capacity;
+    }
+
+    archive_entry_t* entry = &self->pending[self->pending_count];
+    entry->seed = replay->seed;
+    entry->lines = replay->lines;
+    entry->level = replay->level;
+    entry->ticks = replay->tick_count;
+    entry->pieces = replay->pieces;
+    entry->segment = self->segment;
+    entry->offset = self->segment_size;
+
+    if(!write_replay(replay, self->segment_file)) {
+        return false;
+    }
+    ++(self->pending_count);
+    self->segment_size += sizeof(replay_header_t) + sizeof(input_t) * replay->tick_count;
+
+    if(self->segment_size >= ARCHIVE_SEGMENT_SIZE) {
+        return finish_segment(self);
+    }
+
+    return true;
+}
+
+bool close_archive_writer(archive_writer_t* self) {
+    bool b_ok = true;
+
+    if(self->segment_file != NULL) {
+        b_ok = finish_segment(self);
+    }
+
+    free(self->pending);
+    // segment 가 닫힌 뒤에 풀어야 함
+    free(self->write_buffer);
+
+    return b_ok;
+}
+
+bool open_archive(archive_t* self, const char* dir) {
+    char path[ARCHIVE_PATH_SIZE + 32];
+    struct stat status;
+
+    snprintf(self->dir, sizeof(self->dir), "%s", dir);
+    snprintf(path, sizeof(path), "%s/index", dir);
+
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    if(fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(archive_index_header_t)) {
+        close(fd);
+        return false;
+    }
+
+    self->size = status.st_size;
+    self->map = mmap(NULL, self->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(self->map == MAP_FAILED) {
+        return false;
+    }
+
+    memcpy(&self->header, self->map, sizeof(self->header));
+    const uint64_t count = self->header.entry_count;
+    const size_t entry_size = sizeof(archive_entry_t) + sizeof(uint32_t) * ARCHIVE_KEY_COUNT;
+    if(memcmp(self->header.magic, "TIDX", 4) != 0 || self->header.version != ARCHIVE_VERSION ||
+        count > (self->size - sizeof(archive_index_header_t)) / entry_size ||
+        sizeof(archive_index_header_t) + count * entry_size != self->size) {
+        munmap((void*)self->map, self->size);
+        return false;
+    }
+
+    self->entries = (const archive_entry_t*)(self->map + sizeof(archive_index_header_t));
+    for(int key = 0; key < ARCHIVE_KEY_COUNT; ++key) {
+        self->orders[key] = (const uint32_t*)(self->entries + count) + count * key;
+    }
+
+    if(!is_index_valid(self)) {
+        munmap((void*)self->map, self->size);
+        return false;
+    }
+
+    return true;
+}
+
+void close_archive(archive_t* self) {
+    munmap((void*)self->map, self->size);
+}
+
+// ids of the count largest values of key, largest first. returns how many were written
+int query_archive_top(const archive_t* self, archive_key_t key, int count, uint32_t ids[]) {
+    const uint64_t entry_count = self->header.entry_count;
+    int written = 0;
+
+    for(; written < count && (uint64_t)written < entry_count; ++written) {
+        ids[written] = self->orders[key][entry_count - 1 - written];
+    }
+
+    return written;
+}
+
+// ids with min <= key <= max, ascending. points into the mapped index, nothing is copied
+const uint32_t* query_archive_range(const archive_t* self, archive_key_t key, int64_t min, int64_t max, size_t* count) {
+    const size_t begin = lower_bound(self, key, min);
+    const size_t end = max == INT64_MAX ? self->header.entry_count : lower_bound(self, key, max + 1);
+
+    *count = end > begin ? end - begin : 0;
+
+    return self->orders[key] + begin;
+}
+
+int64_t get_archive_key(const archive_entry_t* entry, archive_key_t key) {
+    switch(key) {
+        case ARCHIVE_KEY_LINES:
+            return entry->lines;
+        case ARCHIVE_KEY_LEVEL:
+            return entry->level;
+        case ARCHIVE_KEY_TICKS:
+            return entry->ticks;
+        case ARCHIVE_KEY_SEED:
+            return entry->seed;
+        default:
+            return 0;
+    }
+}
+
+// only this reads a replay body
+bool load_archive_replay(const archive_t* self, uint32_t id, replay_t* replay) {
+    char path[ARCHIVE_PATH_SIZE + 32];
+
+    if(id >= self->header.entry_count) {
+        return false;
+    }
+
+    const archive_entry_t* entry = &self->entries[id];
+    snprintf(path, sizeof(path), "%s/segment_%06u.seg", self->dir, entry->segment);
+
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    const bool b_ok = read_replay(replay, fd, entry->offset);
+    close(fd);
+
+    return b_ok;
+}
+
+bool parse_archive_key(const char* name, archive_key_t* key) {
+    static const char* names[ARCHIVE_KEY_COUNT] = { "lines", "level", "ticks", "seed" };
+
+    for(int i = 0; i < ARCHIVE_KEY_COUNT; ++i) {
+        if(strcmp(name, names[i]) == 0) {
+            *key = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int run_archive_top(const char* dir, archive_key_t key, int count) {
+    archive_t archive;
+
+    if(count <= 0 || !open_archive(&archive, dir)) {
+        fprintf(stderr, "tetris: cannot read archive %s\n", dir);
+        return 1;
+    }
+
+    uint32_t* ids = malloc(sizeof(uint32_t) * count);
+    if(ids == NULL) {
+        close_archive(&archive);
+        return 1;
+    }
+
+    const int found = query_archive_top(&archive, key, count, ids);
+    for(int i = 0; i < found; ++i) {
+        print_entry(&archive, ids[i]);
+    }
+
+    free(ids);
+    close_archive(&archive);
+
+    return 0;
+}
+
+int run_archive_find_seed(const char* dir, uint32_t seed) {
+    archive_t archive;
+    size_t count;
+
+    if(!open_archive(&archive, dir)) {
+        fprintf(stderr, "tetris: cannot read archive %s\n", dir);
+        return 1;
+    }
+
+    const uint32_t* ids = query_archive_range(&archive, ARCHIVE_KEY_SEED, seed, seed, &count);
+    for(size_t i = 0; i < count; ++i) {
+        print_entry(&archive, ids[i]);
+    }
+
+    close_archive(&archive);
+
+    return 0;
+}
+
+// copies one replay out as a normal replay file, for --replay and --export
+int run_archive_extract(const char* dir, uint32_t id, const char* path) {
+    archive_t archive;
+    replay_t replay;
+
+    if(!open_archive(&archive, dir)) {
+        fprintf(stderr, "tetris: cannot read archive %s\n", dir);
+        return 1;
+    }
+    if(!load_archive_replay(&archive, id, &replay)) {
+        fprintf(stderr, "tetris: no replay %u in %s\n", id, dir);
+        close_archive(&archive);
+        return 1;
+    }
+
+    const bool b_ok = save_replay(&replay, path);
+    if(!b_ok) {
+        perror(path);
+    }
+
+    free_replay(&replay);
+    close_archive(&archive);
+
+    return b_ok ? 0 : 1;
+}
+
+static void print_entry(const archive_t* self, uint32_t id) {
+    const archive_entry_t* entry = &self->entries[id];
+
+    printf("id %u: seed %u, lines %d, level %d, ticks %d, pieces %d\n", id, entry->seed, entry->lines, entry->level, entry->ticks, entry->pieces);
+}
+
+// segment 를 디스크에 확실히 쓴 뒤에 index 에 넣음
+static bool finish_segment(archive_writer_t* self) {
+    bool b_ok = fflush(self->segment_file) == 0;
+    b_ok = b_ok && fsync(fileno(self->segment_file)) == 0;
+    b_ok = (fclose(self->segment_file) == 0) && b_ok;
+    self->segment_file = NULL;
+
+    if(!b_ok) {
+        return false;
+    }
+
+    ++(self->segment);
+    return write_index(self);
+}
+
+// old index + pending entries, sorted once per key, written beside the old index and renamed over it
+static bool write_index(archive_writer_t* self) {
+    char path[ARCHIVE_PATH_SIZE + 32];
+    char temp_path[ARCHIVE_PATH_SIZE + 32];
+    archive_t old;
+    archive_index_header_t header;
+    const bool b_has_old = open_archive(&old, self->dir);
+    const uint64_t old_count = b_has_old ? old.header.entry_count : 0;
+    const uint64_t count = old_count + self->pending_count;
+    archive_entry_t* entries = malloc(sizeof(archive_entry_t) * (count > 0 ? count : 1));
+    key_id_t* keys = malloc(sizeof(key_id_t) * (count > 0 ? count : 1));
+    uint32_t* order = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    // 그 사이에 index 가 망가졌으면 새 entry 만으로 덮어쓰지 않음
+    bool b_ok = entries != NULL && keys != NULL && order != NULL && (b_has_old || is_index_missing(self->dir));
+    FILE* file = NULL;
+
+    snprintf(path, sizeof(path), "%s/index", self->dir);
+    snprintf(temp_path, sizeof(temp_path), "%s/index.tmp", self->dir);
+
+    if(b_ok) {
+        if(b_has_old) {
+            memcpy(entries, old.entries, sizeof(archive_entry_t) * old_count);
+        }
+        memcpy(entries + old_count, self->pending, sizeof(archive_entry_t) * self->pending_count);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "TIDX", 4);
+        header.version = ARCHIVE_VERSION;
+        header.entry_count = count;
+        header.segment_count = self->segment;
+
+        file = fopen(temp_path, "wb");
+        b_ok = file != NULL;
+    }
+
+    if(b_ok) {
+        setvbuf(file, self->write_buffer, _IOFBF, ARCHIVE_WRITE_BUFFER_SIZE);
+        b_ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(entries, sizeof(archive_entry_t), count, file) == count;
+
+        for(int key = 0; b_ok && key < ARCHIVE_KEY_COUNT; ++key) {
+            for(uint64_t i = 0; i < count; ++i) {
+                keys[i].key = get_archive_key(&entries[i], key);
+                keys[i].id = (uint32_t)i;
+            }
+            qsort(keys, count, sizeof(key_id_t), compare_key_id);
+            for(uint64_t i = 0; i < count; ++i) {
+                order[i] = keys[i].id;
+            }
+            b_ok = fwrite(order, sizeof(uint32_t), count, file) == count;
+        }
+
+        b_ok = b_ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        b_ok = (fclose(file) == 0) && b_ok;
+        b_ok = b_ok && rename(temp_path, path) == 0 && sync_dir(self->dir);
+    }
+
+    if(b_has_old) {
+        close_archive(&old);
+    }
+    if(b_ok) {
+        self->pending_count = 0;
+    }
+    free(entries);
+    free(keys);
+    free(order);
+
+    return b_ok;
+}
+
+// only a directory without an index is a new archive
+static bool is_index_missing(const char* dir) {
+    char path[ARCHIVE_PATH_SIZE + 32];
+    struct stat status;
+
+    snprintf(path, sizeof(path), "%s/index", dir);
+
+    return stat(path, &status) != 0 && errno == ENOENT;
+}
+
+static bool sync_dir(const char* dir) {
+    const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+
+    if(fd < 0) {
+        return false;
+    }
+
+    const bool b_ok = fsync(fd) == 0;
+    close(fd);
+
+    return b_ok;
+}
+
+// ties keep append order
+static int compare_key_id(const void* a, const void* b) {
+    const key_id_t* left = a;
+    const key_id_t* right = b;
+
+    if(left->key != right->key) {
+        return left->key < right->key ? -1 : 1;
+    }
+
+    return left->id < right->id ? -1 : (left->id > right->id);
+}
+
+// first position in the key order whose value is >= value
+static size_t lower_bound(const archive_t* self, archive_key_t key, int64_t value) {
+    const uint32_t* order = self->orders[key];
+    size_t low = 0;
+    size_t high = self->header.entry_count;
+
+    while(low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if(get_archive_key(&self->entries[order[middle]], key) < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+// every entry must point into a segment that exists and hold its whole replay, every id must name an entry.
+// entries are in append order, so each segment is looked at once
+static bool is_index_valid(const archive_t* self) {
+    char path[ARCHIVE_PATH_SIZE + 32];
+    struct stat status;
+    const uint64_t count = self->header.entry_count;
+    int64_t segment = -1;
+    uint64_t segment_size = 0;
+
+    for(uint64_t i = 0; i < count; ++i) {
+        const archive_entry_t* entry = &self->entries[i];
+
+        if(entry->segment >= self->header.segment_count || entry->ticks < 0) {
+            return false;
+        }
+        if(entry->segment != segment) {
+            snprintf(path, sizeof(path), "%s/segment_%06u.seg", self->dir, entry->segment);
+            if(stat(path, &status) != 0) {
+                return false;
+            }
+            segment = entry->segment;
+            segment_size = status.st_size;
+        }
+
+        // version 1 replay 의 header 가 가장 짧음
+        const uint64_t replay_size = offsetof(replay_header_t, width) + sizeof(input_t) * (uint64_t)entry->ticks;
+        if(entry->offset > segment_size || replay_size > segment_size - entry->offset) {
+            return false;
+        }
+    }
+
+    for(int key = 0; key < ARCHIVE_KEY_COUNT; ++key) {
+        for(uint64_t i = 0; i < count; ++i) {
+            if(self->orders[key][i] >= count) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "replay.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    ARCHIVE_VERSION = 1,
+    ARCHIVE_PATH_SIZE = 512,
+    ARCHIVE_SEGMENT_SIZE = 64 << 20, // segment 하나의 최대 크기
+    ARCHIVE_WRITE_BUFFER_SIZE = 1 << 20
+};
+
+typedef enum archive_key {
+    ARCHIVE_KEY_LINES,
+    ARCHIVE_KEY_LEVEL,
+    ARCHIVE_KEY_TICKS, // duration
+    ARCHIVE_KEY_SEED,
+    ARCHIVE_KEY_COUNT
+} archive_key_t;
+
+// one replay. the id of a replay is its position in the entry array, which is append order
+typedef struct archive_entry_t {
+    uint32_t seed;
+    int32_t lines;
+    int32_t level;
+    int32_t ticks;
+    int32_t pieces;
+    uint32_t segment;
+    uint64_t offset; // segment 안에서 replay_header_t 의 위치
+} archive_entry_t;
+
+// index file: header, entries, then one id array per key sorted ascending by that key
+typedef struct archive_index_header_t {
+    char magic[4]; // "TIDX"
+    uint32_t version;
+    uint64_t entry_count;
+    uint32_t segment_count;
+    uint32_t reserved[9];
+} archive_index_header_t;
+
+// segments are only ever added. the index is rewritten when a segment is finished
+typedef struct archive_writer_t {
+    char dir[ARCHIVE_PATH_SIZE];
+    FILE* segment_file;
+    char* write_buffer;
+    uint32_t segment;
+    uint64_t segment_size;
+    archive_entry_t* pending; // 아직 index 에 없는 replay
+    size_t pending_count;
+    size_t pending_capacity;
+} archive_writer_t;
+
+typedef struct archive_t {
+    char dir[ARCHIVE_PATH_SIZE];
+    const unsigned char* map;
+    size_t size;
+    archive_index_header_t header;
+    const archive_entry_t* entries;
+    const uint32_t* orders[ARCHIVE_KEY_COUNT];
+} archive_t;
+
+// archive functions
+
+bool open_archive_writer(archive_writer_t* self, const char* dir);
+bool add_archive_replay(archive_writer_t* self, const replay_t* replay);
+bool close_archive_writer(archive_writer_t* self);
+bool open_archive(archive_t* self, const char* dir);
+void close_archive(archive_t* self);
+int query_archive_top(const archive_t* self, archive_key_t key, int count, uint32_t ids[]);
+const uint32_t* query_archive_range(const archive_t* self, archive_key_t key, int64_t min, int64_t max, size_t* count);
+int64_t get_archive_key(const archive_entry_t* entry, archive_key_t key);
+bool load_archive_replay(const archive_t* self, uint32_t id, replay_t* replay);
+bool parse_archive_key(const char* name, archive_key_t* key);
+int run_archive_top(const char* dir, archive_key_t key, int count);
+int run_archive_find_seed(const char* dir, uint32_t seed);
+int run_archive_extract(const char* dir, uint32_t id, const char* path);
+
+#endif /* ARCHIVE_H */
@@ -0,0 +1,301 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "engine.h"
+#include "archive.h"
+#include "book.h"
+#include "bot.h"
+#include "dataset.h"
+#include "replay.h"
+#include "thread_pool.h"
+#include "autoplay.h"
+
+static void record_decision(void* ctx, const board_t* board, placement_t placement);
+static void play_autoplay_game(void* ctx, int index);
+static void free_autoplay_games(autoplay_game_t games[], int count);
+
+// --------------------------------------------------
+// autoplay functions
+// --------------------------------------------------
+
+// one headless game as fast as it goes on a created board. tick_limit <= 0 plays until game over, replay may be NULL
+void play_bot_game(board_t* board, bot_t* bot, unsigned int seed, long tick_limit, decision_fn_t on_decision, void* ctx, replay_t* replay) {
+    input_t input;
+
+    init_board(board, seed);
+    set_begin_game(&board->game_state, true);
+
+    for(long tick = 0; !board->game_state.b_game_over && (tick_limit <= 0 || tick < tick_limit); ++tick) {
+        const int planned_piece = bot->planned_piece;
+
+        get_bot_input(bot, board, &input);
+        if(on_decision != NULL && bot->planned_piece != planned_piece) {
+            on_decision(ctx, board, bot->target);
+        }
+
+        step_board(board, input);
+        if(replay != NULL) {
+            record_replay_input(replay, input);
+        }
+    }
+
+    if(replay != NULL) {
+        finish_replay(replay, &board->game_state);
+    }
+}
+
+// games run in batches on the pool. a finished batch is written in game order, so the files do not depend on threads
+// the dataset columns have the standard board size, so --dataset only goes with it. the book is mapped once for all games
+int run_autoplay(int game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, const char* dataset_path, const char* archive_path, const char* book_path, int dig_rows) {
+    thread_pool_t pool;
+    dataset_writer_t writer;
+    archive_writer_t archive;
+    book_t book;
+    autoplay_game_t* games = NULL;
+    int batch_size = 0;
+    long total_lines = 0;
+    long total_pieces = 0;
+    long total_dug = 0;
+    long total_rows = 0;
+    struct timespec begin;
+    struct timespec end;
+
+    if(dataset_path != NULL && (width != BOARD_DEFAULT_WIDTH || height != BOARD_DEFAULT_HEIGHT)) {
+        fprintf(stderr, "tetris: --dataset needs the %dx%d board\n", BOARD_DEFAULT_WIDTH, BOARD_DEFAULT_HEIGHT);
+        return 1;
+    }
+    if(book_path != NULL && !open_book(&book, book_path)) {
+        fprintf(stderr, "tetris: cannot read book %s\n", book_path);
+        return 1;
+    }
+    if(!init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        if(book_path != NULL) {
+            close_book(&book);
+        }
+        return 1;
+    }
+    // pool 이 고친 thread 수로 batch 크기를 정함
+    batch_size = pool.thread_count * AUTOPLAY_GAMES_PER_THREAD;
+    games = calloc(batch_size, sizeof(autoplay_game_t));
+    if(games == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        if(book_path != NULL) {
+            close_book(&book);
+        }
+        return 1;
+    }
+    for(int i = 0; i < batch_size; ++i) {
+        if(!create_board(&games[i].board, width, height) || !init_bot(&games[i].bot, width, height)) {
+            fprintf(stderr, "tetris: out of memory\n");
+            free_autoplay_games(games, batch_size);
+            free_thread_pool(&pool);
+            if(book_path != NULL) {
+                close_book(&book);
+            }
+            return 1;
+        }
+        games[i].bot.book = book_path != NULL ? &book : NULL;
+        set_dig_rows(&games[i].board, dig_rows);
+    }
+    if(dataset_path != NULL && !open_dataset_writer(&writer, dataset_path)) {
+        perror(dataset_path);
+        free_autoplay_games(games, batch_size);
+        free_thread_pool(&pool);
+        if(book_path != NULL) {
+            close_book(&book);
+        }
+        return 1;
+    }
+    if(archive_path != NULL && !open_archive_writer(&archive, archive_path)) {
+        perror(archive_path);
+        if(dataset_path != NULL) {
+            close_dataset_writer(&writer);
+        }
+        free_autoplay_games(games, batch_size);
+        free_thread_pool(&pool);
+        if(book_path != NULL) {
+            close_book(&book);
+        }
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for(int first = 0; first < game_count; first += batch_size) {
+        const int count = game_count - first < batch_size ? game_count - first : batch_size;
+
+        for(int i = 0; i < count; ++i) {
+            games[i].seed = seed + first + i;
+            games[i].tick_limit = tick_limit;
+            games[i].row_count = 0;
+            games[i].b_out_of_memory = false;
+            games[i].b_collect = dataset_path != NULL;
+            games[i].b_record = archive_path != NULL;
+        }
+
+        run_thread_pool(&pool, count, play_autoplay_game, games);
+
+        for(int i = 0; i < count; ++i) {
+            autoplay_game_t* game = &games[i];
+            total_lines += game->board.game_state.g_lines;
+            total_pieces += game->board.game_state.g_pieces;
+            total_dug += game->board.dug_rows;
+
+            if(archive_path != NULL) {
+                if(!add_archive_replay(&archive, &game->replay)) {
+                    perror(archive_path);
+                    archive_path = NULL;
+                }
+                free_replay(&game->replay);
+            }
+
+            if(dataset_path == NULL) {
+                continue;
+            }
+            if(game->b_out_of_memory) {
+                fprintf(stderr, "tetris: out of memory, game %d left out\n", first + i);
+                continue;
+            }
+
+            for(int k = 0; k < game->row_count; ++k) {
+                dataset_row_t* row = &game->rows[k];
+                // outcome 에 임시로 넣어둔 그 시점의 g_lines 로 계산
+                const int lines_here = row->outcome;
+                const int lines_next = k + 1 < game->row_count ? game->rows[k + 1].outcome : game->board.game_state.g_lines;
+
+                row->lines_cleared = (uint8_t)(lines_next - lines_here);
+                row->game = first + i;
+            }
+            for(int k = 0; k < game->row_count; ++k) {
+                game->rows[k].outcome = game->board.game_state.g_lines - game->rows[k].outcome;
+                if(!append_dataset_row(&writer, &game->rows[k])) {
+                    perror(dataset_path);
+                    dataset_path = NULL;
+                    break;
+                }
+            }
+            total_rows += game->row_count;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1.0e9;
+
+    int result = 0;
+    if(dataset_path != NULL && !close_dataset_writer(&writer)) {
+        perror(dataset_path);
+        result = 1;
+    }
+    if(archive_path != NULL && !close_archive_writer(&archive)) {
+        perror(archive_path);
+        result = 1;
+    }
+
+    printf("games: %d, lines: %.1f avg, pieces: %ld, rows: %ld\n", game_count, game_count > 0 ? total_lines / (double)game_count : 0.0, total_pieces, total_rows);
+    if(dig_rows > 0) {
+        printf("dug: %.1f rows avg\n", game_count > 0 ? total_dug / (double)game_count : 0.0);
+    }
+    printf("%.0f pieces/s on %d threads\n", total_pieces / seconds, pool.thread_count);
+
+    free_autoplay_games(games, batch_size);
+    free_thread_pool(&pool);
+    if(book_path != NULL) {
+        close_book(&book);
+    }
+
+    return result;
+}
+
+// row count and a few column averages, read through the column views
+int run_dataset_info(const char* dataset_path) {
+    dataset_reader_t reader;
+    uint64_t piece_counts[7] = { 0 };
+    double outcome_sum = 0;
+    uint64_t lines_sum = 0;
+
+    if(!open_dataset_reader(&reader, dataset_path)) {
+        fprintf(stderr, "tetris: cannot read dataset %s\n", dataset_path);
+        return 1;
+    }
+
+    for(uint64_t group = 0; group < get_dataset_group_count(&reader); ++group) {
+        uint32_t count;
+        const int8_t* pieces = get_dataset_column(&reader, COLUMN_PIECE, group, &count);
+        const uint8_t* lines = get_dataset_column(&reader, COLUMN_LINES_CLEARED, group, &count);
+        const int32_t* outcomes = get_dataset_column(&reader, COLUMN_OUTCOME, group, &count);
+
+        for(uint32_t i = 0; i < count; ++i) {
+            if(pieces[i] >= 0 && pieces[i] < 7) {
+                ++piece_counts[pieces[i]];
+            }
+            lines_sum += lines[i];
+            outcome_sum += outcomes[i];
+        }
+    }
+
+    const uint64_t rows = reader.header.row_count;
+    printf("rows: %llu in %llu groups of %u\n", (unsigned long long)rows, (unsigned long long)get_dataset_group_count(&reader), reader.header.group_rows);
+    printf("pieces:");
+    for(int i = 0; i < 7; ++i) {
+        printf(" %llu", (unsigned long long)piece_counts[i]);
+    }
+    printf("\nlines cleared: %.3f avg, outcome: %.1f avg\n", rows > 0 ? lines_sum / (double)rows : 0.0, rows > 0 ? outcome_sum / rows : 0.0);
+
+    close_dataset_reader(&reader);
+
+    return 0;
+}
+
+// board before the move. the outcome column holds g_lines until the game is over
+static void record_decision(void* ctx, const board_t* board, placement_t placement) {
+    autoplay_game_t* game = ctx;
+    uint64_t masks[BOARD_DEFAULT_HEIGHT];
+
+    if(game->row_count == game->row_capacity) {
+        const int capacity = game->row_capacity == 0 ? 1024 : game->row_capacity * 2;
+        dataset_row_t* rows = realloc(game->rows, sizeof(dataset_row_t) * capacity);
+        if(rows == NULL) {
+            game->b_out_of_memory = true;
+            return;
+        }
+        game->rows = rows;
+        game->row_capacity = capacity;
+    }
+
+    dataset_row_t* row = &game->rows[game->row_count++];
+    get_row_masks(board, masks);
+    for(int i = 0; i < BOARD_DEFAULT_HEIGHT; ++i) {
+        row->board[i] = (uint16_t)masks[i];
+    }
+    row->piece = (int8_t)board->game_state.finished_piece_num;
+    row->next = (int8_t)board->game_state.current_piece_num;
+    row->rotation = (int8_t)placement.rotation;
+    row->x = (int8_t)placement.x;
+    row->lines_cleared = 0;
+    row->outcome = board->game_state.g_lines;
+    row->game = 0;
+}
+
+static void play_autoplay_game(void* ctx, int index) {
+    autoplay_game_t* game = &((autoplay_game_t*)ctx)[index];
+
+    reset_bot(&game->bot);
+    if(game->b_record) {
+        init_replay(&game->replay, game->seed, game->board.width, game->board.height, game->board.dig_rows);
+    }
+    play_bot_game(&game->board, &game->bot, game->seed, game->tick_limit, game->b_collect ? record_decision : NULL, game, game->b_record ? &game->replay : NULL);
+}
+
+// calloc 으로 만든 배열이라 만들지 못한 board 의 cells 는 NULL
+static void free_autoplay_games(autoplay_game_t games[], int count) {
+    for(int i = 0; i < count; ++i) {
+        free_board(&games[i].board);
+        free_bot(&games[i].bot);
+        free(games[i].rows);
+    }
+    free(games);
+}
@@ -0,0 +1,42 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include "engine.h"
+#include "archive.h"
+#include "bot.h"
+#include "dataset.h"
+#include "replay.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    AUTOPLAY_GAMES_PER_THREAD = 4 // 한 batch 에서 thread 당 게임 수
+};
+
+// called once per piece, before the bot's first key for it
+typedef void (*decision_fn_t)(void* ctx, const board_t* board, placement_t placement);
+
+// one game of a batch and the decision points it produced. board and bot are created once per batch slot
+typedef struct autoplay_game_t {
+    unsigned int seed;
+    long tick_limit;
+    board_t board;
+    bot_t bot;
+    dataset_row_t* rows;
+    int row_count;
+    int row_capacity;
+    replay_t replay;
+    bool b_collect; // decision 을 모을지
+    bool b_record; // replay 를 남길지
+    bool b_out_of_memory;
+} autoplay_game_t;
+
+// autoplay functions
+
+void play_bot_game(board_t* board, bot_t* bot, unsigned int seed, long tick_limit, decision_fn_t on_decision, void* ctx, replay_t* replay);
+int run_autoplay(int game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, const char* dataset_path, const char* archive_path, const char* book_path, int dig_rows);
+int run_dataset_info(const char* dataset_path);
+
+#endif /* AUTOPLAY_H */
@@ -0,0 +1,174 @@
+// board features from packed row masks. a board is read top down one row at a time: the cells of a row become a
+// uint64_t with vector compares, then every feature is a few bit operations and a popcount on that row.
+// x86 gets an avx2 build of the whole loop, picked at run time, and an sse2 one; other targets build masks per cell
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "engine.h"
+#include "board_features.h"
+
+#define FEATURE_KERNEL static inline __attribute__((always_inline))
+
+// running state of one board while its rows go by
+typedef struct feature_scan_t {
+    uint64_t full; // width 개의 bit
+    uint64_t seen; // 지금까지 지난 줄들의 OR. 이 줄 높이까지 블록이 있는 열
+    int rows; // 지난 FADING 아닌 줄 수
+    int top[BOARD_MAX_WIDTH]; // 열에 처음 블록이 나온 줄
+} feature_scan_t;
+
+typedef uint64_t (*row_mask_fn_t)(const grid_square_t row[], int width);
+
+FEATURE_KERNEL void begin_feature_scan(feature_scan_t* scan, int width, board_features_t* out);
+FEATURE_KERNEL void add_feature_row(feature_scan_t* scan, uint64_t mask, int width, board_features_t* out);
+FEATURE_KERNEL void end_feature_scan(const feature_scan_t* scan, int width, board_features_t* out);
+FEATURE_KERNEL void extract_board_features(const board_t* board, board_features_t* out, row_mask_fn_t get_row_mask);
+FEATURE_KERNEL uint64_t get_row_mask_scalar(const grid_square_t row[], int width);
+static void extract_board_features_default(const board_t* board, board_features_t* out);
+#if defined(__x86_64__) || defined(__i386__)
+FEATURE_KERNEL __attribute__((target("avx2"))) uint64_t get_row_mask_avx2(const grid_square_t row[], int width);
+static __attribute__((target("avx2,popcnt,bmi"))) void extract_board_features_avx2(const board_t* board, board_features_t* out);
+#endif
+
+// --------------------------------------------------
+// board_features_t functions
+// --------------------------------------------------
+
+// the avx2 check is one load of a flag set at start-up, so it is done per batch
+void extract_features(const board_t boards[], int count, board_features_t out[]) {
+#if defined(__x86_64__) || defined(__i386__)
+    if(__builtin_cpu_supports("avx2")) {
+        for(int i = 0; i < count; ++i) {
+            extract_board_features_avx2(&boards[i], &out[i]);
+        }
+        return;
+    }
+#endif
+
+    for(int i = 0; i < count; ++i) {
+        extract_board_features_default(&boards[i], &out[i]);
+    }
+}
+
+// masks as get_row_masks makes them, row 0 at the top. they carry no FADING rows, so lines is 0
+void extract_mask_features(const uint64_t masks[], int rows, int width, board_features_t* out) {
+    feature_scan_t scan;
+
+    begin_feature_scan(&scan, width, out);
+    for(int i = 0; i < rows; ++i) {
+        add_feature_row(&scan, masks[i] & scan.full, width, out);
+    }
+    end_feature_scan(&scan, width, out);
+}
+
+FEATURE_KERNEL void begin_feature_scan(feature_scan_t* scan, int width, board_features_t* out) {
+    scan->full = width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+    scan->seen = 0;
+    scan->rows = 0;
+    memset(out, 0, sizeof(board_features_t));
+}
+
+// one row below the previous one. heights are known only at the end, so the row where each column starts is kept
+FEATURE_KERNEL void add_feature_row(feature_scan_t* scan, uint64_t mask, int width, board_features_t* out) {
+    const uint64_t inner = scan->full >> 1; // 오른쪽 이웃이 있는 열
+    const uint64_t right_wall = (uint64_t)1 << (width - 1);
+
+    for(uint64_t started = mask & ~scan->seen; started != 0; started &= started - 1) {
+        scan->top[__builtin_ctzll(started)] = scan->rows;
+    }
+    scan->seen |= mask;
+    const uint64_t seen = scan->seen;
+
+    out->holes += __builtin_popcountll(seen & ~mask);
+    out->aggregate_height += __builtin_popcountll(seen);
+    // 이웃 중 한 열만 이 줄까지 올라와 있으면 높이 차에 1 을 더함
+    out->bumpiness += __builtin_popcountll((seen ^ (seen >> 1)) & inner);
+    out->wells += __builtin_popcountll(~seen & ((seen << 1) | 1) & ((seen >> 1) | right_wall) & scan->full);
+    if(seen != 0) {
+        out->row_transitions += __builtin_popcountll((mask ^ (mask >> 1)) & inner) + !(mask & 1) + !(mask & right_wall);
+    }
+
+    ++scan->rows;
+}
+
+FEATURE_KERNEL void end_feature_scan(const feature_scan_t* scan, int width, board_features_t* out) {
+    for(int j = 0; j < width; ++j) {
+        out->heights[j] = (scan->seen >> j) & 1 ? scan->rows - scan->top[j] : 0;
+        if(out->heights[j] > out->max_height) {
+            out->max_height = out->heights[j];
+        }
+    }
+}
+
+FEATURE_KERNEL void extract_board_features(const board_t* board, board_features_t* out, row_mask_fn_t get_row_mask) {
+    const int width = board->width;
+    const grid_square_t* row = board->grid;
+    feature_scan_t scan;
+
+    begin_feature_scan(&scan, width, out);
+    for(int i = 0; i < board->height; ++i, row += width + 2) {
+        if(row[1] == FADING) {
+            ++out->lines;
+            continue;
+        }
+        add_feature_row(&scan, get_row_mask(row, width) & scan.full, width, out);
+    }
+    end_feature_scan(&scan, width, out);
+}
+
+FEATURE_KERNEL uint64_t get_row_mask_scalar(const grid_square_t row[], int width) {
+    uint64_t mask = 0;
+
+    for(int j = 1; j <= width; ++j) {
+        mask |= (uint64_t)(row[j] >= FULL) << (j - 1);
+    }
+
+    return mask;
+}
+
+#if defined(__SSE2__)
+// 4 cells per compare. the last load may read the right wall and the next row, the caller masks them off.
+// the floor and the pad rows below it keep the last row's loads inside the grid
+FEATURE_KERNEL uint64_t get_row_mask_sse2(const grid_square_t row[], int width) {
+    const __m128i fading = _mm_set1_epi32(FADING);
+    uint64_t mask = 0;
+
+    for(int j = 1; j <= width; j += 4) {
+        const __m128i cells = _mm_loadu_si128((const __m128i*)(row + j));
+        mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(cells, fading))) << (j - 1);
+    }
+
+    return mask;
+}
+
+static void extract_board_features_default(const board_t* board, board_features_t* out) {
+    extract_board_features(board, out, get_row_mask_sse2);
+}
+#else
+static void extract_board_features_default(const board_t* board, board_features_t* out) {
+    extract_board_features(board, out, get_row_mask_scalar);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+// same as sse2 with 8 cells per compare
+FEATURE_KERNEL __attribute__((target("avx2"))) uint64_t get_row_mask_avx2(const grid_square_t row[], int width) {
+    const __m256i fading = _mm256_set1_epi32(FADING);
+    uint64_t mask = 0;
+
+    for(int j = 1; j <= width; j += 8) {
+        const __m256i cells = _mm256_loadu_si256((const __m256i*)(row + j));
+        mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(cells, fading))) << (j - 1);
+    }
+
+    return mask;
+}
+
+static __attribute__((target("avx2,popcnt,bmi"))) void extract_board_features_avx2(const board_t* board, board_features_t* out) {
+    extract_board_features(board, out, get_row_mask_avx2);
+}
+#endif
@@ -0,0 +1,29 @@
+#ifndef BOARD_FEATURES_H
+#define BOARD_FEATURES_H
+
+#include <stdint.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+// static features of a board for search and training. rows marked FADING are about to be deleted, so they count as
+// lines and are left out of everything else. cells count as filled from FULL up; MOVING and the walls do not
+typedef struct board_features_t {
+    int heights[BOARD_MAX_WIDTH]; // 열 높이, FADING 줄 제외
+    int aggregate_height;
+    int max_height;
+    int holes; // 위에 블록이 있는 빈칸
+    int row_transitions; // 가장 높은 블록 아래 줄들에서 빈칸과 블록이 바뀌는 수, 벽은 블록
+    int wells; // 양 옆 열이 더 높은 빈칸 수, 벽은 무한히 높음
+    int bumpiness; // 이웃한 열 높이 차의 합
+    int lines; // FADING 줄 수
+} board_features_t;
+
+// board_features_t functions
+
+void extract_features(const board_t boards[], int count, board_features_t out[]);
+void extract_mask_features(const uint64_t masks[], int rows, int width, board_features_t* out);
+
+#endif /* BOARD_FEATURES_H */
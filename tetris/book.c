@@ -0,0 +1,355 @@
+// opening book: the bot's placement for every board the first pieces can lead to. the bot's choice depends only on
+// the settled cells and the piece, so the book is built by giving the board each of the 7 pieces in turn and
+// playing the bot's placement, and the result is the same as searching in the game
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+#include "bot.h"
+#include "thread_pool.h"
+#include "book.h"
+
+static size_t get_entries_offset(uint32_t bucket_bits);
+static bool is_bucket_table_valid(const uint32_t buckets[], uint32_t bucket_bits, uint64_t entry_count);
+static uint64_t mix_key(uint64_t x);
+static uint64_t encode_entry(uint64_t key, placement_t placement);
+static void build_book_task(void* ctx, int index);
+static void expand_book(book_task_t* task, const board_t* parent, int level);
+static void add_book_entry(book_task_t* task, const board_t* board, placement_t placement);
+static int compare_entry(const void* a, const void* b);
+static bool write_book(const char* path, const uint64_t entries[], size_t count, int depth, int width, int height);
+
+// --------------------------------------------------
+// book functions
+// --------------------------------------------------
+
+bool open_book(book_t* self, const char* path) {
+    struct stat status;
+
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    if(fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(book_header_t)) {
+        close(fd);
+        return false;
+    }
+
+    self->size = status.st_size;
+    self->map = mmap(NULL, self->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(self->map == MAP_FAILED) {
+        return false;
+    }
+
+    self->header = (const book_header_t*)self->map;
+    const uint32_t bits = self->header->bucket_bits;
+    // entry_count 를 곱하지 않고 남은 크기로 나눠서 비교
+    const bool b_valid = memcmp(self->header->magic, "TBOK", 4) == 0 && self->header->version == BOOK_VERSION && bits >= 1 && bits <= 28
+        && self->size >= get_entries_offset(bits) && (self->size - get_entries_offset(bits)) % sizeof(uint64_t) == 0
+        && (self->size - get_entries_offset(bits)) / sizeof(uint64_t) == self->header->entry_count;
+    if(!b_valid) {
+        munmap((void*)self->map, self->size);
+        return false;
+    }
+
+    self->buckets = (const uint32_t*)(self->map + sizeof(book_header_t));
+    self->entries = (const uint64_t*)(self->map + get_entries_offset(bits));
+    if(!is_bucket_table_valid(self->buckets, bits, self->header->entry_count)) {
+        munmap((void*)self->map, self->size);
+        return false;
+    }
+
+    return true;
+}
+
+void close_book(book_t* self) {
+    munmap((void*)self->map, self->size);
+}
+
+// called when the bot plans a piece. false past the book's depth or for a board it does not have
+bool find_book_placement(const book_t* self, const board_t* board, placement_t* placement) {
+    const book_header_t* header = self->header;
+
+    if(board->game_state.g_pieces > header->depth || board->width != header->width || board->height != header->height) {
+        return false;
+    }
+
+    const uint64_t key = get_book_key(board);
+    const uint64_t bucket = key >> (64 - header->bucket_bits);
+    for(uint32_t i = self->buckets[bucket]; i < self->buckets[bucket + 1]; ++i) {
+        const uint64_t entry = self->entries[i];
+        if((entry >> BOOK_PLACEMENT_BITS) == (key >> BOOK_PLACEMENT_BITS)) {
+            placement->rotation = entry & 3;
+            placement->x = (int)((entry >> 2) & 0x7f) + PLACEMENT_MIN_X;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// settled cells and the moving piece's number. the low BOOK_PLACEMENT_BITS bits are left 0
+uint64_t get_book_key(const board_t* board) {
+    uint64_t masks[board->height];
+    uint64_t key = mix_key(0x9e3779b97f4a7c15ull + (uint64_t)board->game_state.finished_piece_num);
+
+    get_row_masks(board, masks);
+    for(int i = 0; i < board->height; ++i) {
+        key = mix_key(key ^ masks[i]);
+    }
+
+    return key & ~(((uint64_t)1 << BOOK_PLACEMENT_BITS) - 1);
+}
+
+// offline: 7^depth piece sequences, in 49 tasks on the pool. boards reached by different sequences end up as one entry
+int run_build_book(const char* path, int depth, int thread_count, int width, int height) {
+    thread_pool_t pool;
+    bot_t defaults;
+    const int task_count = 7 * 7;
+    book_task_t* tasks = calloc(task_count, sizeof(book_task_t));
+    struct timespec begin;
+    struct timespec end;
+    size_t total = 0;
+
+    if(depth < 1 || depth > BOOK_MAX_DEPTH) {
+        fprintf(stderr, "tetris: book depth is 1 to %d\n", BOOK_MAX_DEPTH);
+        free(tasks);
+        return 1;
+    }
+    if(tasks == NULL || !init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free(tasks);
+        return 1;
+    }
+
+    reset_bot(&defaults);
+    bool b_ok = true;
+    for(int i = 0; i < task_count; ++i) {
+        book_task_t* task = &tasks[i];
+        task->prefix[0] = i / 7;
+        task->prefix[1] = i % 7;
+        task->depth = depth;
+        task->weights = defaults.weights;
+        b_ok = create_board(&task->scratch, width, height) && b_ok;
+        for(int k = 0; k < BOOK_MAX_DEPTH; ++k) {
+            b_ok = create_board(&task->boards[k], width, height) && b_ok;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    if(b_ok) {
+        run_thread_pool(&pool, task_count, build_book_task, tasks);
+    }
+
+    for(int i = 0; i < task_count; ++i) {
+        b_ok = b_ok && !tasks[i].b_out_of_memory;
+        total += tasks[i].entry_count;
+    }
+
+    uint64_t* entries = b_ok ? malloc(sizeof(uint64_t) * (total > 0 ? total : 1)) : NULL;
+    size_t count = 0;
+    size_t conflicts = 0;
+    if(entries != NULL) {
+        for(int i = 0; i < task_count; ++i) {
+            memcpy(entries + count, tasks[i].entries, sizeof(uint64_t) * tasks[i].entry_count);
+            count += tasks[i].entry_count;
+        }
+        qsort(entries, count, sizeof(uint64_t), compare_entry);
+
+        // 같은 key 는 하나만 남김. 수가 다르면 key 충돌
+        size_t unique = 0;
+        for(size_t k = 0; k < count; ++k) {
+            if(unique > 0 && entries[unique - 1] >> BOOK_PLACEMENT_BITS == entries[k] >> BOOK_PLACEMENT_BITS) {
+                conflicts += entries[unique - 1] != entries[k];
+                continue;
+            }
+            entries[unique++] = entries[k];
+        }
+        count = unique;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(entries == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        b_ok = false;
+    } else if(!write_book(path, entries, count, depth, width, height)) {
+        perror(path);
+        b_ok = false;
+    } else {
+        const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+        printf("%s: %zu boards from %zu placements, depth %d, board %dx%d, %zu key conflicts, %.1f s on %d threads\n",
+            path, count, total, depth, width, height, conflicts, seconds, pool.thread_count);
+    }
+
+    free(entries);
+    for(int i = 0; i < task_count; ++i) {
+        free_board(&tasks[i].scratch);
+        for(int k = 0; k < BOOK_MAX_DEPTH; ++k) {
+            free_board(&tasks[i].boards[k]);
+        }
+        free(tasks[i].entries);
+    }
+    free(tasks);
+    free_thread_pool(&pool);
+
+    return b_ok ? 0 : 1;
+}
+
+// header, then the buckets rounded up so that the entries are 8 byte aligned
+static size_t get_entries_offset(uint32_t bucket_bits) {
+    const size_t bucket_size = sizeof(uint32_t) * (((size_t)1 << bucket_bits) + 1);
+    return sizeof(book_header_t) + (bucket_size + 7) / 8 * 8;
+}
+
+// find_book_placement reads entries buckets[b] .. buckets[b + 1] - 1 without checking them
+static bool is_bucket_table_valid(const uint32_t buckets[], uint32_t bucket_bits, uint64_t entry_count) {
+    const size_t bucket_count = (size_t)1 << bucket_bits;
+
+    if(buckets[0] != 0 || buckets[bucket_count] != entry_count) {
+        return false;
+    }
+    for(size_t b = 0; b < bucket_count; ++b) {
+        if(buckets[b] > buckets[b + 1]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// splitmix64 finalizer
+static uint64_t mix_key(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// rotation in bits 0-1, x - PLACEMENT_MIN_X in bits 2-8
+static uint64_t encode_entry(uint64_t key, placement_t placement) {
+    return key | (uint64_t)(placement.rotation & 3) | (uint64_t)(placement.x - PLACEMENT_MIN_X) << 2;
+}
+
+static void build_book_task(void* ctx, int index) {
+    book_task_t* task = &((book_task_t*)ctx)[index];
+    board_t* board = &task->boards[0];
+    double score;
+
+    init_board(board, 0);
+    set_begin_game(&board->game_state, true);
+
+    for(int level = 0; level < BOOK_PREFIX_PIECES; ++level) {
+        if(!spawn_chosen_piece(board, task->prefix[level])) {
+            return;
+        }
+
+        const placement_t placement = find_best_placement(&task->weights, board, &task->scratch, &score);
+        add_book_entry(task, board, placement);
+        if(level + 1 == task->depth || !simulate_placement(board, placement) || board->game_state.b_game_over) {
+            return;
+        }
+    }
+
+    expand_book(task, board, BOOK_PREFIX_PIECES);
+}
+
+// level is the number of pieces already placed on parent
+static void expand_book(book_task_t* task, const board_t* parent, int level) {
+    board_t* board = &task->boards[level - BOOK_PREFIX_PIECES + 1];
+    double score;
+
+    if(level >= task->depth) {
+        return;
+    }
+
+    for(int piece_num = 0; piece_num < 7; ++piece_num) {
+        copy_board(board, parent);
+        if(!spawn_chosen_piece(board, piece_num)) {
+            continue;
+        }
+
+        const placement_t placement = find_best_placement(&task->weights, board, &task->scratch, &score);
+        add_book_entry(task, board, placement);
+        if(simulate_placement(board, placement) && !board->game_state.b_game_over) {
+            expand_book(task, board, level + 1);
+        }
+    }
+}
+
+static void add_book_entry(book_task_t* task, const board_t* board, placement_t placement) {
+    if(task->entry_count == task->entry_capacity) {
+        const size_t capacity = task->entry_capacity > 0 ? task->entry_capacity * 2 : 1024;
+        uint64_t* entries = realloc(task->entries, sizeof(uint64_t) * capacity);
+        if(entries == NULL) {
+            task->b_out_of_memory = true;
+            return;
+        }
+        task->entries = entries;
+        task->entry_capacity = capacity;
+    }
+
+    task->entries[task->entry_count++] = encode_entry(get_book_key(board), placement);
+}
+
+static int compare_entry(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// written next to the target and renamed over it, so a game that opens the book never sees half a file
+static bool write_book(const char* path, const uint64_t entries[], size_t count, int depth, int width, int height) {
+    book_header_t header;
+    char temp_path[4096];
+    uint32_t bits = 1;
+
+    while(((size_t)1 << bits) < count && bits < 28) {
+        ++bits;
+    }
+
+    const size_t bucket_count = ((size_t)1 << bits) + 1;
+    const size_t buckets_size = get_entries_offset(bits) - sizeof(book_header_t);
+    uint32_t* buckets = calloc(1, buckets_size);
+    if(buckets == NULL) {
+        return false;
+    }
+    size_t k = 0;
+    for(size_t b = 0; b < bucket_count; ++b) {
+        while(k < count && (entries[k] >> (64 - bits)) < b) {
+            ++k;
+        }
+        buckets[b] = (uint32_t)k;
+    }
+    buckets[bucket_count - 1] = (uint32_t)count;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "TBOK", 4);
+    header.version = BOOK_VERSION;
+    header.width = width;
+    header.height = height;
+    header.depth = depth;
+    header.bucket_bits = bits;
+    header.entry_count = count;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "wb");
+    bool b_ok = file != NULL;
+    if(file != NULL) {
+        b_ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        b_ok = b_ok && fwrite(buckets, buckets_size, 1, file) == 1;
+        b_ok = b_ok && (count == 0 || fwrite(entries, sizeof(uint64_t) * count, 1, file) == 1);
+        b_ok = fclose(file) == 0 && b_ok;
+    }
+    b_ok = b_ok && rename(temp_path, path) == 0;
+    free(buckets);
+
+    return b_ok;
+}
@@ -0,0 +1,64 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "engine.h"
+#include "bot.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    BOOK_VERSION = 1,
+    BOOK_DEFAULT_DEPTH = 6, // 처음 몇 블록까지 넣을지. 블록마다 경우의 수가 7 배
+    BOOK_MAX_DEPTH = 10,
+    BOOK_PREFIX_PIECES = 2, // build 를 나누는 단위: 처음 두 블록의 49 가지 조합이 각각 task 하나
+    BOOK_PLACEMENT_BITS = 16 // entry 의 아래 16 bit 는 수, 위 48 bit 는 key
+};
+
+// file: header, bucket array, entries sorted by key. bucket b holds the entries whose key starts with the
+// bucket_bits bits of b, entries buckets[b] .. buckets[b + 1] - 1
+typedef struct book_header_t {
+    char magic[4]; // "TBOK"
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t depth; // g_pieces 가 이 값 이하일 때만 찾음
+    uint32_t bucket_bits;
+    uint64_t entry_count;
+} book_header_t;
+
+// one build task: the first BOOK_PREFIX_PIECES pieces are fixed, the rest of the tree below them is searched depth first
+typedef struct book_task_t {
+    int prefix[BOOK_PREFIX_PIECES];
+    int depth;
+    bot_weights_t weights;
+    board_t boards[BOOK_MAX_DEPTH]; // 깊이마다 하나, 위 단계의 board 를 복사해서 사용
+    board_t scratch;
+    uint64_t* entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    bool b_out_of_memory;
+} book_task_t;
+
+// opened read-only with mmap, so every game in the process shares the same pages and a lookup does no syscall
+typedef struct book_t {
+    const unsigned char* map;
+    size_t size;
+    const book_header_t* header;
+    const uint32_t* buckets;
+    const uint64_t* entries;
+} book_t;
+
+// book functions
+
+bool open_book(book_t* self, const char* path);
+void close_book(book_t* self);
+bool find_book_placement(const book_t* self, const board_t* board, placement_t* placement);
+uint64_t get_book_key(const board_t* board);
+int run_build_book(const char* path, int depth, int thread_count, int width, int height);
+
+#endif /* BOOK_H */
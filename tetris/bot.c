@@ -0,0 +1,170 @@
+#include <float.h>
+#include <stdbool.h>
+#include "engine.h"
+#include "board_features.h"
+#include "bot.h"
+#include "book.h"
+#include "mcts.h"
+
+enum {
+    SIMULATION_TICK_LIMIT = 4000 // 블록 하나가 놓일 때까지 최대 tick
+};
+
+// --------------------------------------------------
+// bot_t functions
+// --------------------------------------------------
+
+// the scratch board has the size of the boards the bot will play
+bool init_bot(bot_t* self, int width, int height) {
+    reset_bot(self);
+    self->mcts = NULL;
+    self->book = NULL;
+
+    return create_board(&self->scratch, width, height);
+}
+
+// weights and plan as at the start of a game, the scratch board is kept
+void reset_bot(bot_t* self) {
+    self->weights.height = -0.51;
+    self->weights.lines = 0.76;
+    self->weights.holes = -0.36;
+    self->weights.bumpiness = -0.18;
+    self->planned_piece = -1;
+    self->target.rotation = 0;
+    self->target.x = 0;
+    self->rotations_done = 0;
+}
+
+void free_bot(bot_t* self) {
+    free_board(&self->scratch);
+}
+
+// keys for this tick. a new plan is made once per piece, the tick after it spawned
+void get_bot_input(bot_t* self, const board_t* board, input_t* input) {
+    const game_state_t* game_state = &board->game_state;
+    input->down = 0;
+    input->pressed = 0;
+
+    if(game_state->b_game_over || game_state->b_pause || game_state->b_line_to_delete || !game_state->b_piece_active) {
+        return;
+    }
+
+    if(self->planned_piece != game_state->g_pieces) {
+        double score;
+        if(self->book == NULL || !find_book_placement(self->book, board, &self->target)) {
+            self->target = self->mcts != NULL ? search_mcts(self->mcts, board) : find_best_placement(&self->weights, board, &self->scratch, &score);
+        }
+        self->planned_piece = game_state->g_pieces;
+        self->rotations_done = 0;
+    }
+
+    get_placement_input(board, self->target, &self->rotations_done, input);
+}
+
+// tries every rotation and column on scratch, a copy of the board, with the same keys the bot would press
+placement_t find_best_placement(const bot_weights_t* weights, const board_t* board, board_t* scratch, double* best_score) {
+    placement_t best = { 0, board->game_state.piece_position_x };
+    *best_score = -DBL_MAX;
+
+    for(int rotation = 0; rotation < 4; ++rotation) {
+        for(int x = PLACEMENT_MIN_X; x <= board->width; ++x) {
+            placement_t target = { rotation, x };
+
+            copy_board(scratch, board);
+            if(!simulate_placement(scratch, target) || scratch->game_state.b_game_over) {
+                continue;
+            }
+
+            const double score = evaluate_grid(weights, scratch);
+            if(score > *best_score) {
+                *best_score = score;
+                best = target;
+            }
+        }
+    }
+
+    return best;
+}
+
+// turn, then shift one column per tick, then hard drop
+void get_placement_input(const board_t* board, placement_t target, int* rotations_done, input_t* input) {
+    const int x = board->game_state.piece_position_x;
+    input->down = 0;
+    input->pressed = 0;
+
+    if(*rotations_done < target.rotation) {
+        input->down = INPUT_UP;
+        input->pressed = INPUT_UP;
+        ++(*rotations_done);
+    } else if(x < target.x) {
+        input->down = INPUT_RIGHT;
+        input->pressed = INPUT_RIGHT;
+    } else if(x > target.x) {
+        input->down = INPUT_LEFT;
+        input->pressed = INPUT_LEFT;
+    } else {
+        input->down = INPUT_SPACE;
+    }
+}
+
+// plays the piece until it locks. false when the target column cannot be reached
+bool simulate_placement(board_t* board, placement_t target) {
+    int rotations_done = 0;
+    input_t input;
+
+    for(int tick = 0; tick < SIMULATION_TICK_LIMIT; ++tick) {
+        if(!board->game_state.b_piece_active || board->game_state.b_game_over) {
+            return true;
+        }
+
+        const int x = board->game_state.piece_position_x;
+        get_placement_input(board, target, &rotations_done, &input);
+        step_board(board, input);
+
+        if((input.down & (INPUT_LEFT | INPUT_RIGHT)) && board->game_state.b_piece_active && board->game_state.piece_position_x == x) {
+            return false; // 벽이나 블록에 막힘
+        }
+    }
+
+    return false;
+}
+
+// lets the cleared lines fade out and the next piece spawn. false when the game ended instead
+bool wait_next_piece(board_t* board) {
+    for(int tick = 0; tick < SIMULATION_TICK_LIMIT; ++tick) {
+        if(board->game_state.b_piece_active || board->game_state.b_game_over) {
+            return board->game_state.b_piece_active;
+        }
+
+        const input_t input = { 0, 0 };
+        step_board(board, input);
+    }
+
+    return false;
+}
+
+// the next piece is piece_num instead of a random one: it is put in the incoming slot before the tick that spawns it.
+// false when it does not fit
+bool spawn_chosen_piece(board_t* board, int piece_num) {
+    const input_t input = { 0, 0 };
+
+    for(int tick = 0; tick <= FADING_TIME && board->game_state.b_line_to_delete; ++tick) {
+        step_board(board, input);
+    }
+
+    set_begin_play(&board->game_state, false);
+    set_piece_shape(board->incoming_piece, piece_num);
+    set_current_piece_num(&board->game_state, piece_num);
+    step_board(board, input);
+
+    return board->game_state.b_piece_active && !board->game_state.b_game_over;
+}
+
+// rows marked FADING are about to be deleted, so they count as cleared lines and are skipped
+double evaluate_grid(const bot_weights_t* weights, const board_t* board) {
+    board_features_t features;
+
+    extract_features(board, 1, &features);
+
+    return weights->height * features.aggregate_height + weights->lines * features.lines + weights->holes * features.holes + weights->bumpiness * features.bumpiness;
+}
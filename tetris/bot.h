@@ -0,0 +1,54 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    PLACEMENT_MIN_X = -2 // piece_position_x 는 4x4 틀 기준이라 음수가 될 수 있음. 최대는 board 의 width
+};
+
+// weights of the static evaluation. bigger score is better
+typedef struct bot_weights_t {
+    double height;
+    double lines;
+    double holes;
+    double bumpiness;
+} bot_weights_t;
+
+// a target pose. the piece is turned first, then shifted, then hard dropped
+typedef struct placement_t {
+    int rotation;
+    int x;
+} placement_t;
+
+struct mcts_t;
+struct book_t;
+
+typedef struct bot_t {
+    bot_weights_t weights;
+    int planned_piece; // plan 이 만들어진 시점의 g_pieces
+    placement_t target;
+    int rotations_done;
+    board_t scratch; // 후보 수를 시험해보는 board
+    struct mcts_t* mcts; // NULL 이면 정적 평가로 수를 고름
+    const struct book_t* book; // 있으면 처음 블록들은 book 에서 찾음
+} bot_t;
+
+// bot_t functions
+
+bool init_bot(bot_t* self, int width, int height);
+void free_bot(bot_t* self);
+void reset_bot(bot_t* self);
+void get_bot_input(bot_t* self, const board_t* board, input_t* input);
+placement_t find_best_placement(const bot_weights_t* weights, const board_t* board, board_t* scratch, double* best_score);
+void get_placement_input(const board_t* board, placement_t target, int* rotations_done, input_t* input);
+bool simulate_placement(board_t* board, placement_t target);
+bool wait_next_piece(board_t* board);
+bool spawn_chosen_piece(board_t* board, int piece_num);
+double evaluate_grid(const bot_weights_t* weights, const board_t* board);
+
+#endif /* BOT_H */
@@ -0,0 +1,425 @@
+// headless game for external engines. line based protocol, one message per line
+//
+// server -> bot
+//   tetris 2
+//   board <width> <height>
+//   state <pieces> <piece> <next> <hold> <level> <lines> <garbage> <x> <y> <row masks>
+//   gameover <lines> <pieces> <ticks>
+//   error <message>
+// bot -> server
+//   place <rotation> <x>    turn, shift to piece_position_x == x, hard drop
+//   keys <LRUDS.>           one key per tick, '.' waits a tick
+//   restart [seed]          after gameover
+//   quit
+//
+// row masks are <height> hex numbers of up to 64 bits, top row first, bit 0 = leftmost column. x goes up to <width>.
+// the moving piece is not in the masks; it is <piece> with its 4x4 frame at <x> <y>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "engine.h"
+#include "bot.h"
+#include "bot_server.h"
+
+typedef enum command_type {
+    COMMAND_NONE,
+    COMMAND_PLACE,
+    COMMAND_KEYS,
+    COMMAND_RESTART,
+    COMMAND_QUIT
+} command_type_t;
+
+static void init_connection(bot_connection_t* self, int in_fd, int out_fd);
+static char* read_line(bot_connection_t* self);
+static void write_text(bot_connection_t* self, const char* text);
+static void write_int(bot_connection_t* self, int value);
+static void write_hex(bot_connection_t* self, uint64_t value);
+static bool flush_connection(bot_connection_t* self);
+static void write_state(bot_connection_t* self, board_t* board);
+static command_type_t read_command(bot_connection_t* self, int width, placement_t* placement, input_t keys[], int* key_count, unsigned int* seed);
+static void serve_connection(bot_connection_t* self, unsigned int seed, int width, int height);
+static int open_listen_socket(const char* socket_path);
+
+// --------------------------------------------------
+// bot_server functions
+// --------------------------------------------------
+
+// serves stdin/stdout when socket_path is NULL, otherwise one client at a time on a unix socket
+int run_bot_server(const char* socket_path, unsigned int seed, int width, int height) {
+    bot_connection_t* connection = malloc(sizeof(bot_connection_t));
+
+    // 먼저 끊은 client 에 쓰면 SIGPIPE 대신 EPIPE 로 그 연결만 닫음
+    signal(SIGPIPE, SIG_IGN);
+    if(connection == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        return 1;
+    }
+
+    if(socket_path == NULL) {
+        init_connection(connection, STDIN_FILENO, STDOUT_FILENO);
+        serve_connection(connection, seed, width, height);
+        free(connection);
+        return 0;
+    }
+
+    const int listen_fd = open_listen_socket(socket_path);
+    if(listen_fd < 0) {
+        perror(socket_path);
+        free(connection);
+        return 1;
+    }
+
+    for(;;) {
+        const int client_fd = accept(listen_fd, NULL, NULL);
+        if(client_fd < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+
+        init_connection(connection, client_fd, client_fd);
+        serve_connection(connection, seed, width, height);
+        close(client_fd);
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    free(connection);
+
+    return 1;
+}
+
+static void init_connection(bot_connection_t* self, int in_fd, int out_fd) {
+    self->in_fd = in_fd;
+    self->out_fd = out_fd;
+    self->in_length = 0;
+    self->in_position = 0;
+    self->b_discarding = false;
+    self->out_length = 0;
+}
+
+// next line without the newline, terminated in place. NULL on end of input.
+// a line longer than the buffer is skipped up to its newline and answered with an error
+static char* read_line(bot_connection_t* self) {
+    for(;;) {
+        char* begin = self->in_buffer + self->in_position;
+        char* newline = memchr(begin, '\n', self->in_length - self->in_position);
+
+        if(newline != NULL && self->b_discarding) {
+            self->in_position = newline - self->in_buffer + 1;
+            self->b_discarding = false;
+            write_text(self, "error line too long\n");
+            flush_connection(self);
+            continue;
+        }
+        if(newline != NULL) {
+            *newline = '\0';
+            if(newline > begin && newline[-1] == '\r') {
+                newline[-1] = '\0';
+            }
+            self->in_position = newline - self->in_buffer + 1;
+            return begin;
+        }
+
+        // 남은 부분을 앞으로 당기고 더 읽음
+        const int rest = self->in_length - self->in_position;
+        memmove(self->in_buffer, begin, rest);
+        self->in_length = rest;
+        self->in_position = 0;
+
+        if(self->in_length == BOT_SERVER_IN_BUFFER_SIZE || self->b_discarding) {
+            self->in_length = 0;
+            self->b_discarding = true;
+        }
+
+        const ssize_t count = read(self->in_fd, self->in_buffer + self->in_length, BOT_SERVER_IN_BUFFER_SIZE - self->in_length);
+        if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        if(count <= 0) {
+            return NULL;
+        }
+        self->in_length += count;
+    }
+}
+
+// messages are only appended here. one write call per flush
+static void write_text(bot_connection_t* self, const char* text) {
+    const int length = strlen(text);
+
+    if(self->out_length + length > BOT_SERVER_OUT_BUFFER_SIZE) {
+        flush_connection(self);
+    }
+
+    memcpy(self->out_buffer + self->out_length, text, length);
+    self->out_length += length;
+}
+
+static void write_int(bot_connection_t* self, int value) {
+    char text[16];
+    char* p = text + sizeof(text) - 1;
+    const bool b_negative = value < 0;
+    unsigned int rest = b_negative ? -(unsigned int)value : (unsigned int)value;
+
+    *p = '\0';
+    do {
+        *--p = '0' + rest % 10;
+        rest /= 10;
+    } while(rest != 0);
+    if(b_negative) {
+        *--p = '-';
+    }
+
+    write_text(self, p);
+}
+
+static void write_hex(bot_connection_t* self, uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    char text[20];
+    char* p = text + sizeof(text) - 1;
+
+    *p = '\0';
+    do {
+        *--p = digits[value & 0xf];
+        value >>= 4;
+    } while(value != 0);
+
+    write_text(self, p);
+}
+
+static bool flush_connection(bot_connection_t* self) {
+    int written = 0;
+
+    while(written < self->out_length) {
+        const ssize_t count = write(self->out_fd, self->out_buffer + written, self->out_length - written);
+        if(count < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            self->out_length = 0;
+            return false;
+        }
+        written += count;
+    }
+
+    self->out_length = 0;
+    return true;
+}
+
+static void write_state(bot_connection_t* self, board_t* board) {
+    const game_state_t* game_state = &board->game_state;
+    uint64_t masks[board->height];
+
+    get_row_masks(board, masks);
+
+    write_text(self, "state ");
+    write_int(self, game_state->g_pieces);
+    write_text(self, " ");
+    write_int(self, game_state->finished_piece_num);
+    write_text(self, " ");
+    write_int(self, game_state->current_piece_num);
+    write_text(self, " ");
+    write_int(self, game_state->hold_piece_num);
+    write_text(self, " ");
+    write_int(self, game_state->g_level);
+    write_text(self, " ");
+    write_int(self, game_state->g_lines);
+    write_text(self, " ");
+    write_int(self, board->pending_garbage);
+    write_text(self, " ");
+    write_int(self, game_state->piece_position_x);
+    write_text(self, " ");
+    write_int(self, game_state->piece_position_y);
+    for(int i = 0; i < board->height; ++i) {
+        write_text(self, " ");
+        write_hex(self, masks[i]);
+    }
+    write_text(self, "\n");
+}
+
+// COMMAND_NONE means the input has ended
+static command_type_t read_command(bot_connection_t* self, int width, placement_t* placement, input_t keys[], int* key_count, unsigned int* seed) {
+    char* line;
+
+    while((line = read_line(self)) != NULL) {
+        if(strncmp(line, "place ", 6) == 0) {
+            if(sscanf(line + 6, "%d %d", &placement->rotation, &placement->x) == 2 &&
+                placement->rotation >= 0 && placement->rotation < 4 &&
+                placement->x >= PLACEMENT_MIN_X && placement->x <= width) {
+                return COMMAND_PLACE;
+            }
+        } else if(strncmp(line, "keys ", 5) == 0) {
+            bool b_valid = true;
+            *key_count = 0;
+
+            for(const char* key = line + 5; *key != '\0' && *key_count < BOT_SERVER_MAX_KEYS; ++key) {
+                input_t* input = &keys[(*key_count)++];
+                input->down = 0;
+                input->pressed = 0;
+
+                switch(*key) {
+                    case 'L':
+                        input->down = INPUT_LEFT;
+                        input->pressed = INPUT_LEFT;
+                        break;
+                    case 'R':
+                        input->down = INPUT_RIGHT;
+                        input->pressed = INPUT_RIGHT;
+                        break;
+                    case 'U':
+                        input->down = INPUT_UP;
+                        input->pressed = INPUT_UP;
+                        break;
+                    case 'D':
+                        input->down = INPUT_DOWN;
+                        break;
+                    case 'S':
+                        input->down = INPUT_SPACE;
+                        break;
+                    case '.':
+                        break;
+                    default:
+                        b_valid = false;
+                        break;
+                }
+            }
+
+            if(b_valid) {
+                return COMMAND_KEYS;
+            }
+        } else if(strncmp(line, "restart", 7) == 0) {
+            sscanf(line + 7, "%u", seed);
+            return COMMAND_RESTART;
+        } else if(strcmp(line, "quit") == 0) {
+            return COMMAND_QUIT;
+        }
+
+        write_text(self, "error bad command\n");
+        flush_connection(self);
+    }
+
+    return COMMAND_NONE;
+}
+
+// asks for a move once per piece and plays it without waiting for the bot again
+static void serve_connection(bot_connection_t* self, unsigned int seed, int width, int height) {
+    board_t* board = malloc(sizeof(board_t));
+    input_t* keys = malloc(sizeof(input_t) * BOT_SERVER_MAX_KEYS);
+    command_type_t command = COMMAND_NONE;
+    placement_t placement = { 0, 0 };
+    int key_count = 0;
+    int key_index = 0;
+    int rotations_done = 0;
+    long ticks = 0;
+
+    if(board == NULL || keys == NULL || !create_board(board, width, height)) {
+        free(board);
+        free(keys);
+        return;
+    }
+
+    write_text(self, "tetris 2\nboard ");
+    write_int(self, width);
+    write_text(self, " ");
+    write_int(self, height);
+    write_text(self, "\n");
+
+    for(;;) {
+        init_board(board, seed);
+        set_begin_game(&board->game_state, true);
+        int asked_piece = -1;
+        ticks = 0;
+
+        while(!board->game_state.b_game_over) {
+            input_t input = { 0, 0 };
+
+            if(board->game_state.b_piece_active && !board->game_state.b_line_to_delete && asked_piece != board->game_state.g_pieces) {
+                write_state(self, board);
+                if(!flush_connection(self)) {
+                    goto done;
+                }
+
+                command = read_command(self, width, &placement, keys, &key_count, &seed);
+                if(command == COMMAND_NONE || command == COMMAND_QUIT) {
+                    goto done;
+                }
+                if(command == COMMAND_RESTART) {
+                    break;
+                }
+
+                asked_piece = board->game_state.g_pieces;
+                key_index = 0;
+                rotations_done = 0;
+            }
+
+            if(board->game_state.b_piece_active && !board->game_state.b_line_to_delete) {
+                if(command == COMMAND_PLACE) {
+                    get_placement_input(board, placement, &rotations_done, &input);
+                } else if(key_index < key_count) {
+                    input = keys[key_index++];
+                }
+            }
+
+            step_board(board, input);
+            ++ticks;
+        }
+
+        if(command == COMMAND_RESTART) {
+            command = COMMAND_NONE;
+            continue;
+        }
+
+        write_text(self, "gameover ");
+        write_int(self, board->game_state.g_lines);
+        write_text(self, " ");
+        write_int(self, board->game_state.g_pieces);
+        write_text(self, " ");
+        write_int(self, (int)ticks);
+        write_text(self, "\n");
+        if(!flush_connection(self)) {
+            break;
+        }
+
+        command = read_command(self, width, &placement, keys, &key_count, &seed);
+        if(command != COMMAND_RESTART) {
+            break;
+        }
+        command = COMMAND_NONE;
+    }
+
+done:
+    free_board(board);
+    free(board);
+    free(keys);
+}
+
+static int open_listen_socket(const char* socket_path) {
+    struct sockaddr_un address;
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+    unlink(socket_path);
+
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
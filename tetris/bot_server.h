@@ -0,0 +1,33 @@
+#ifndef BOT_SERVER_H
+#define BOT_SERVER_H
+
+#include <stdbool.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    BOT_SERVER_IN_BUFFER_SIZE = 4096,
+    BOT_SERVER_OUT_BUFFER_SIZE = 4096,
+    BOT_SERVER_MAX_KEYS = 256 // keys 명령 한 번에 보낼 수 있는 최대 키 수
+};
+
+// one connected engine. both buffers are allocated once with the connection
+typedef struct bot_connection_t {
+    int in_fd;
+    int out_fd;
+    char in_buffer[BOT_SERVER_IN_BUFFER_SIZE];
+    int in_length;
+    int in_position;
+    bool b_discarding; // 버퍼보다 긴 줄을 다음 '\n' 까지 버리는 중
+    char out_buffer[BOT_SERVER_OUT_BUFFER_SIZE];
+    int out_length;
+} bot_connection_t;
+
+// bot_server functions
+
+int run_bot_server(const char* socket_path, unsigned int seed, int width, int height);
+
+#endif /* BOT_SERVER_H */
@@ -0,0 +1,191 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "engine.h"
+#include "io.h"
+#include "dataset.h"
+
+static const uint32_t column_widths[COLUMN_COUNT] = {
+    sizeof(uint16_t) * BOARD_DEFAULT_HEIGHT,
+    sizeof(int8_t),
+    sizeof(int8_t),
+    sizeof(int8_t),
+    sizeof(int8_t),
+    sizeof(uint8_t),
+    sizeof(int32_t),
+    sizeof(uint32_t)
+};
+
+static bool flush_group(dataset_writer_t* self);
+static bool is_header_valid(const dataset_header_t* header, size_t size);
+
+// --------------------------------------------------
+// dataset functions
+// --------------------------------------------------
+
+bool open_dataset_writer(dataset_writer_t* self, const char* path) {
+    dataset_header_t* header = &self->header;
+    uint64_t offset = 0;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "TCOL", 4);
+    header->version = DATASET_VERSION;
+    header->group_rows = DATASET_GROUP_ROWS;
+    header->column_count = COLUMN_COUNT;
+    for(int i = 0; i < COLUMN_COUNT; ++i) {
+        header->column_width[i] = column_widths[i];
+        header->column_offset[i] = offset;
+        offset += (uint64_t)column_widths[i] * DATASET_GROUP_ROWS;
+        offset = (offset + DATASET_ALIGN - 1) / DATASET_ALIGN * DATASET_ALIGN;
+    }
+    header->group_size = offset;
+
+    self->group_length = 0;
+    self->group = aligned_alloc(DATASET_ALIGN, header->group_size);
+    if(self->group == NULL) {
+        return false;
+    }
+    memset(self->group, 0, header->group_size);
+
+    self->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(self->fd < 0) {
+        free(self->group);
+        return false;
+    }
+
+    return true;
+}
+
+// the row is split into the column arrays of the open group
+bool append_dataset_row(dataset_writer_t* self, const dataset_row_t* row) {
+    const dataset_header_t* header = &self->header;
+    const uint32_t index = self->group_length;
+    unsigned char* group = self->group;
+
+    memcpy(group + header->column_offset[COLUMN_BOARD] + (size_t)index * column_widths[COLUMN_BOARD], row->board, column_widths[COLUMN_BOARD]);
+    ((int8_t*)(group + header->column_offset[COLUMN_PIECE]))[index] = row->piece;
+    ((int8_t*)(group + header->column_offset[COLUMN_NEXT]))[index] = row->next;
+    ((int8_t*)(group + header->column_offset[COLUMN_ROTATION]))[index] = row->rotation;
+    ((int8_t*)(group + header->column_offset[COLUMN_X]))[index] = row->x;
+    ((uint8_t*)(group + header->column_offset[COLUMN_LINES_CLEARED]))[index] = row->lines_cleared;
+    ((int32_t*)(group + header->column_offset[COLUMN_OUTCOME]))[index] = row->outcome;
+    ((uint32_t*)(group + header->column_offset[COLUMN_GAME]))[index] = row->game;
+
+    ++(self->group_length);
+    ++(self->header.row_count);
+
+    if(self->group_length == DATASET_GROUP_ROWS) {
+        return flush_group(self);
+    }
+
+    return true;
+}
+
+// the last group is written in full, the header's row_count says where the data ends
+bool close_dataset_writer(dataset_writer_t* self) {
+    bool b_ok = true;
+
+    if(self->group_length > 0) {
+        b_ok = flush_group(self);
+    }
+
+    const uint64_t group_count = (self->header.row_count + DATASET_GROUP_ROWS - 1) / DATASET_GROUP_ROWS;
+    b_ok = (ftruncate(self->fd, DATASET_HEADER_SIZE + group_count * self->header.group_size) == 0) && b_ok;
+    b_ok = pwrite_all(self->fd, &self->header, sizeof(self->header), 0) && b_ok;
+    b_ok = (close(self->fd) == 0) && b_ok;
+    free(self->group);
+
+    return b_ok;
+}
+
+bool open_dataset_reader(dataset_reader_t* self, const char* path) {
+    struct stat status;
+    const int fd = open(path, O_RDONLY);
+
+    if(fd < 0) {
+        return false;
+    }
+    if(fstat(fd, &status) != 0 || (size_t)status.st_size < DATASET_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+
+    self->size = status.st_size;
+    self->map = mmap(NULL, self->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(self->map == MAP_FAILED) {
+        return false;
+    }
+
+    memcpy(&self->header, self->map, sizeof(self->header));
+    if(!is_header_valid(&self->header, self->size)) {
+        munmap((void*)self->map, self->size);
+        return false;
+    }
+
+    // 대부분 앞에서부터 끝까지 읽음
+    madvise((void*)self->map, self->size, MADV_SEQUENTIAL);
+
+    return true;
+}
+
+void close_dataset_reader(dataset_reader_t* self) {
+    munmap((void*)self->map, self->size);
+}
+
+uint64_t get_dataset_group_count(const dataset_reader_t* self) {
+    return (self->header.row_count + self->header.group_rows - 1) / self->header.group_rows;
+}
+
+// pointer straight into the mapping. row_count gets the number of valid rows in this group
+const void* get_dataset_column(const dataset_reader_t* self, dataset_column_t column, uint64_t group, uint32_t* row_count) {
+    const dataset_header_t* header = &self->header;
+    const uint64_t first_row = group * header->group_rows;
+
+    if(group >= get_dataset_group_count(self)) {
+        *row_count = 0;
+        return NULL;
+    }
+
+    *row_count = header->row_count - first_row < header->group_rows ? (uint32_t)(header->row_count - first_row) : header->group_rows;
+
+    return self->map + DATASET_HEADER_SIZE + group * header->group_size + header->column_offset[column];
+}
+
+static bool flush_group(dataset_writer_t* self) {
+    const uint64_t group = (self->header.row_count - 1) / DATASET_GROUP_ROWS;
+    const bool b_ok = pwrite_all(self->fd, self->group, self->header.group_size, DATASET_HEADER_SIZE + group * self->header.group_size);
+
+    memset(self->group, 0, self->header.group_size);
+    self->group_length = 0;
+
+    return b_ok;
+}
+
+// everything get_dataset_column relies on. the header is checked before any of its sizes is multiplied
+static bool is_header_valid(const dataset_header_t* header, size_t size) {
+    if(memcmp(header->magic, "TCOL", 4) != 0 || header->version != DATASET_VERSION || header->column_count != COLUMN_COUNT ||
+        header->group_rows == 0 || header->group_size == 0) {
+        return false;
+    }
+
+    // 곱셈이 넘치지 않게 나눗셈으로 비교
+    const uint64_t group_count = header->row_count / header->group_rows + (header->row_count % header->group_rows != 0);
+    if(group_count > (size - DATASET_HEADER_SIZE) / header->group_size) {
+        return false;
+    }
+
+    for(int i = 0; i < COLUMN_COUNT; ++i) {
+        if(header->column_width[i] != column_widths[i] || header->column_offset[i] > header->group_size ||
+            (uint64_t)header->column_width[i] * header->group_rows > header->group_size - header->column_offset[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
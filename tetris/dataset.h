@@ -0,0 +1,78 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    DATASET_VERSION = 1,
+    DATASET_HEADER_SIZE = 4096, // column 이 page 경계에서 시작하도록
+    DATASET_ALIGN = 64,
+    DATASET_GROUP_ROWS = 1 << 16 // row group 하나의 행 수
+};
+
+typedef enum dataset_column {
+    COLUMN_BOARD, // uint16_t[BOARD_DEFAULT_HEIGHT] row masks, top row first. only the standard board size
+    COLUMN_PIECE, // int8_t
+    COLUMN_NEXT, // int8_t
+    COLUMN_ROTATION, // int8_t, chosen placement
+    COLUMN_X, // int8_t, chosen placement
+    COLUMN_LINES_CLEARED, // uint8_t, by this placement
+    COLUMN_OUTCOME, // int32_t, lines the game still cleared from here on
+    COLUMN_GAME, // uint32_t
+    COLUMN_COUNT
+} dataset_column_t;
+
+typedef struct dataset_row_t {
+    uint16_t board[BOARD_DEFAULT_HEIGHT];
+    int8_t piece;
+    int8_t next;
+    int8_t rotation;
+    int8_t x;
+    uint8_t lines_cleared;
+    int32_t outcome;
+    uint32_t game;
+} dataset_row_t;
+
+// the file is a header and full row groups. inside a group every column is one aligned, fixed width array
+typedef struct dataset_header_t {
+    char magic[4]; // "TCOL"
+    uint32_t version;
+    uint64_t row_count;
+    uint32_t group_rows;
+    uint32_t column_count;
+    uint64_t group_size;
+    uint32_t column_width[COLUMN_COUNT];
+    uint64_t column_offset[COLUMN_COUNT]; // group 시작 기준
+} dataset_header_t;
+
+typedef struct dataset_writer_t {
+    int fd;
+    dataset_header_t header;
+    unsigned char* group; // 채우는 중인 row group
+    uint32_t group_length;
+} dataset_writer_t;
+
+typedef struct dataset_reader_t {
+    const unsigned char* map;
+    size_t size;
+    dataset_header_t header;
+} dataset_reader_t;
+
+// dataset functions
+
+bool open_dataset_writer(dataset_writer_t* self, const char* path);
+bool append_dataset_row(dataset_writer_t* self, const dataset_row_t* row);
+bool close_dataset_writer(dataset_writer_t* self);
+bool open_dataset_reader(dataset_reader_t* self, const char* path);
+void close_dataset_reader(dataset_reader_t* self);
+uint64_t get_dataset_group_count(const dataset_reader_t* self);
+const void* get_dataset_column(const dataset_reader_t* self, dataset_column_t column, uint64_t group, uint32_t* row_count);
+
+#endif /* DATASET_H */
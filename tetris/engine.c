@@ -0,0 +1,947 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gamedata.h"
+#include "engine.h"
+
+// grid kernels take the row width as their first argument. they are inlined into every step function below,
+// so in the specialized ones the width is a constant and the column loops have fixed trip counts
+#define KERNEL static inline __attribute__((always_inline))
+
+static void step_board_10(board_t* self, input_t input);
+static void step_board_16(board_t* self, input_t input);
+static void step_board_32(board_t* self, input_t input);
+static void step_board_64(board_t* self, input_t input);
+static void step_board_any(board_t* self, input_t input);
+static void init_grid(const int width, const int height, grid_square_t grid[][width + 2], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], grid_square_t piece[4][4]);
+KERNEL void apply_garbage(const int width, const int height, grid_square_t grid[][width + 2], int lines, int* top_row, int* garbage_rows, unsigned int* garbage_rng_state, bool b_whole_grid);
+KERNEL void step_board_rows(board_t* self, input_t input, const int width, bool b_whole_grid);
+KERNEL void get_scan_rows(const board_t* self, bool b_whole_grid, int* first_row, int* last_row);
+static void resolve_level(game_state_t* game_state);
+KERNEL void save_color(const int width, grid_square_t grid[][width + 2], const int piece_num, int first_row, int last_row);
+KERNEL void check_detection(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row);
+KERNEL void resolve_falling_movement(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row);
+KERNEL bool resolve_lateral_movement(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, input_t input, int first_row, int last_row);
+KERNEL bool resolve_turn_movement(const int width, grid_square_t grid[][width + 2], grid_square_t piece[4][4], game_state_t* game_state, input_t input, int first_row, int last_row);
+KERNEL int delete_complete_lines(const int width, const int height, grid_square_t grid[][width + 2], int* top_row, int* garbage_rows, bool b_whole_grid);
+KERNEL int shift_complete_lines(const int width, const int height, grid_square_t grid[][width + 2], int* garbage_rows);
+KERNEL void resolve_top_row(board_t* self);
+KERNEL void check_completion(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row);
+KERNEL bool create_piece(const int width, grid_square_t grid[][width + 2], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, unsigned int* rng_state);
+static int get_random_piece(grid_square_t incoming_piece[4][4], unsigned int* rng_state);
+
+// --------------------------------------------------
+// board functions
+// --------------------------------------------------
+
+bool is_board_size_valid(int width, int height) {
+    return width >= BOARD_MIN_WIDTH && width <= BOARD_MAX_WIDTH && height >= BOARD_MIN_HEIGHT && height <= BOARD_MAX_HEIGHT;
+}
+
+// allocates the grid and picks the step function for the width. init_board starts a game on it
+bool create_board(board_t* self, int width, int height) {
+    // padding 까지 0 이어야 is_same_board 의 memcmp 가 맞음
+    memset(self, 0, sizeof(board_t));
+
+    if(!is_board_size_valid(width, height)) {
+        return false;
+    }
+
+    self->width = width;
+    self->height = height;
+    self->cells = malloc(sizeof(grid_square_t) * get_cell_count(self));
+    if(self->cells == NULL) {
+        return false;
+    }
+    self->grid = self->cells + BOARD_PAD_ROWS_ABOVE * (width + 2);
+
+    switch(width) {
+        case 10:
+            self->step = step_board_10;
+            break;
+        case 16:
+            self->step = step_board_16;
+            break;
+        case 32:
+            self->step = step_board_32;
+            break;
+        case 64:
+            self->step = step_board_64;
+            break;
+        default:
+            self->step = step_board_any;
+            break;
+    }
+
+    return true;
+}
+
+void free_board(board_t* self) {
+    free(self->cells);
+    self->cells = NULL;
+    self->grid = NULL;
+}
+
+// both boards must have the same size. self keeps its own grid
+void copy_board(board_t* self, const board_t* other) {
+    grid_square_t* cells = self->cells;
+
+    assert(self->width == other->width && self->height == other->height);
+
+    memcpy(cells, other->cells, sizeof(grid_square_t) * get_cell_count(other));
+    *self = *other;
+    self->cells = cells;
+    self->grid = cells + BOARD_PAD_ROWS_ABOVE * (self->width + 2);
+}
+
+// every field and every cell, the pad rows too
+bool is_same_board(const board_t* self, const board_t* other) {
+    return self->width == other->width && self->height == other->height &&
+        memcmp(self->cells, other->cells, sizeof(grid_square_t) * get_cell_count(self)) == 0 &&
+        memcmp(self->incoming_piece, other->incoming_piece, sizeof(self->incoming_piece)) == 0 &&
+        memcmp(self->hold_piece, other->hold_piece, sizeof(self->hold_piece)) == 0 &&
+        memcmp(self->piece, other->piece, sizeof(self->piece)) == 0 &&
+        memcmp(&self->game_state, &other->game_state, sizeof(game_state_t)) == 0 &&
+        memcmp(&self->counter, &other->counter, sizeof(counter_t)) == 0 &&
+        self->rng_state == other->rng_state && self->garbage_rng_state == other->garbage_rng_state &&
+        self->pending_garbage == other->pending_garbage && self->b_stray_moving == other->b_stray_moving &&
+        self->top_row == other->top_row && self->garbage_rows == other->garbage_rows && self->dig_rows == other->dig_rows &&
+        self->dug_rows == other->dug_rows;
+}
+
+// initialize game variables. same seed gives the same piece sequence
+void init_board(board_t* self, unsigned int seed) {
+    reset_game_state(&self->game_state);
+    reset_counter(&self->counter);
+    init_grid(self->width, self->height, (grid_square_t (*)[self->width + 2])self->grid, self->incoming_piece, self->hold_piece, self->piece);
+
+    // xorshift 은 0 에서 멈추므로 seed 를 섞어서 사용
+    self->rng_state = seed * 2654435761u ^ 0x9e3779b9u;
+    if(self->rng_state == 0) {
+        self->rng_state = 0x9e3779b9u;
+    }
+    self->garbage_rng_state = self->rng_state ^ 0x85ebca6bu;
+    self->pending_garbage = self->dig_rows; // dig mode 는 첫 블록 전에 garbage 를 채움
+    self->garbage_rows = 0;
+    self->dug_rows = 0;
+    self->top_row = self->height;
+    self->b_stray_moving = false;
+}
+
+// one frame of game logic. this is what update_draw_frame used to do with the keyboard.
+// the moving piece is only looked for in the rows around its 4x4 frame
+void step_board(board_t* self, input_t input) {
+    self->step(self, input);
+}
+
+// the original grid scans over every row with the width as a variable. step_board must stay identical to this, see engine_check.c
+void step_board_reference(board_t* self, input_t input) {
+    step_board_rows(self, input, self->width, true);
+}
+
+// garbage is queued and pushed in from the bottom before the next piece spawns
+void add_garbage(board_t* self, int lines) {
+    self->pending_garbage += lines;
+}
+
+// dig mode: the bottom rows of the board are kept as garbage. every garbage row cleared is replaced by a new one from
+// the garbage generator, so the game can go on forever in the same grid. 0 turns it off. kept by init_board
+void set_dig_rows(board_t* self, int rows) {
+    self->dig_rows = rows;
+}
+
+// the other way of get_row_masks, for positions built from outside. set cells become GARBAGE_BLOCK
+void set_row_masks(board_t* self, const uint64_t masks[]) {
+    const int width = self->width;
+    grid_square_t (*grid)[width + 2] = (grid_square_t (*)[width + 2])self->grid;
+
+    self->top_row = self->height;
+    for(int i = self->height - 1; i >= 0; --i) {
+        for(int j = 1; j <= width; ++j) {
+            grid[i][j] = (masks[i] >> (j - 1)) & 1 ? GARBAGE_BLOCK : EMPTY;
+        }
+        if(masks[i] != 0) {
+            self->top_row = i;
+        }
+    }
+}
+
+// xorshift32. same range semantics as raylib's GetRandomValue
+int next_random_value(unsigned int* state, int min, int max) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return min + (int)(x % (unsigned int)(max - min + 1));
+}
+
+// 4x4 frame of a piece at spawn rotation
+void set_piece_shape(grid_square_t piece[4][4], int piece_num) {
+    for(int i = 0; i < 4; ++i) { // clean array
+        for(int j = 0; j < 4; ++j) {
+            piece[i][j] = EMPTY;
+        }
+    }
+
+    switch(piece_num) {
+        case 0: // cube
+            piece[1][1] = MOVING;
+            piece[1][2] = MOVING;
+            piece[2][1] = MOVING;
+            piece[2][2] = MOVING;
+            break;
+        case 1: // L
+            piece[0][1] = MOVING;
+            piece[1][1] = MOVING;
+            piece[2][1] = MOVING;
+            piece[2][2] = MOVING;
+            break;
+        case 2: // J
+            piece[0][2] = MOVING;
+            piece[1][2] = MOVING;
+            piece[2][2] = MOVING;
+            piece[2][1] = MOVING;
+            break;
+        case 3: // I
+            piece[0][1] = MOVING;
+            piece[1][1] = MOVING;
+            piece[2][1] = MOVING;
+            piece[3][1] = MOVING;
+            break;
+        case 4: // T
+            piece[0][1] = MOVING;
+            piece[1][1] = MOVING;
+            piece[2][1] = MOVING;
+            piece[1][2] = MOVING;
+            break;
+        case 5: // S
+            piece[0][1] = MOVING;
+            piece[1][1] = MOVING;
+            piece[1][2] = MOVING;
+            piece[2][2] = MOVING;
+            break;
+        case 6: // Z
+            piece[0][2] = MOVING;
+            piece[1][1] = MOVING;
+            piece[1][2] = MOVING;
+            piece[2][1] = MOVING;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+}
+
+// settled cells of the playfield rows, top to bottom, one mask per row. bit (j - 1) is column j, the moving piece is left out
+void get_row_masks(const board_t* self, uint64_t masks[]) {
+    const int width = self->width;
+    grid_square_t (*grid)[width + 2] = (grid_square_t (*)[width + 2])self->grid;
+
+    for(int i = 0; i < self->height; ++i) {
+        uint64_t mask = 0;
+        for(int j = 1; j <= width; ++j) {
+            if(grid[i][j] >= FULL) {
+                mask |= (uint64_t)1 << (j - 1);
+            }
+        }
+        masks[i] = mask;
+    }
+}
+
+// first row of a window of visible_rows rows. the window follows the piece on boards taller than the screen
+int get_view_top(const board_t* self, int visible_rows) {
+    const int rows = self->height + 1; // 바닥까지
+    int top = self->game_state.piece_position_y - visible_rows / 3;
+
+    if(top > rows - visible_rows) {
+        top = rows - visible_rows;
+    }
+    if(top < 0) {
+        top = 0;
+    }
+
+    return top;
+}
+
+static void step_board_10(board_t* self, input_t input) {
+    step_board_rows(self, input, 10, false);
+}
+
+static void step_board_16(board_t* self, input_t input) {
+    step_board_rows(self, input, 16, false);
+}
+
+static void step_board_32(board_t* self, input_t input) {
+    step_board_rows(self, input, 32, false);
+}
+
+static void step_board_64(board_t* self, input_t input) {
+    step_board_rows(self, input, 64, false);
+}
+
+static void step_board_any(board_t* self, input_t input) {
+    step_board_rows(self, input, self->width, false);
+}
+
+// grid rows plus the floor and the pad rows
+size_t get_cell_count(const board_t* self) {
+    return (size_t)(BOARD_PAD_ROWS_ABOVE + self->height + 1 + BOARD_PAD_ROWS_BELOW) * (self->width + 2);
+}
+
+// FNV-1a over the filled cells, enough to tell placements that end on the same grid
+uint64_t hash_grid(const board_t* self) {
+    const size_t count = (size_t)self->height * (self->width + 2);
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for(size_t k = 0; k < count; ++k) {
+        hash = (hash ^ (self->grid[k] >= FULL)) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+KERNEL void step_board_rows(board_t* self, input_t input, const int width, bool b_whole_grid) {
+    grid_square_t (*grid)[width + 2] = (grid_square_t (*)[width + 2])self->grid;
+    game_state_t* game_state = &self->game_state;
+    counter_t* counter = &self->counter;
+    int first_row;
+    int last_row;
+
+    if(game_state->b_game_over) {
+        return;
+    }
+
+    // add_garbage 와 같음. replay 에 실려서 그대로 다시 들어옴
+    self->pending_garbage += (input.down & INPUT_GARBAGE) >> INPUT_GARBAGE_SHIFT;
+
+    if(input.pressed & INPUT_PAUSE) {
+        set_pause(game_state, !game_state->b_pause);
+    }
+
+    if(!game_state->b_pause) {
+        if(!game_state->b_line_to_delete) {
+            if(!game_state->b_piece_active) {
+                if(self->pending_garbage > 0) {
+                    apply_garbage(width, self->height, grid, self->pending_garbage, &self->top_row, &self->garbage_rows, &self->garbage_rng_state, b_whole_grid);
+                    self->pending_garbage = 0;
+                }
+                set_piece_active(game_state, create_piece(width, grid, self->incoming_piece, self->piece, game_state, &self->rng_state));
+                set_fast_fall_movement_counter(counter, 0);
+                reset_piece_inputs(counter);
+                resolve_level(game_state);
+            } else {
+                if(!game_state->b_hard_drop) {
+                    increment_fast_fall_movement_counter(counter);
+                    increment_gravity_movement_counter(counter);
+                    increment_lateral_movement_counter(counter);
+                    increment_turn_movement_counter(counter);
+
+                    if(input.pressed & (INPUT_LEFT | INPUT_RIGHT)) {
+                        set_lateral_movement_counter(counter, LATERAL_SPEED);
+                    }
+
+                    if(input.pressed & INPUT_UP) {
+                        set_turn_movement_counter(counter, TURNING_SPEED);
+                    }
+
+                    if((input.down & INPUT_DOWN) && (counter->fast_fall_movement_counter >= FAST_FALL_AWAIT_COUNTER)) {
+                        set_gravity_movement_counter(counter, counter->gravity_movement_counter + game_state->gravity_speed);
+                    }
+
+                    if(input.down & INPUT_SPACE) {
+                        set_hard_drop(game_state, true);
+                    }
+
+                    if(counter->gravity_movement_counter >= game_state->gravity_speed) {
+                        get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                        check_detection(width, grid, game_state, first_row, last_row);
+                        resolve_falling_movement(width, grid, game_state, first_row, last_row);
+                        // lock 된 stray 칸이 줄을 채웠을 수 있으므로 completion 까지 전체를 봄
+                        get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                        check_completion(width, grid, game_state, first_row, last_row);
+                        if(!game_state->b_piece_active) {
+                            self->b_stray_moving = false;
+                            resolve_top_row(self);
+                        }
+                        set_gravity_movement_counter(counter, 0);
+                    }
+
+                    if(counter->lateral_movement_counter >= LATERAL_SPEED) {
+                        const int x = game_state->piece_position_x;
+
+                        get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                        if(!resolve_lateral_movement(width, grid, game_state, input, first_row, last_row)) {
+                            set_lateral_movement_counter(counter, 0);
+                        }
+                        if(game_state->piece_position_x != x) {
+                            increment_piece_shifts(counter);
+                        }
+                    }
+
+                    if(counter->turn_movement_counter >= TURNING_SPEED) {
+                        // 이번 tick 에 lock 된 블록을 turn 하면 놓인 블록 위에 MOVING 이 남음
+                        const bool b_locked = !game_state->b_piece_active;
+
+                        get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                        if(resolve_turn_movement(width, grid, self->piece, game_state, input, first_row, last_row)) {
+                            set_turn_movement_counter(counter, 0);
+                            increment_piece_turns(counter);
+                            if(b_locked) {
+                                self->b_stray_moving = true;
+                            }
+                        }
+                    }
+                } else { // hard drop 인 경우
+                    get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                    check_detection(width, grid, game_state, first_row, last_row);
+                    resolve_falling_movement(width, grid, game_state, first_row, last_row);
+                    get_scan_rows(self, b_whole_grid, &first_row, &last_row);
+                    check_completion(width, grid, game_state, first_row, last_row);
+                    if(!game_state->b_piece_active) {
+                        self->b_stray_moving = false;
+                        resolve_top_row(self);
+                    }
+                }
+            }
+
+            // game over logic
+            for(int i = 0; i < 2; ++i) {
+                for(int j = 1; j <= width; ++j) {
+                    if(grid[i][j] >= FULL) {
+                        set_game_over(game_state, true);
+                    }
+                }
+            }
+        } else { // delete line
+            increment_fade_line_counter(counter);
+
+            if(counter->fade_line_counter >= FADING_TIME) {
+                int deleted_lines = 0;
+                const int garbage_rows = self->garbage_rows;
+                deleted_lines = delete_complete_lines(width, self->height, grid, &self->top_row, &self->garbage_rows, b_whole_grid);
+                set_fade_line_counter(counter, 0);
+                set_line_to_delete(game_state, false);
+                game_state->g_lines += deleted_lines;
+                self->dug_rows += garbage_rows - self->garbage_rows;
+                // 파낸 만큼 generator 의 다음 줄을 다음 블록 생성 때 밀어 넣음
+                if(self->dig_rows > self->garbage_rows + self->pending_garbage) {
+                    self->pending_garbage = self->dig_rows - self->garbage_rows;
+                }
+            }
+        }
+    }
+}
+
+// rows that can hold MOVING cells. a turn writes the 4x4 frame with piece_position_x that may be off the grid,
+// which spills into the row above or below, so the frame rows are widened by one on each side.
+// cells left by a turn after a lock can be anywhere, so then every row is scanned until the next lock
+KERNEL void get_scan_rows(const board_t* self, bool b_whole_grid, int* first_row, int* last_row) {
+    const game_state_t* game_state = &self->game_state;
+    *first_row = 0;
+    *last_row = self->height - 1;
+
+    if(!b_whole_grid && !self->b_stray_moving) {
+        if(game_state->piece_position_y - 1 > *first_row) {
+            *first_row = game_state->piece_position_y - 1;
+        }
+        if(game_state->piece_position_y + 4 < *last_row) {
+            *last_row = game_state->piece_position_y + 4;
+        }
+    }
+}
+
+// pad rows are left EMPTY, like the cells a turn could reach off the grid
+static void init_grid(const int width, const int height, grid_square_t grid[][width + 2], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], grid_square_t piece[4][4]) {
+    for(int i = -BOARD_PAD_ROWS_ABOVE; i <= height + BOARD_PAD_ROWS_BELOW; ++i) {
+        for(int j = 0; j < width + 2; ++j) {
+            if(i >= 0 && ((i == height) || (j == 0) || (j == width + 1))) {
+                grid[i][j] = BLOCK;
+            } else {
+                grid[i][j] = EMPTY;
+            }
+        }
+    }
+
+    for(int i = 0; i < 4; ++i) {
+        for(int j = 0; j < 4; ++j) {
+            incoming_piece[i][j] = EMPTY;
+            hold_piece[i][j] = EMPTY;
+            piece[i][j] = EMPTY;
+        }
+    }
+}
+
+// push the stack up and fill the bottom rows with garbage, leaving one hole per row.
+// rows above top_row are EMPTY on both sides of the move, so the kernels move only the stack. the walls stay where they
+// are: a turn off the grid can leave MOVING in them, and `--check-engine 200 --seed 1` caught the moved ones.
+// the reference moves every row cell by cell and keeps top_row only so the boards compare equal
+KERNEL void apply_garbage(const int width, const int height, grid_square_t grid[][width + 2], int lines, int* top_row, int* garbage_rows, unsigned int* garbage_rng_state, bool b_whole_grid) {
+    if(lines > height) {
+        lines = height;
+    }
+
+    const int first = *top_row - lines > 0 ? *top_row - lines : 0;
+    if(b_whole_grid) {
+        for(int i = 0; i < height - lines; ++i) {
+            for(int j = 1; j <= width; ++j) {
+                grid[i][j] = grid[i + lines][j];
+            }
+        }
+    } else {
+        for(int i = first; i < height - lines; ++i) {
+            memcpy(&grid[i][1], &grid[i + lines][1], sizeof(grid_square_t) * width);
+        }
+    }
+
+    const int hole = next_random_value(garbage_rng_state, 1, width);
+    for(int i = height - lines; i < height; ++i) {
+        for(int j = 1; j <= width; ++j) {
+            grid[i][j] = (j == hole) ? EMPTY : GARBAGE_BLOCK;
+        }
+    }
+
+    *top_row = first;
+    *garbage_rows = *garbage_rows + lines < height ? *garbage_rows + lines : height;
+}
+
+static void resolve_level(game_state_t* game_state) {
+    int current_level = game_state->g_level;
+    int new_level = game_state->g_lines / 10 + 1;
+    if(current_level != new_level) {
+        set_level(game_state, new_level);
+    }
+}
+
+KERNEL void save_color(const int width, grid_square_t grid[][width + 2], const int piece_num, int first_row, int last_row) {
+    for(int i = last_row; i >= first_row; --i) {
+        for(int j = 1; j <= width; ++j) {
+            if(grid[i][j] == FULL) {
+                grid[i][j] = piece_num + 5;
+            }
+        }
+    }
+}
+
+KERNEL void check_detection(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row) {
+    for(int i = last_row; i >= first_row; --i) {
+        for(int j = 1; j <= width; ++j) {
+            if((grid[i][j] == MOVING) && ((grid[i + 1][j] >= FULL) || (grid[i + 1][j] == BLOCK))) {
+                set_detection(game_state, true);
+            }
+        }
+    }
+}
+
+KERNEL void resolve_falling_movement(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row) {
+    if(game_state->b_detection) { // finish moving piece
+        for(int i = last_row; i >= first_row; --i) {
+            for(int j = 1; j <= width; ++j) {
+                if(grid[i][j] == MOVING) {
+                    grid[i][j] = FULL;
+                    set_detection(game_state, false);
+                    set_piece_active(game_state, false);
+                }
+            }
+        }
+        save_color(width, grid, game_state->finished_piece_num, first_row, last_row);
+        if(game_state->b_hard_drop) {
+            set_hard_drop(game_state, false);
+        }
+    } else { // move piece down
+        bool b_moved = false;
+
+        for(int i = last_row; i >= first_row; --i) {
+            for(int j = 1; j <= width; ++j) {
+                if(grid[i][j] == MOVING) {
+                    grid[i + 1][j] = MOVING;
+                    grid[i][j] = EMPTY;
+                    b_moved = true;
+                }
+            }
+        }
+
+        if(b_moved) {
+            increment_piece_position_y(game_state);
+        } else {
+            // turn 이 칸을 전부 벽에 써서 playfield 에 남은 칸이 없음. 4x4 틀이 grid 밖으로 끝없이 떨어지지 않게 끝냄
+            set_piece_active(game_state, false);
+            set_hard_drop(game_state, false);
+        }
+    }
+}
+
+// a piece with no cells left in the playfield does not move, so piece_position_x cannot drift off the grid
+KERNEL bool resolve_lateral_movement(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, input_t input, int first_row, int last_row) {
+    bool collision = false;
+    bool b_found = false;
+
+    if(input.down & INPUT_LEFT) {
+        for(int i = last_row; i >= first_row; --i) {
+            for(int j = 1; j <= width; ++j) {
+                if(grid[i][j] == MOVING) {
+                    b_found = true;
+                    if(j == 1 || grid[i][j - 1] >= FULL) {
+                        collision = true;
+                    }
+                }
+            }
+        }
+
+        if(!collision && b_found) {
+            for(int i = last_row; i >= first_row; --i) {
+                for(int j = 1; j <= width; ++j) {
+                    if(grid[i][j] == MOVING) {
+                        grid[i][j - 1] = MOVING;
+                        grid[i][j] = EMPTY;
+                    }
+                }
+            }
+            decrement_piece_position_x(game_state);
+        }
+    } else if(input.down & INPUT_RIGHT) {
+        for(int i = last_row; i >= first_row; --i) {
+            for(int j = 1; j <= width; ++j) {
+                if(grid[i][j] == MOVING) {
+                    b_found = true;
+                    if(j == width || grid[i][j + 1] >= FULL) {
+                        collision = true;
+                    }
+                }
+            }
+        }
+
+        if(!collision && b_found) {
+            for(int i = last_row; i >= first_row; --i) {
+                for(int j = width; j >= 1; --j) {
+                    if(grid[i][j] == MOVING) {
+                        grid[i][j + 1] = MOVING;
+                        grid[i][j] = EMPTY;
+                    }
+                }
+            }
+            increment_piece_position_x(game_state);
+        }
+    }
+
+    return collision;
+}
+
+KERNEL bool resolve_turn_movement(const int width, grid_square_t grid[][width + 2], grid_square_t piece[4][4], game_state_t* game_state, input_t input, int first_row, int last_row) {
+    if(input.down & INPUT_UP) {
+        grid_square_t temp;
+        bool checker = false;
+
+        if(grid[game_state->piece_position_y][game_state->piece_position_x + 3] == MOVING &&
+            (grid[game_state->piece_position_y][game_state->piece_position_x] != EMPTY &&
+            grid[game_state->piece_position_y][game_state->piece_position_x] != MOVING)) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] == MOVING &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 3] != EMPTY &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 3] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x] == MOVING &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] != EMPTY &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y][game_state->piece_position_x] == MOVING &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x] != EMPTY &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y][game_state->piece_position_x + 1] == MOVING &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x] != EMPTY &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] == MOVING &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 1] != EMPTY &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 1] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] == MOVING &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] != EMPTY &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x] == MOVING &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] != EMPTY &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y][game_state->piece_position_x + 2] == MOVING &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x] != EMPTY &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] == MOVING &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 2] != EMPTY &&
+            grid[game_state->piece_position_y][game_state->piece_position_x + 2] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] == MOVING &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] != EMPTY &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x] == MOVING &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] != EMPTY &&
+            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] == MOVING &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 1] != EMPTY &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 1] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] == MOVING &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] != EMPTY &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] == MOVING &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] != EMPTY &&
+            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] != MOVING) {
+            checker = true;
+        }
+
+        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] == MOVING &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] != EMPTY &&
+            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] != MOVING) {
+            checker = true;
+        }
+
+        if(!checker) {
+            temp = piece[0][0];
+            piece[0][0] = piece[0][3];
+            piece[0][3] = piece[3][3];
+            piece[3][3] = piece[3][0];
+            piece[3][0] = temp;
+
+            temp = piece[0][1];
+            piece[0][1] = piece[1][3];
+            piece[1][3] = piece[3][2];
+            piece[3][2] = piece[2][0];
+            piece[2][0] = temp;
+
+            temp = piece[0][2];
+            piece[0][2] = piece[2][3];
+            piece[2][3] = piece[3][1];
+            piece[3][1] = piece[1][0];
+            piece[1][0] = temp;
+
+            temp = piece[1][1];
+            piece[1][1] = piece[1][2];
+            piece[1][2] = piece[2][2];
+            piece[2][2] = piece[2][1];
+            piece[2][1] = temp;
+        }
+
+        for(int i = last_row; i >= first_row; --i) {
+            for(int j = 1; j <= width; ++j) {
+                if(grid[i][j] == MOVING) {
+                    grid[i][j] = EMPTY;
+                }
+            }
+        }
+
+        for(int i = game_state->piece_position_y; i < game_state->piece_position_y + 4; ++i) {
+            for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
+                if(piece[i - game_state->piece_position_y][j - game_state->piece_position_x] == MOVING) {
+                    grid[i][j] = MOVING;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// every FADING row goes in one pass over the stack: each kept row is copied once to where it ends up, so the cost
+// does not grow with the number of lines. garbage_rows counts the cleared rows that were in the garbage at the bottom.
+// the reference keeps the row by row shift, top_row moves down by the cleared rows just like after the compaction
+KERNEL int delete_complete_lines(const int width, const int height, grid_square_t grid[][width + 2], int* top_row, int* garbage_rows, bool b_whole_grid) {
+    const int first_garbage = height - *garbage_rows;
+    int deleted_lines = 0;
+    int dug_rows = 0;
+
+    // turn 이 남긴 MOVING 은 제자리에 있어야 하므로 그때는 한 줄씩 내림
+    for(int i = *top_row; i < height; ++i) {
+        for(int j = 1; j <= width; ++j) {
+            if(grid[i][j] == MOVING) {
+                return shift_complete_lines(width, height, grid, garbage_rows);
+            }
+        }
+    }
+
+    if(b_whole_grid) {
+        deleted_lines = shift_complete_lines(width, height, grid, garbage_rows);
+        *top_row += deleted_lines;
+        return deleted_lines;
+    }
+
+    int target = height - 1;
+    for(int i = height - 1; i >= *top_row; --i) {
+        if(grid[i][1] == FADING) {
+            ++deleted_lines;
+            dug_rows += i >= first_garbage;
+            continue;
+        }
+        // 벽 칸은 shift_complete_lines 처럼 제자리에 둠
+        if(target != i) {
+            memcpy(&grid[target][1], &grid[i][1], sizeof(grid_square_t) * width);
+        }
+        --target;
+    }
+    for(int i = target; i >= *top_row; --i) {
+        for(int j = 1; j <= width; ++j) {
+            grid[i][j] = EMPTY;
+        }
+    }
+
+    *top_row = target + 1;
+    *garbage_rows -= dug_rows;
+
+    return deleted_lines;
+}
+
+// one row at a time: settled and FADING cells move down, MOVING cells stay where they are
+KERNEL int shift_complete_lines(const int width, const int height, grid_square_t grid[][width + 2], int* garbage_rows) {
+    int deleted_lines = 0;
+
+    for(int i = height - 1; i >= 0; --i) {
+        while(grid[i][1] == FADING) {
+            for(int j = 1; j <= width; ++j) {
+                grid[i][j] = EMPTY;
+            }
+
+            for(int k = i - 1; k >= 0; --k) {
+                for(int l = 1; l <= width; ++l) {
+                    if(grid[k][l] >= FULL) {
+                        grid[k + 1][l] = grid[k][l];
+                        grid[k][l] = EMPTY;
+                    } else if(grid[k][l] == FADING) {
+                        grid[k + 1][l] = FADING;
+                        grid[k][l] = EMPTY;
+                    }
+                }
+            }
+
+            if(i >= height - *garbage_rows) {
+                --(*garbage_rows);
+            }
+            ++deleted_lines;
+        }
+    }
+
+    return deleted_lines;
+}
+
+// after a lock. the frame and the row a turn can spill into are the highest cells the piece can have left
+KERNEL void resolve_top_row(board_t* self) {
+    const int row = self->game_state.piece_position_y - 1;
+
+    if(row < self->top_row) {
+        self->top_row = row > 0 ? row : 0;
+    }
+}
+
+KERNEL void check_completion(const int width, grid_square_t grid[][width + 2], game_state_t* game_state, int first_row, int last_row) {
+    int calculator;
+
+    for(int i = last_row; i >= first_row; --i) {
+        calculator = 0;
+        for(int j = 1; j <= width; ++j) {
+            if(grid[i][j] >= FULL) {
+                ++calculator;
+            }
+
+            if(calculator == width) {
+                set_line_to_delete(game_state, true);
+                calculator = 0;
+
+                for(int z = 1; z <= width; ++z) {
+                    grid[i][z] = FADING;
+                }
+            }
+        }
+    }
+}
+
+KERNEL bool create_piece(const int width, grid_square_t grid[][width + 2], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, unsigned int* rng_state) {
+    int piece_num;
+    set_piece_position_x(game_state, (width - 2) / 2);
+    set_piece_position_y(game_state, 0);
+    bool b_collision = false;
+
+    if(game_state->b_begin_play) { // first block creation
+        piece_num = get_random_piece(incoming_piece, rng_state);
+        set_current_piece_num(game_state, piece_num);
+        set_begin_play(game_state, false);
+    }
+
+    for(int i = 0; i < 4; ++i) {
+        for(int j = 0; j < 4; ++j) {
+            piece[i][j] = incoming_piece[i][j];
+        }
+    }
+
+    set_finished_piece_num(game_state, game_state->current_piece_num);
+    increment_pieces(game_state);
+
+    // assign next random piece
+    piece_num = get_random_piece(incoming_piece, rng_state);
+    set_current_piece_num(game_state, piece_num);
+
+    for(int i = 0; i < 4; ++i) {
+        for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
+            if(grid[i][j] != EMPTY && piece[i][j - game_state->piece_position_x] == MOVING) {
+                b_collision = true;
+            }
+        }
+    }
+
+    if(!b_collision) {
+        for(int i = 0; i < 4; ++i) {
+            for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
+                if(piece[i][j - game_state->piece_position_x] == MOVING) {
+                    grid[i][j] = MOVING;
+                }
+            }
+        }
+    } else {
+        set_game_over(game_state, true);
+    }
+
+    return true;
+}
+
+// generate block randomly
+static int get_random_piece(grid_square_t incoming_piece[4][4], unsigned int* rng_state) {
+    const int random = next_random_value(rng_state, 0, 6);
+    set_piece_shape(incoming_piece, random);
+
+    return random;
+}
@@ -0,0 +1,106 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gamedata.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+typedef enum grid_square {
+    EMPTY,
+    MOVING,
+    BLOCK,
+    FADING,
+    FULL,
+    CUBE_BLOCK,
+    L_BLOCK,
+    J_BLOCK,
+    I_BLOCK,
+    T_BLOCK,
+    S_BLOCK,
+    Z_BLOCK,
+    GARBAGE_BLOCK, // versus 에서 상대방이 보낸 줄
+} grid_square_t;
+
+enum {
+    BOARD_DEFAULT_WIDTH = 10,
+    BOARD_DEFAULT_HEIGHT = 20,
+    BOARD_MIN_WIDTH = 4, // 4x4 틀이 벽 사이에 들어가는 폭
+    BOARD_MAX_WIDTH = 64, // 한 줄이 uint64_t mask 하나에 들어감
+    BOARD_MIN_HEIGHT = 8,
+    BOARD_MAX_HEIGHT = 4096,
+    BOARD_PAD_ROWS_ABOVE = 1, // turn 은 4x4 틀을 grid 밖까지 읽고 씀
+    BOARD_PAD_ROWS_BELOW = 3, // 바닥 아래
+    LATERAL_SPEED = 15,
+    TURNING_SPEED = 12,
+    FAST_FALL_AWAIT_COUNTER = 30,
+    FADING_TIME = 33,
+    DIG_FREE_ROWS = 6 // dig mode 에서 garbage 위로 비워두는 최소 줄 수
+};
+
+// key bits used by input_t
+enum {
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_UP = 1 << 2,
+    INPUT_DOWN = 1 << 3,
+    INPUT_SPACE = 1 << 4,
+    INPUT_PAUSE = 1 << 5,
+    INPUT_GARBAGE_SHIFT = 6, // down 의 위 2 bit 는 이 tick 에 받는 garbage 줄 수. engine check 와 그 replay 만 씀
+    INPUT_GARBAGE = 3 << INPUT_GARBAGE_SHIFT
+};
+
+// keys of one tick. replaces IsKeyDown / IsKeyPressed polling so that boards can run without a window
+typedef struct input_t {
+    unsigned char down; // 누르고 있는 키
+    unsigned char pressed; // 이번 tick 에 새로 눌린 키
+} input_t;
+
+// everything one game needs. the grid is on the heap, so boards are copied with copy_board and not '='.
+// row i, column j is grid[i * (width + 2) + j]: columns 0 and width + 1 are walls and row height is the floor
+typedef struct board_t {
+    int width; // 벽을 뺀 폭
+    int height; // 바닥을 뺀 높이
+    grid_square_t* cells; // 위 여유 줄, grid, 바닥, 바닥 아래 여유 줄
+    grid_square_t* grid; // tetris map. grid_square_t (*)[width + 2] 로 보고 사용
+    void (*step)(struct board_t* self, input_t input); // width 에 맞춰 특화된 step_board
+    grid_square_t incoming_piece[4][4]; // next block
+    grid_square_t hold_piece[4][4]; // hold block
+    grid_square_t piece[4][4]; // generated block
+    game_state_t game_state;
+    counter_t counter;
+    unsigned int rng_state; // piece generator
+    unsigned int garbage_rng_state; // garbage hole column
+    int pending_garbage; // 받은 garbage 줄 수. 다음 블록 생성 때 적용
+    bool b_stray_moving; // lock 된 tick 에 turn 이 MOVING 을 다시 찍음. 다음 lock 까지 전체 grid 를 scan
+    int top_row; // 이 줄 위로는 grid 가 모두 EMPTY. 줄 지우기와 garbage 는 여기부터 바닥까지만 옮김
+    int garbage_rows; // 바닥에 남은 garbage 줄 수
+    int dig_rows; // dig mode 에서 유지할 garbage 줄 수, 0 이면 꺼짐
+    long dug_rows; // 지운 garbage 줄 수
+} board_t;
+
+// board functions
+
+bool is_board_size_valid(int width, int height);
+bool create_board(board_t* self, int width, int height);
+void free_board(board_t* self);
+void copy_board(board_t* self, const board_t* other);
+bool is_same_board(const board_t* self, const board_t* other);
+void init_board(board_t* self, unsigned int seed);
+void step_board(board_t* self, input_t input);
+void step_board_reference(board_t* self, input_t input);
+void add_garbage(board_t* self, int lines);
+void set_dig_rows(board_t* self, int rows);
+void set_row_masks(board_t* self, const uint64_t masks[]);
+int next_random_value(unsigned int* state, int min, int max);
+void set_piece_shape(grid_square_t piece[4][4], int piece_num);
+void get_row_masks(const board_t* self, uint64_t masks[]);
+size_t get_cell_count(const board_t* self);
+uint64_t hash_grid(const board_t* self);
+int get_view_top(const board_t* self, int visible_rows);
+
+#endif /* ENGINE_H */
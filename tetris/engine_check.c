@@ -0,0 +1,365 @@
+// differential check of step_board against step_board_reference.
+// both engines get the same seed, the same random keys and the same garbage, and the whole board_t is compared after
+// every tick.
+// the first divergence is shrunk to a short input sequence and printed, optionally saved as a replay
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "replay.h"
+#include "thread_pool.h"
+#include "engine_check.h"
+
+static void init_check_board(board_t* board, unsigned int seed, int dig_rows);
+static int get_check_dig_rows(unsigned int seed, int height);
+static unsigned int get_input_seed(unsigned int seed);
+static void play_check_game(void* ctx, int index);
+static void describe_difference(const board_t* reference, const board_t* board, char* text, size_t size);
+static void print_inputs(const input_t inputs[], long input_count);
+
+// --------------------------------------------------
+// engine_check functions
+// --------------------------------------------------
+
+// keys held for a while like a person would, with few hard drops so that games get deep.
+// now and then garbage comes in on the same input, so it is shrunk and recorded with the keys
+input_t next_check_input(unsigned int* state, unsigned char* down) {
+    input_t input;
+    const unsigned char previous = *down;
+
+    if(next_random_value(state, 0, 3) == 0) {
+        *down = 0;
+        if(next_random_value(state, 0, 99) < 30) {
+            *down |= INPUT_LEFT;
+        }
+        if(next_random_value(state, 0, 99) < 30) {
+            *down |= INPUT_RIGHT;
+        }
+        if(next_random_value(state, 0, 99) < 20) {
+            *down |= INPUT_UP;
+        }
+        if(next_random_value(state, 0, 99) < 20) {
+            *down |= INPUT_DOWN;
+        }
+        if(next_random_value(state, 0, 99) < 3) {
+            *down |= INPUT_SPACE;
+        }
+    }
+
+    input.down = *down;
+    input.pressed = *down & ~previous;
+
+    if(next_random_value(state, 0, 999) == 0) {
+        input.down |= INPUT_PAUSE;
+        input.pressed |= INPUT_PAUSE;
+    }
+    if(next_random_value(state, 0, ENGINE_CHECK_GARBAGE_TICKS - 1) == 0) {
+        input.down |= next_random_value(state, 1, 3) << INPUT_GARBAGE_SHIFT;
+    }
+
+    return input;
+}
+
+// first tick after which the two boards differ, -1 when they agree over all inputs. the boards are created by the caller
+// with the same size and are left at that tick
+long find_divergence(unsigned int seed, int dig_rows, const input_t inputs[], long input_count, board_t* reference, board_t* board) {
+    init_check_board(reference, seed, dig_rows);
+    init_check_board(board, seed, dig_rows);
+
+    for(long tick = 0; tick < input_count; ++tick) {
+        step_board_reference(reference, inputs[tick]);
+        step_board(board, inputs[tick]);
+
+        if(!is_same_board(reference, board)) {
+            return tick;
+        }
+    }
+
+    return -1;
+}
+
+// delta debugging over the inputs: drop chunks while the boards still diverge, halving the chunk when nothing goes.
+// returns the new input count
+long shrink_divergence(unsigned int seed, int dig_rows, int width, int height, input_t inputs[], long input_count) {
+    board_t reference;
+    board_t board;
+    input_t* candidate = malloc(sizeof(input_t) * (input_count > 0 ? input_count : 1));
+    const bool b_reference = create_board(&reference, width, height);
+    const bool b_board = create_board(&board, width, height);
+
+    if(!b_reference || !b_board || candidate == NULL) {
+        free_board(&reference);
+        free_board(&board);
+        free(candidate);
+        return input_count;
+    }
+
+    for(long chunk = input_count / 2; chunk >= 1; ) {
+        bool b_removed = false;
+
+        for(long start = 0; start < input_count; ) {
+            const long end = start + chunk < input_count ? start + chunk : input_count;
+            const long candidate_count = input_count - (end - start);
+
+            memcpy(candidate, inputs, sizeof(input_t) * start);
+            memcpy(candidate + start, inputs + end, sizeof(input_t) * (input_count - end));
+
+            const long tick = find_divergence(seed, dig_rows, candidate, candidate_count, &reference, &board);
+            if(tick >= 0) {
+                // 갈라진 tick 뒤의 입력은 필요 없음
+                input_count = tick + 1;
+                memcpy(inputs, candidate, sizeof(input_t) * input_count);
+                b_removed = true;
+            } else {
+                start = end;
+            }
+        }
+
+        if(!b_removed) {
+            chunk /= 2;
+        } else if(chunk > input_count / 2) {
+            chunk = input_count / 2;
+        }
+    }
+
+    free_board(&reference);
+    free_board(&board);
+    free(candidate);
+
+    return input_count;
+}
+
+// games run in batches on the pool. the first divergence in game order is reported, so the report does not depend on threads
+int run_engine_check(long game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, const char* record_path) {
+    thread_pool_t pool;
+    engine_check_game_t* diverged = NULL;
+    long total_ticks = 0;
+    long played = 0;
+    long reported_ticks = 0;
+    struct timespec begin;
+    struct timespec end;
+
+    if(!init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        return 1;
+    }
+    // pool 이 고친 thread 수로 batch 크기를 정함
+    const int batch_size = pool.thread_count * ENGINE_CHECK_GAMES_PER_THREAD;
+    engine_check_game_t* games = calloc(batch_size, sizeof(engine_check_game_t));
+    if(games == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for(long first = 0; first < game_count && diverged == NULL; first += batch_size) {
+        const int count = game_count - first < batch_size ? (int)(game_count - first) : batch_size;
+
+        for(int i = 0; i < count; ++i) {
+            games[i].seed = seed + (unsigned int)(first + i);
+            games[i].width = width;
+            games[i].height = height;
+            games[i].dig_rows = get_check_dig_rows(games[i].seed, height);
+            games[i].tick_limit = tick_limit > 0 ? tick_limit : ENGINE_CHECK_TICK_LIMIT;
+            games[i].ticks = 0;
+            games[i].diverged_tick = -1;
+            games[i].b_out_of_memory = false;
+        }
+
+        run_thread_pool(&pool, count, play_check_game, games);
+
+        for(int i = 0; i < count; ++i) {
+            if(games[i].b_out_of_memory) {
+                fprintf(stderr, "tetris: out of memory, game %ld left out\n", first + i);
+            }
+            total_ticks += games[i].ticks;
+            ++played;
+            if(games[i].diverged_tick >= 0) {
+                diverged = &games[i];
+                break;
+            }
+        }
+
+        // 밤새 돌릴 때를 위한 진행 상황
+        if(total_ticks - reported_ticks >= 100000000) {
+            fprintf(stderr, "%ld games, %ld ticks\n", played, total_ticks);
+            reported_ticks = total_ticks;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1.0e9;
+
+    printf("board %dx%d, games: %ld, ticks: %ld, %.1f M ticks/s on %d threads\n", width, height, played, total_ticks, total_ticks / seconds / 1.0e6, pool.thread_count);
+
+    int result = 0;
+    if(diverged != NULL) {
+        const unsigned int game_seed = diverged->seed;
+        const int dig_rows = diverged->dig_rows;
+        long input_count = diverged->diverged_tick + 1;
+        input_t* inputs = malloc(sizeof(input_t) * input_count);
+        board_t reference;
+        board_t board;
+        const bool b_reference = create_board(&reference, width, height);
+        const bool b_board = create_board(&board, width, height);
+        char text[128];
+
+        result = 1;
+
+        if(inputs == NULL || !b_reference || !b_board) {
+            fprintf(stderr, "tetris: out of memory\n");
+        } else {
+            // 같은 입력을 다시 만들어서 줄임
+            unsigned int input_state = get_input_seed(game_seed);
+            unsigned char down = 0;
+            for(long tick = 0; tick < input_count; ++tick) {
+                inputs[tick] = next_check_input(&input_state, &down);
+            }
+
+            input_count = shrink_divergence(game_seed, dig_rows, width, height, inputs, input_count);
+            const long tick = find_divergence(game_seed, dig_rows, inputs, input_count, &reference, &board);
+            describe_difference(&reference, &board, text, sizeof(text));
+
+            printf("seed %u, dig %d diverged at tick %ld, shrunk to %ld inputs: %s\n", game_seed, dig_rows, diverged->diverged_tick, input_count, text);
+            print_inputs(inputs, input_count);
+            printf("the boards differ after tick %ld\n", tick);
+
+            if(record_path != NULL) {
+                replay_t replay;
+
+                init_replay(&replay, game_seed, width, height, dig_rows);
+                for(long k = 0; k < input_count; ++k) {
+                    record_replay_input(&replay, inputs[k]);
+                }
+                finish_replay(&replay, &reference.game_state);
+                if(!save_replay(&replay, record_path)) {
+                    perror(record_path);
+                }
+                free_replay(&replay);
+            }
+        }
+
+        free(inputs);
+        free_board(&reference);
+        free_board(&board);
+    } else {
+        printf("no divergence\n");
+    }
+
+    free(games);
+    free_thread_pool(&pool);
+
+    return result;
+}
+
+static void init_check_board(board_t* board, unsigned int seed, int dig_rows) {
+    set_dig_rows(board, dig_rows);
+    init_board(board, seed);
+    set_begin_game(&board->game_state, true);
+}
+
+// dig mode 가 켜진 게임과 꺼진 게임이 섞이게 seed 로 정함
+static int get_check_dig_rows(unsigned int seed, int height) {
+    const int rows = (int)(seed % (ENGINE_CHECK_MAX_DIG_ROWS + 1));
+    return rows < height - DIG_FREE_ROWS ? rows : height - DIG_FREE_ROWS;
+}
+
+static unsigned int get_input_seed(unsigned int seed) {
+    const unsigned int state = seed * 0x85ebca6bu ^ 0xc2b2ae35u;
+    return state != 0 ? state : 0xc2b2ae35u;
+}
+
+// inputs are generated on the fly, they are only made again for the one game that diverged
+static void play_check_game(void* ctx, int index) {
+    engine_check_game_t* game = &((engine_check_game_t*)ctx)[index];
+    board_t reference;
+    board_t board;
+    unsigned int input_state = get_input_seed(game->seed);
+    unsigned char down = 0;
+    const bool b_reference = create_board(&reference, game->width, game->height);
+    const bool b_board = create_board(&board, game->width, game->height);
+
+    if(!b_reference || !b_board) {
+        game->b_out_of_memory = true;
+        free_board(&reference);
+        free_board(&board);
+        return;
+    }
+
+    init_check_board(&reference, game->seed, game->dig_rows);
+    init_check_board(&board, game->seed, game->dig_rows);
+
+    for(long tick = 0; tick < game->tick_limit && !reference.game_state.b_game_over; ++tick) {
+        const input_t input = next_check_input(&input_state, &down);
+
+        step_board_reference(&reference, input);
+        step_board(&board, input);
+        ++game->ticks;
+
+        if(!is_same_board(&reference, &board)) {
+            game->diverged_tick = tick;
+            break;
+        }
+    }
+
+    free_board(&reference);
+    free_board(&board);
+}
+
+// names the first field that differs. pad rows are shown as rows below 0 and past the floor
+static void describe_difference(const board_t* reference, const board_t* board, char* text, size_t size) {
+    const int columns = board->width + 2;
+    const int rows = BOARD_PAD_ROWS_ABOVE + board->height + 1 + BOARD_PAD_ROWS_BELOW;
+
+    for(int k = 0; k < rows * columns; ++k) {
+        if(reference->cells[k] != board->cells[k]) {
+            snprintf(text, size, "grid[%d][%d] is %d, reference %d", k / columns - BOARD_PAD_ROWS_ABOVE, k % columns, board->cells[k], reference->cells[k]);
+            return;
+        }
+    }
+
+    if(memcmp(reference->incoming_piece, board->incoming_piece, sizeof(board->incoming_piece)) != 0) {
+        snprintf(text, size, "incoming_piece differs");
+    } else if(memcmp(reference->hold_piece, board->hold_piece, sizeof(board->hold_piece)) != 0) {
+        snprintf(text, size, "hold_piece differs");
+    } else if(memcmp(reference->piece, board->piece, sizeof(board->piece)) != 0) {
+        snprintf(text, size, "piece differs");
+    } else if(memcmp(&reference->game_state, &board->game_state, sizeof(game_state_t)) != 0) {
+        snprintf(text, size, "game_state differs, piece at (%d, %d), reference (%d, %d)",
+            board->game_state.piece_position_x, board->game_state.piece_position_y,
+            reference->game_state.piece_position_x, reference->game_state.piece_position_y);
+    } else if(memcmp(&reference->counter, &board->counter, sizeof(counter_t)) != 0) {
+        snprintf(text, size, "counter differs");
+    } else {
+        snprintf(text, size, "generator state differs");
+    }
+}
+
+// one token per tick in bot_server's key letters, P for pause and '.' for no key. +N is N lines of garbage
+static void print_inputs(const input_t inputs[], long input_count) {
+    static const char letters[] = "LRUDSP";
+
+    for(long tick = 0; tick < input_count; ++tick) {
+        bool b_any = false;
+
+        for(int bit = 0; bit < 6; ++bit) {
+            if(inputs[tick].down & (1 << bit)) {
+                putchar(letters[bit]);
+                b_any = true;
+            }
+        }
+        if(!b_any) {
+            putchar('.');
+        }
+        if(inputs[tick].down & INPUT_GARBAGE) {
+            printf("+%d", (inputs[tick].down & INPUT_GARBAGE) >> INPUT_GARBAGE_SHIFT);
+        }
+        putchar(tick + 1 < input_count ? ' ' : '\n');
+    }
+}
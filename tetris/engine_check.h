@@ -0,0 +1,37 @@
+#ifndef ENGINE_CHECK_H
+#define ENGINE_CHECK_H
+
+#include <stdbool.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    ENGINE_CHECK_GAMES_PER_THREAD = 64, // 한 batch 에서 thread 당 게임 수
+    ENGINE_CHECK_TICK_LIMIT = 200000, // --ticks 가 없을 때 게임 하나의 최대 tick
+    ENGINE_CHECK_GARBAGE_TICKS = 300, // 평균 이 tick 마다 garbage 1 ~ 3 줄
+    ENGINE_CHECK_MAX_DIG_ROWS = 4 // seed 마다 dig mode 0 ~ 이 값
+};
+
+// one random game played by both engines. diverged_tick is -1 while they agree
+typedef struct engine_check_game_t {
+    unsigned int seed;
+    int width;
+    int height;
+    int dig_rows;
+    long tick_limit;
+    long ticks;
+    long diverged_tick;
+    bool b_out_of_memory;
+} engine_check_game_t;
+
+// engine_check functions
+
+input_t next_check_input(unsigned int* state, unsigned char* down);
+long find_divergence(unsigned int seed, int dig_rows, const input_t inputs[], long input_count, board_t* reference, board_t* board);
+long shrink_divergence(unsigned int seed, int dig_rows, int width, int height, input_t inputs[], long input_count);
+int run_engine_check(long game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, const char* record_path);
+
+#endif /* ENGINE_CHECK_H */
@@ -0,0 +1,238 @@
+// finesse: the fewest shifts and turns that put a piece where the player locked it, against the ones the engine
+// actually applied. poses are (rotation, x, y) of the 4x4 frame, searched breadth first from the spawn pose.
+// shifts and turns cost one input, dropping to the landing row costs none since gravity does it anyway.
+// gravity is otherwise ignored: the search assumes the keys are faster than the piece falls
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gamedata.h"
+#include "engine.h"
+#include "finesse.h"
+
+static void get_piece_rows(const grid_square_t piece[4][4], unsigned char rows[4]);
+static void rotate_rows(const unsigned char rows[4], unsigned char out[4]);
+static uint64_t place_row(unsigned char row, int x);
+static bool fits(const finesse_t* self, const unsigned char rows[4], int x, int y);
+static int get_landing_y(const finesse_t* self, const unsigned char rows[4], int x, int y);
+static int get_cells(const unsigned char rows[4], int x, int y, uint64_t cells[4]);
+static void visit(finesse_t* self, int rotation, int x, int y, int distance, int* tail);
+static int find_optimal_inputs(finesse_t* self, int top, const uint64_t cells[4]);
+
+// --------------------------------------------------
+// finesse_t functions
+// --------------------------------------------------
+
+bool init_finesse(finesse_t* self, int width, int height) {
+    self->width = width;
+    self->height = height;
+    self->pose_count = 4 * (width - FINESSE_MIN_X + 1) * (height + 1);
+    self->masks = malloc(sizeof(uint64_t) * height);
+    self->visited = calloc(self->pose_count, sizeof(unsigned int));
+    self->queue = malloc(sizeof(int) * self->pose_count);
+    self->distance = malloc(sizeof(int) * self->pose_count);
+    if(self->masks == NULL || self->visited == NULL || self->queue == NULL || self->distance == NULL) {
+        free_finesse(self);
+        return false;
+    }
+    self->search = 0;
+    reset_finesse(self);
+
+    return true;
+}
+
+void free_finesse(finesse_t* self) {
+    free(self->masks);
+    free(self->visited);
+    free(self->queue);
+    free(self->distance);
+    self->masks = NULL;
+    self->visited = NULL;
+    self->queue = NULL;
+    self->distance = NULL;
+}
+
+// totals back to zero for a new game
+void reset_finesse(finesse_t* self) {
+    self->b_tracking = false;
+    self->last.piece_num = -1;
+    self->last.optimal = 0;
+    self->last.actual = 0;
+    self->last.b_found = false;
+    self->pieces = 0;
+    self->faults = 0;
+    self->excess_inputs = 0;
+}
+
+// called after every step_board with the game state from before it. true when a piece locked and was judged
+bool record_finesse_step(finesse_t* self, const game_state_t* before, const board_t* board) {
+    const game_state_t* after = &board->game_state;
+    unsigned char rows[4];
+    uint64_t cells[4];
+
+    if(after->g_pieces != before->g_pieces && after->b_piece_active) {
+        get_row_masks(board, self->masks);
+        get_piece_rows(board->piece, self->rotations[0]);
+        for(int r = 1; r < 4; ++r) {
+            rotate_rows(self->rotations[r - 1], self->rotations[r]);
+        }
+        self->spawn_x = after->piece_position_x;
+        self->spawn_y = after->piece_position_y;
+        self->b_tracking = true;
+        return false;
+    }
+
+    if(!self->b_tracking || !before->b_piece_active || after->b_piece_active) {
+        return false;
+    }
+    self->b_tracking = false;
+
+    // lock 된 tick 에는 블록이 움직이지 않으므로 틀과 위치가 놓인 자리
+    get_piece_rows(board->piece, rows);
+    const int top = get_cells(rows, after->piece_position_x, after->piece_position_y, cells);
+    const int optimal = top >= 0 ? find_optimal_inputs(self, top, cells) : -1;
+
+    self->last.piece_num = after->finished_piece_num;
+    self->last.actual = board->counter.piece_shifts + board->counter.piece_turns;
+    self->last.optimal = optimal;
+    self->last.b_found = optimal >= 0;
+    if(self->last.b_found) {
+        ++self->pieces;
+        if(self->last.actual > optimal) {
+            ++self->faults;
+            self->excess_inputs += self->last.actual - optimal;
+        }
+    }
+
+    return true;
+}
+
+// bit j of rows[i] is piece[i][j]
+static void get_piece_rows(const grid_square_t piece[4][4], unsigned char rows[4]) {
+    for(int i = 0; i < 4; ++i) {
+        rows[i] = 0;
+        for(int j = 0; j < 4; ++j) {
+            if(piece[i][j] == MOVING) {
+                rows[i] |= 1 << j;
+            }
+        }
+    }
+}
+
+// the same turn as resolve_turn_movement: out[i][j] = in[j][3 - i]
+static void rotate_rows(const unsigned char rows[4], unsigned char out[4]) {
+    for(int i = 0; i < 4; ++i) {
+        out[i] = 0;
+        for(int j = 0; j < 4; ++j) {
+            if(rows[j] & (1 << (3 - i))) {
+                out[i] |= 1 << j;
+            }
+        }
+    }
+}
+
+// frame columns x .. x + 3 as a row mask, bit (j - 1) is column j. callers keep the cells inside the walls
+static uint64_t place_row(unsigned char row, int x) {
+    return x >= 1 ? (uint64_t)row << (x - 1) : (uint64_t)row >> (1 - x);
+}
+
+static bool fits(const finesse_t* self, const unsigned char rows[4], int x, int y) {
+    for(int i = 0; i < 4; ++i) {
+        if(rows[i] == 0) {
+            continue;
+        }
+
+        const int row = y + i;
+        const int low = __builtin_ctz(rows[i]);
+        const int high = 31 - __builtin_clz(rows[i]);
+        if(row >= self->height || x + low < 1 || x + high > self->width || (self->masks[row] & place_row(rows[i], x))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int get_landing_y(const finesse_t* self, const unsigned char rows[4], int x, int y) {
+    while(fits(self, rows, x, y + 1)) {
+        ++y;
+    }
+
+    return y;
+}
+
+// the cells from the first filled frame row down, so that poses ending on the same cells compare equal.
+// returns that row, or -1 for an empty frame
+static int get_cells(const unsigned char rows[4], int x, int y, uint64_t cells[4]) {
+    int first = 0;
+
+    while(first < 4 && rows[first] == 0) {
+        ++first;
+    }
+    if(first == 4) {
+        return -1;
+    }
+
+    for(int k = 0; k < 4; ++k) {
+        cells[k] = first + k < 4 ? place_row(rows[first + k], x) : 0;
+    }
+
+    return y + first;
+}
+
+// queues a pose the first time it is seen, and its landing pose at the same distance
+static void visit(finesse_t* self, int rotation, int x, int y, int distance, int* tail) {
+    const unsigned char* rows = self->rotations[rotation];
+
+    if(x < FINESSE_MIN_X || x > self->width || !fits(self, rows, x, y)) {
+        return;
+    }
+
+    const int index = (rotation * (self->width - FINESSE_MIN_X + 1) + x - FINESSE_MIN_X) * (self->height + 1) + y;
+    if(self->visited[index] == self->search) {
+        return;
+    }
+    self->visited[index] = self->search;
+    self->distance[index] = distance;
+    self->queue[(*tail)++] = index;
+
+    const int landing_y = get_landing_y(self, rows, x, y);
+    if(landing_y != y) {
+        visit(self, rotation, x, landing_y, distance, tail);
+    }
+}
+
+// breadth first, so the first landing pose on the target cells has the fewest inputs. -1 when none reaches them
+static int find_optimal_inputs(finesse_t* self, int top, const uint64_t cells[4]) {
+    const int columns = self->width - FINESSE_MIN_X + 1;
+    uint64_t pose_cells[4];
+    int head = 0;
+    int tail = 0;
+
+    if(++self->search == 0) {
+        memset(self->visited, 0, sizeof(unsigned int) * self->pose_count);
+        self->search = 1;
+    }
+
+    visit(self, 0, self->spawn_x, self->spawn_y, 0, &tail);
+
+    while(head < tail) {
+        const int index = self->queue[head++];
+        const int y = index % (self->height + 1);
+        const int x = index / (self->height + 1) % columns + FINESSE_MIN_X;
+        const int rotation = index / (self->height + 1) / columns;
+        const int distance = self->distance[index];
+        const unsigned char* rows = self->rotations[rotation];
+
+        if(!fits(self, rows, x, y + 1) && get_cells(rows, x, y, pose_cells) == top && memcmp(pose_cells, cells, sizeof(pose_cells)) == 0) {
+            return distance;
+        }
+
+        visit(self, rotation, x - 1, y, distance + 1, &tail);
+        visit(self, rotation, x + 1, y, distance + 1, &tail);
+        visit(self, (rotation + 1) & 3, x, y, distance + 1, &tail);
+    }
+
+    return -1;
+}
@@ -0,0 +1,53 @@
+#ifndef FINESSE_H
+#define FINESSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gamedata.h"
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    FINESSE_MIN_X = -2 // 칸이 1 열에 닿는 4x4 틀의 piece_position_x
+};
+
+// one locked piece. inputs are shifts and turns only: gravity can stand in for any drop, so drops are not counted
+typedef struct finesse_result_t {
+    int piece_num;
+    int optimal; // 같은 자리에 놓는 최소 입력 수
+    int actual; // resolve_lateral_movement 와 resolve_turn_movement 가 처리한 입력 수
+    bool b_found; // 블록이 BFS 로 갈 수 없는 자리에서 끝나면 false, 이 경우 판정하지 않음
+} finesse_result_t;
+
+// remembers the settled cells when a piece spawns and searches its poses when it locks.
+// everything is allocated once for the board size, a lock does no malloc and clears nothing
+typedef struct finesse_t {
+    int width;
+    int height;
+    int pose_count;
+    uint64_t* masks; // spawn 때 쌓인 칸, 줄마다 하나
+    unsigned int* visited; // pose 마다 그 pose 를 본 탐색 번호
+    int* queue;
+    int* distance;
+    unsigned int search; // 탐색 번호, visited 를 지우지 않기 위해 사용
+    unsigned char rotations[4][4]; // spawn 모양과 그 회전, 틀의 줄마다 열 bit
+    int spawn_x;
+    int spawn_y;
+    bool b_tracking; // 지금 블록의 spawn 을 봤음
+    finesse_result_t last; // 마지막으로 lock 된 블록
+    long pieces; // 판정한 블록 수
+    long faults; // 입력이 최소보다 많았던 블록 수
+    long excess_inputs;
+} finesse_t;
+
+// finesse_t functions
+
+bool init_finesse(finesse_t* self, int width, int height);
+void free_finesse(finesse_t* self);
+void reset_finesse(finesse_t* self);
+bool record_finesse_step(finesse_t* self, const game_state_t* before, const board_t* board);
+
+#endif /* FINESSE_H */
@@ -0,0 +1,215 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_export.h"
+
+static void* export_worker_main(void* arg);
+static bool write_raw_frame(frame_exporter_t* self, const unsigned char* pixels);
+static bool write_png_frame(frame_exporter_t* self, unsigned char* pixels, long frame);
+
+// --------------------------------------------------
+// frame_exporter_t functions
+// --------------------------------------------------
+
+// raw goes to path ("-" is stdout) in frame order, so it gets exactly one worker
+bool init_frame_exporter(frame_exporter_t* self, export_format_t format, const char* path, int width, int height, int worker_count) {
+    self->format = format;
+    snprintf(self->path, sizeof(self->path), "%s", path);
+    self->fd = -1;
+    self->width = width;
+    self->height = height;
+    self->head = 0;
+    self->tail = 0;
+    self->frame_count = 0;
+    self->free_count = 0;
+    self->worker_count = 0;
+    self->b_sync_ready = false;
+    self->b_closing = false;
+    self->b_failed = false;
+    memset(self->buffers, 0, sizeof(self->buffers));
+
+    if(format == EXPORT_RAW) {
+        worker_count = 1;
+        self->fd = strcmp(path, "-") == 0 ? STDOUT_FILENO : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(self->fd < 0) {
+            return false;
+        }
+    }
+    if(worker_count < 1) {
+        worker_count = 1;
+    }
+    if(worker_count > EXPORT_MAX_WORKERS) {
+        worker_count = EXPORT_MAX_WORKERS;
+    }
+
+    for(int i = 0; i < EXPORT_RING_SIZE; ++i) {
+        self->buffers[i] = malloc((size_t)width * height * 4);
+        if(self->buffers[i] == NULL) {
+            free_frame_exporter(self);
+            return false;
+        }
+        self->free_buffers[self->free_count++] = self->buffers[i];
+    }
+
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->not_full, NULL);
+    pthread_cond_init(&self->not_empty, NULL);
+    self->b_sync_ready = true;
+
+    for(int i = 0; i < worker_count; ++i) {
+        if(pthread_create(&self->workers[i], NULL, export_worker_main, self) != 0) {
+            free_frame_exporter(self);
+            return false;
+        }
+        ++(self->worker_count);
+    }
+
+    return true;
+}
+
+// copies pixels into a free buffer. blocks only while every buffer is queued or being written
+void push_frame(frame_exporter_t* self, const unsigned char* pixels) {
+    pthread_mutex_lock(&self->lock);
+    while(self->free_count == 0) {
+        pthread_cond_wait(&self->not_full, &self->lock);
+    }
+    unsigned char* buffer = self->free_buffers[--(self->free_count)];
+    pthread_mutex_unlock(&self->lock);
+
+    memcpy(buffer, pixels, (size_t)self->width * self->height * 4);
+
+    // buffer 수가 ring 크기와 같아서 ring 은 넘치지 않음
+    pthread_mutex_lock(&self->lock);
+    frame_slot_t* slot = &self->ring[self->head % EXPORT_RING_SIZE];
+    slot->pixels = buffer;
+    slot->frame = self->frame_count++;
+    ++(self->head);
+
+    pthread_cond_signal(&self->not_empty);
+    pthread_mutex_unlock(&self->lock);
+}
+
+// writes what is left and waits for the workers. false if any frame failed
+// also cleans up an init_frame_exporter that failed halfway
+bool free_frame_exporter(frame_exporter_t* self) {
+    if(self->b_sync_ready) {
+        pthread_mutex_lock(&self->lock);
+        self->b_closing = true;
+        pthread_cond_broadcast(&self->not_empty);
+        pthread_mutex_unlock(&self->lock);
+
+        for(int i = 0; i < self->worker_count; ++i) {
+            pthread_join(self->workers[i], NULL);
+        }
+
+        pthread_mutex_destroy(&self->lock);
+        pthread_cond_destroy(&self->not_full);
+        pthread_cond_destroy(&self->not_empty);
+    }
+
+    if(self->fd >= 0 && self->fd != STDOUT_FILENO && close(self->fd) != 0) {
+        self->b_failed = true;
+    }
+    for(int i = 0; i < EXPORT_RING_SIZE; ++i) {
+        free(self->buffers[i]);
+        self->buffers[i] = NULL;
+    }
+
+    return !self->b_failed;
+}
+
+static void* export_worker_main(void* arg) {
+    frame_exporter_t* self = arg;
+
+    for(;;) {
+        pthread_mutex_lock(&self->lock);
+        while(self->head == self->tail && !self->b_closing) {
+            pthread_cond_wait(&self->not_empty, &self->lock);
+        }
+        if(self->head == self->tail) {
+            pthread_mutex_unlock(&self->lock);
+            break;
+        }
+
+        frame_slot_t slot = self->ring[self->tail % EXPORT_RING_SIZE];
+        ++(self->tail);
+        pthread_mutex_unlock(&self->lock);
+
+        bool b_ok;
+        if(self->format == EXPORT_RAW) {
+            b_ok = write_raw_frame(self, slot.pixels);
+        } else {
+            b_ok = write_png_frame(self, slot.pixels, slot.frame);
+        }
+
+        pthread_mutex_lock(&self->lock);
+        self->free_buffers[self->free_count++] = slot.pixels;
+        if(!b_ok) {
+            self->b_failed = true;
+        }
+        pthread_cond_signal(&self->not_full);
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    return NULL;
+}
+
+// render textures are stored bottom-up, so the rows are written in reverse
+static bool write_raw_frame(frame_exporter_t* self, const unsigned char* pixels) {
+    const int row_size = self->width * 4;
+
+    for(int y = self->height - 1; y >= 0; --y) {
+        const unsigned char* row = pixels + (size_t)y * row_size;
+        int written = 0;
+
+        while(written < row_size) {
+            const ssize_t count = write(self->fd, row + written, row_size - written);
+            if(count < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += count;
+        }
+    }
+
+    return true;
+}
+
+static bool write_png_frame(frame_exporter_t* self, unsigned char* pixels, long frame) {
+    char file_name[EXPORT_PATH_SIZE + 32];
+    const int row_size = self->width * 4;
+    unsigned char* row = malloc(row_size);
+    Image image;
+
+    if(row == NULL) {
+        return false;
+    }
+
+    // 위아래를 제자리에서 뒤집음
+    for(int y = 0; y < self->height / 2; ++y) {
+        unsigned char* top = pixels + (size_t)y * row_size;
+        unsigned char* bottom = pixels + (size_t)(self->height - 1 - y) * row_size;
+        memcpy(row, top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, row, row_size);
+    }
+    free(row);
+
+    image.data = pixels;
+    image.width = self->width;
+    image.height = self->height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+    snprintf(file_name, sizeof(file_name), "%s/frame_%06ld.png", self->path, frame);
+
+    return ExportImage(image, file_name);
+}
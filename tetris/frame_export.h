@@ -0,0 +1,58 @@
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    EXPORT_RING_SIZE = 16, // 읽어온 뒤 아직 쓰지 않은 frame 최대 수
+    EXPORT_MAX_WORKERS = 16,
+    EXPORT_PATH_SIZE = 512
+};
+
+typedef enum export_format {
+    EXPORT_RAW, // rgba stream, frame after frame
+    EXPORT_PNG // <dir>/frame_000000.png ...
+} export_format_t;
+
+typedef struct frame_slot_t {
+    unsigned char* pixels; // bottom-up rgba as read from the render texture
+    long frame;
+} frame_slot_t;
+
+// frames read back on the render thread wait here until a worker writes them. the EXPORT_RING_SIZE frame buffers are
+// allocated once; a worker hands its buffer back after writing it
+typedef struct frame_exporter_t {
+    export_format_t format;
+    char path[EXPORT_PATH_SIZE];
+    int fd;
+    int width;
+    int height;
+    frame_slot_t ring[EXPORT_RING_SIZE];
+    unsigned char* buffers[EXPORT_RING_SIZE];
+    unsigned char* free_buffers[EXPORT_RING_SIZE]; // 쓰지 않는 buffer
+    int free_count;
+    long head; // 다음에 넣을 위치
+    long tail; // 다음에 꺼낼 위치
+    long frame_count;
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+    pthread_t workers[EXPORT_MAX_WORKERS];
+    int worker_count;
+    bool b_sync_ready; // lock 과 cond 가 만들어짐
+    bool b_closing;
+    bool b_failed;
+} frame_exporter_t;
+
+// frame_exporter_t functions
+
+bool init_frame_exporter(frame_exporter_t* self, export_format_t format, const char* path, int width, int height, int worker_count);
+void push_frame(frame_exporter_t* self, const unsigned char* pixels);
+bool free_frame_exporter(frame_exporter_t* self);
+
+#endif /* FRAME_EXPORT_H */
@@ -15,6 +15,7 @@ typedef struct game_state_t {
     bool b_hold;
     int g_level;
     int g_lines; // 클리어한 줄 수
+    int g_pieces; // 생성된 블록 수
     int gravity_speed;
     int piece_position_x;
     int piece_position_y;
@@ -29,6 +30,8 @@ typedef struct counter_t {
     int lateral_movement_counter; // block 좌우 이동
     int turn_movement_counter; // block 회전
     int fade_line_counter; // fade line
+    int piece_shifts; // 현재 블록이 실제로 좌우로 움직인 수
+    int piece_turns; // 현재 블록에 처리된 회전 입력 수, 막혀서 돌지 않은 것 포함
 } counter_t;
 
 // reset data
@@ -36,44 +39,175 @@ typedef struct counter_t {
 void reset_game_state(game_state_t* self);
 void reset_counter(counter_t* self);
 
+// --------------------------------------------------
 // game_state_t functions
+// --------------------------------------------------
 
-void set_game_over(game_state_t* self, bool val);
-void set_begin_game(game_state_t* self, bool val);
-void set_begin_play(game_state_t* self, bool val);
-void set_pause(game_state_t* self, bool val);
-void set_piece_active(game_state_t* self, bool val);
-void set_detection(game_state_t* self, bool val);
-void set_line_to_delete(game_state_t* self, bool val);
-void set_hard_drop(game_state_t* self, bool val);
-void set_level(game_state_t* self, int val);
-void set_gravity_speed(game_state_t* self, int val);
-void set_lines(game_state_t* self, int val);
-void set_piece_position_x(game_state_t* self, int val);
-void increment_piece_position_x(game_state_t* self);
-void decrement_piece_position_x(game_state_t* self);
-void set_piece_position_y(game_state_t* self, int val);
-void increment_piece_position_y(game_state_t* self);
-void decrement_piece_position_y(game_state_t* self);
-void set_current_piece_num(game_state_t* self, int val);
-void set_finished_piece_num(game_state_t* self, int val);
+// accessors live in the header so step_board can inline them, they are called several times per cell
 
+static inline void set_game_over(game_state_t* self, bool val) {
+    self->b_game_over = val;
+}
+
+static inline void set_begin_game(game_state_t* self, bool val) {
+    self->b_begin_game = val;
+}
+
+static inline void set_begin_play(game_state_t* self, bool val) {
+    self->b_begin_play = val;
+}
+
+static inline void set_pause(game_state_t* self, bool val) {
+    self->b_pause = val;
+}
+
+static inline void set_piece_active(game_state_t* self, bool val) {
+    self->b_piece_active = val;
+}
+
+static inline void set_detection(game_state_t* self, bool val) {
+    self->b_detection = val;
+}
+
+static inline void set_line_to_delete(game_state_t* self, bool val) {
+    self->b_line_to_delete = val;
+}
+
+static inline void set_hard_drop(game_state_t* self, bool val) {
+    self->b_hard_drop = val;
+}
+
+static inline void set_hold(game_state_t* self, bool val) {
+    self->b_hold = val;
+}
+
+static inline void set_level(game_state_t* self, int val) {
+    self->g_level = val;
+}
+
+static inline void set_gravity_speed(game_state_t* self, int val) {
+    self->gravity_speed = val;
+}
+
+static inline void set_lines(game_state_t* self, int val) {
+    self->g_lines = val;
+}
+
+static inline void increment_pieces(game_state_t* self) {
+    ++(self->g_pieces);
+}
+
+static inline void set_piece_position_x(game_state_t* self, int val) {
+    self->piece_position_x = val;
+}
+
+static inline void increment_piece_position_x(game_state_t* self) {
+    ++(self->piece_position_x);
+}
+
+static inline void decrement_piece_position_x(game_state_t* self) {
+    --(self->piece_position_x);
+}
+
+static inline void set_piece_position_y(game_state_t* self, int val) {
+    self->piece_position_y = val;
+}
+
+static inline void increment_piece_position_y(game_state_t* self) {
+    ++(self->piece_position_y);
+}
+
+static inline void decrement_piece_position_y(game_state_t* self) {
+    --(self->piece_position_y);
+}
+
+static inline void set_current_piece_num(game_state_t* self, int val) {
+    self->current_piece_num = val;
+}
+
+static inline void set_finished_piece_num(game_state_t* self, int val) {
+    self->finished_piece_num = val;
+}
+
+static inline void set_hold_piece_num(game_state_t* self, int val) {
+    self->hold_piece_num = val;
+}
+
+// --------------------------------------------------
 // counter_t functions
+// --------------------------------------------------
+
+static inline void increment_fast_fall_movement_counter(counter_t* self) {
+    ++(self->fast_fall_movement_counter);
+}
+
+static inline void decrement_fast_fall_movement_counter(counter_t* self) {
+    --(self->fast_fall_movement_counter);
+}
+
+static inline void increment_gravity_movement_counter(counter_t* self) {
+    ++(self->gravity_movement_counter);
+}
+
+static inline void decrement_gravity_movement_counter(counter_t* self) {
+    --(self->gravity_movement_counter);
+}
+
+static inline void increment_lateral_movement_counter(counter_t* self) {
+    ++(self->lateral_movement_counter);
+}
+
+static inline void decrement_lateral_movement_counter(counter_t* self) {
+    --(self->lateral_movement_counter);
+}
+
+static inline void increment_turn_movement_counter(counter_t* self) {
+    ++(self->turn_movement_counter);
+}
+
+static inline void decrement_turn_movement_counter(counter_t* self) {
+    --(self->turn_movement_counter);
+}
+
+static inline void increment_fade_line_counter(counter_t* self) {
+    ++(self->fade_line_counter);
+}
+
+static inline void decrement_fade_line_counter(counter_t* self) {
+    --(self->fade_line_counter);
+}
+
+static inline void set_fast_fall_movement_counter(counter_t* self, int val) {
+    self->fast_fall_movement_counter = val;
+}
+
+static inline void set_gravity_movement_counter(counter_t* self, int val) {
+    self->gravity_movement_counter = val;
+}
+
+static inline void set_lateral_movement_counter(counter_t* self, int val) {
+    self->lateral_movement_counter = val;
+}
+
+static inline void set_turn_movement_counter(counter_t* self, int val) {
+    self->turn_movement_counter = val;
+}
+
+static inline void set_fade_line_counter(counter_t* self, int val) {
+    self->fade_line_counter = val;
+}
+
+static inline void increment_piece_shifts(counter_t* self) {
+    ++(self->piece_shifts);
+}
+
+static inline void increment_piece_turns(counter_t* self) {
+    ++(self->piece_turns);
+}
 
-void increment_fast_fall_movement_counter(counter_t* self);
-void decrement_fast_fall_movement_counter(counter_t* self);
-void increment_gravity_movement_counter(counter_t* self);
-void decrement_gravity_movement_counter(counter_t* self);
-void increment_lateral_movement_counter(counter_t* self);
-void decrement_lateral_movement_counter(counter_t* self);
-void increment_turn_movement_counter(counter_t* self);
-void decrement_turn_movement_counter(counter_t* self);
-void increment_fade_line_counter(counter_t* self);
-void decrement_fade_line_counter(counter_t* self);
-void set_fast_fall_movement_counter(counter_t* self, int val);
-void set_gravity_movement_counter(counter_t* self, int val);
-void set_lateral_movement_counter(counter_t* self, int val);
-void set_turn_movement_counter(counter_t* self, int val);
-void set_fade_line_counter(counter_t* self, int val);
+static inline void reset_piece_inputs(counter_t* self) {
+    self->piece_shifts = 0;
+    self->piece_turns = 0;
+}
 
 #endif /* GAMEDATA_H */
@@ -0,0 +1,96 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include "io.h"
+
+// --------------------------------------------------
+// io functions
+// --------------------------------------------------
+
+// retries short writes and EINTR. false on error or when nothing more can be written
+bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = data;
+
+    while(size > 0) {
+        const ssize_t written = write(fd, bytes, size);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+// false at end of file, when the other side closed the pipe
+bool read_all(int fd, void* data, size_t size) {
+    char* bytes = data;
+
+    while(size > 0) {
+        const ssize_t got = read(fd, bytes, size);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            return false;
+        }
+        bytes += got;
+        size -= got;
+    }
+
+    return true;
+}
+
+// write_all at a file offset, the file position is left alone
+bool pwrite_all(int fd, const void* data, size_t size, off_t offset) {
+    const char* bytes = data;
+
+    while(size > 0) {
+        const ssize_t written = pwrite(fd, bytes, size, offset);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        }
+        if(written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+// read_all at a file offset. false past the end of the file
+bool pread_all(int fd, void* data, size_t size, off_t offset) {
+    char* bytes = data;
+
+    while(size > 0) {
+        const ssize_t got = pread(fd, bytes, size, offset);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            return false;
+        }
+        bytes += got;
+        size -= got;
+        offset += got;
+    }
+
+    return true;
+}
+
+// monotonic clock for frame timing and timeouts
+long long get_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
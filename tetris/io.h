@@ -0,0 +1,16 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// io functions
+
+bool write_all(int fd, const void* data, size_t size);
+bool read_all(int fd, void* data, size_t size);
+bool pwrite_all(int fd, const void* data, size_t size, off_t offset);
+bool pread_all(int fd, void* data, size_t size, off_t offset);
+long long get_time_ns(void);
+
+#endif /* IO_H */
@@ -0,0 +1,387 @@
+// crash-safe autosave: every tick's keys go to a journal, and every JOURNAL_SNAPSHOT_TICKS the whole board goes to a
+// snapshot that the journal then continues. the engine is deterministic, so the snapshot plus the journal tail is the
+// exact game. the game loop only fills a ring and copies a board now and then; the writer thread does all the I/O
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+#include "io.h"
+#include "journal.h"
+
+static void post_journal_snapshot(journal_t* self, const board_t* board, unsigned int seed, long tick);
+static void* writer_main(void* arg);
+static void drain_records(journal_t* self);
+static void flush_batch(journal_t* self);
+static void start_journal(journal_t* self);
+static bool write_snapshot(journal_t* self);
+static void fail_journal(journal_t* self, const char* path);
+static void sync_directory(const char* path);
+
+// --------------------------------------------------
+// journal_t functions
+// --------------------------------------------------
+
+// the ring and the snapshot board are allocated here once. the first snapshot is posted right away, so the
+// autosave of a fresh game exists before its first tick
+bool init_journal(journal_t* self, const char* path, const board_t* board, unsigned int seed, long tick) {
+    struct timespec now;
+
+    atomic_init(&self->head, 0);
+    atomic_init(&self->tail, 0);
+    atomic_init(&self->b_snapshot_pending, false);
+    atomic_init(&self->b_stop, false);
+    self->cached_tail = 0;
+    self->b_need_snapshot = true;
+    self->snapshot_tick = tick;
+    self->fd = -1;
+    self->b_dirty = false;
+    self->b_failed = false;
+    self->batch_count = 0;
+    snprintf(self->path, sizeof(self->path), "%s", path);
+
+    // 이전 실행의 journal 과 serial 이 겹치지 않게 시각에서 시작
+    clock_gettime(CLOCK_REALTIME, &now);
+    self->serial = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+
+    self->records = malloc(sizeof(journal_record_t) * JOURNAL_RING_SIZE);
+    if(self->records == NULL) {
+        return false;
+    }
+    if(!create_board(&self->snapshot.board, board->width, board->height)) {
+        free(self->records);
+        return false;
+    }
+
+    post_journal_snapshot(self, board, seed, tick);
+
+    if(pthread_create(&self->writer, NULL, writer_main, self) != 0) {
+        free_board(&self->snapshot.board);
+        free(self->records);
+        return false;
+    }
+
+    return true;
+}
+
+// the writer drains what is left and syncs once more, so a clean exit loses nothing
+void free_journal(journal_t* self) {
+    atomic_store(&self->b_stop, true);
+    pthread_join(self->writer, NULL);
+    if(self->fd >= 0) {
+        close(self->fd);
+    }
+    free_board(&self->snapshot.board);
+    free(self->records);
+}
+
+// after one step_board. tick counts the steps so far, so this input belongs to tick - 1
+void record_journal_step(journal_t* self, const board_t* board, input_t input, unsigned int seed, long tick) {
+    if(!self->b_need_snapshot) {
+        const unsigned int head = atomic_load_explicit(&self->head, memory_order_relaxed);
+
+        if(head - self->cached_tail == JOURNAL_RING_SIZE) {
+            self->cached_tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+        }
+        if(head - self->cached_tail == JOURNAL_RING_SIZE) {
+            self->b_need_snapshot = true; // 이 tick 부터는 다음 snapshot 이 대신함
+        } else {
+            journal_record_t* record = &self->records[head & (JOURNAL_RING_SIZE - 1)];
+            record->down = input.down;
+            record->pressed = input.pressed;
+            record->tick = (uint16_t)(tick - 1);
+            // seq_cst: writer 는 head 를 읽은 뒤 b_snapshot_pending 을 읽음. drain_records 참고
+            atomic_store(&self->head, head + 1);
+        }
+    }
+
+    if(self->b_need_snapshot || tick - self->snapshot_tick >= JOURNAL_SNAPSHOT_TICKS) {
+        post_journal_snapshot(self, board, seed, tick);
+    }
+}
+
+// the game changed outside step_board: a new game, or the start page was left
+void mark_journal_reset(journal_t* self, const board_t* board, unsigned int seed, long tick) {
+    self->b_need_snapshot = true;
+    post_journal_snapshot(self, board, seed, tick);
+}
+
+// the last snapshot, then every journal record that continues it. board is created here with the saved size
+bool load_journal(const char* path, board_t* board, unsigned int* seed, long* tick) {
+    journal_snapshot_header_t snapshot_header;
+    journal_header_t header;
+    journal_record_t records[JOURNAL_BATCH];
+    char file_path[JOURNAL_PATH_SIZE + 16];
+
+    snprintf(file_path, sizeof(file_path), "%s.snap", path);
+    int fd = open(file_path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool b_ok = read_all(fd, &snapshot_header, sizeof(snapshot_header)) && memcmp(snapshot_header.magic, "TSNP", 4) == 0
+        && snapshot_header.version == JOURNAL_VERSION && is_board_size_valid(snapshot_header.width, snapshot_header.height)
+        && snapshot_header.tick >= 0;
+    if(!b_ok || !create_board(board, snapshot_header.width, snapshot_header.height)) {
+        close(fd);
+        return false;
+    }
+
+    // is_same_board 와 같은 field. cells 는 위 여유 줄까지 통째로
+    b_ok = read_all(fd, board->cells, sizeof(grid_square_t) * get_cell_count(board))
+        && read_all(fd, board->incoming_piece, sizeof(board->incoming_piece))
+        && read_all(fd, board->hold_piece, sizeof(board->hold_piece))
+        && read_all(fd, board->piece, sizeof(board->piece))
+        && read_all(fd, &board->game_state, sizeof(game_state_t))
+        && read_all(fd, &board->counter, sizeof(counter_t))
+        && read_all(fd, &board->rng_state, sizeof(board->rng_state))
+        && read_all(fd, &board->garbage_rng_state, sizeof(board->garbage_rng_state))
+        && read_all(fd, &board->pending_garbage, sizeof(board->pending_garbage))
+        && read_all(fd, &board->b_stray_moving, sizeof(board->b_stray_moving))
+        && read_all(fd, &board->top_row, sizeof(board->top_row))
+        && read_all(fd, &board->garbage_rows, sizeof(board->garbage_rows))
+        && read_all(fd, &board->dig_rows, sizeof(board->dig_rows))
+        && read_all(fd, &board->dug_rows, sizeof(board->dug_rows));
+    close(fd);
+    if(!b_ok) {
+        free_board(board);
+        return false;
+    }
+
+    *seed = snapshot_header.seed;
+    *tick = snapshot_header.tick;
+
+    // journal 이 없거나 다른 snapshot 의 것이면 snapshot 만으로 이어감
+    snprintf(file_path, sizeof(file_path), "%s.journal", path);
+    fd = open(file_path, O_RDONLY);
+    if(fd < 0) {
+        return true;
+    }
+    if(!read_all(fd, &header, sizeof(header)) || memcmp(header.magic, "TJNL", 4) != 0 || header.version != JOURNAL_VERSION
+        || header.serial != snapshot_header.serial || header.base_tick != snapshot_header.tick) {
+        close(fd);
+        return true;
+    }
+
+    // 끝의 잘린 record 는 버림
+    ssize_t size;
+    while((size = read(fd, records, sizeof(records))) >= (ssize_t)sizeof(journal_record_t)) {
+        const int count = size / sizeof(journal_record_t);
+        for(int i = 0; i < count; ++i) {
+            if(records[i].tick != (uint16_t)*tick) {
+                close(fd);
+                return true;
+            }
+            const input_t input = { records[i].down, records[i].pressed };
+            step_board(board, input);
+            ++(*tick);
+        }
+    }
+    close(fd);
+
+    return true;
+}
+
+// game loop side. skipped while the writer still has the previous snapshot; a forced one is tried again next tick
+static void post_journal_snapshot(journal_t* self, const board_t* board, unsigned int seed, long tick) {
+    if(atomic_load(&self->b_snapshot_pending)) {
+        return;
+    }
+
+    copy_board(&self->snapshot.board, board);
+    self->snapshot.seed = seed;
+    self->snapshot.tick = tick;
+    self->snapshot.sequence = atomic_load_explicit(&self->head, memory_order_relaxed);
+    self->snapshot_tick = tick;
+    self->b_need_snapshot = false;
+
+    atomic_store(&self->b_snapshot_pending, true);
+}
+
+// --------------------------------------------------
+// writer thread
+// --------------------------------------------------
+
+// writes go out every poll, fdatasync only every JOURNAL_SYNC_MS: a crash loses at most that much play
+static void* writer_main(void* arg) {
+    journal_t* self = arg;
+    const struct timespec poll = { 0, JOURNAL_POLL_MS * 1000000L };
+    long long next_sync = get_time_ns() + JOURNAL_SYNC_MS * 1000000LL;
+
+    while(!atomic_load(&self->b_stop)) {
+        drain_records(self);
+
+        if(get_time_ns() >= next_sync) {
+            if(self->b_dirty && fdatasync(self->fd) != 0) {
+                fail_journal(self, self->path);
+            }
+            self->b_dirty = false;
+            next_sync = get_time_ns() + JOURNAL_SYNC_MS * 1000000LL;
+        }
+
+        nanosleep(&poll, NULL);
+    }
+
+    drain_records(self);
+    if(self->b_dirty && fdatasync(self->fd) != 0) {
+        fail_journal(self, self->path);
+    }
+
+    return NULL;
+}
+
+// head is read before b_snapshot_pending, both seq_cst: a snapshot that is not seen yet is posted later, at a
+// sequence of at least head. so the drain never runs past a snapshot's sequence without starting its journal
+static void drain_records(journal_t* self) {
+    const unsigned int head = atomic_load(&self->head);
+    bool b_pending = atomic_load(&self->b_snapshot_pending);
+    unsigned int tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+
+    for(; tail != head; ++tail) {
+        if(b_pending && tail == self->snapshot.sequence) {
+            flush_batch(self);
+            start_journal(self);
+            b_pending = false;
+        }
+
+        self->batch[self->batch_count++] = self->records[tail & (JOURNAL_RING_SIZE - 1)];
+        if(self->batch_count == JOURNAL_BATCH) {
+            flush_batch(self);
+        }
+    }
+    flush_batch(self);
+    if(b_pending && tail == self->snapshot.sequence) {
+        start_journal(self);
+    }
+
+    atomic_store_explicit(&self->tail, tail, memory_order_release);
+}
+
+static void flush_batch(journal_t* self) {
+    if(self->batch_count > 0 && !self->b_failed && self->fd >= 0) {
+        if(write_all(self->fd, self->batch, sizeof(journal_record_t) * self->batch_count)) {
+            self->b_dirty = true;
+        } else {
+            fail_journal(self, self->path);
+        }
+    }
+    self->batch_count = 0;
+}
+
+// the snapshot is made durable first and the journal is truncated after it. a crash in between leaves the
+// old journal, whose serial no longer matches, so it is ignored
+static void start_journal(journal_t* self) {
+    journal_header_t header;
+    char journal_path[JOURNAL_PATH_SIZE + 16];
+
+    if(!self->b_failed) {
+        ++self->serial;
+        if(!write_snapshot(self)) {
+            fail_journal(self, self->path);
+        }
+    }
+
+    if(!self->b_failed) {
+        snprintf(journal_path, sizeof(journal_path), "%s.journal", self->path);
+        if(self->fd >= 0) {
+            close(self->fd);
+        }
+        self->fd = open(journal_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "TJNL", 4);
+        header.version = JOURNAL_VERSION;
+        header.serial = self->serial;
+        header.base_tick = self->snapshot.tick;
+        if(self->fd < 0 || !write_all(self->fd, &header, sizeof(header))) {
+            fail_journal(self, journal_path);
+        } else {
+            self->b_dirty = true;
+        }
+    }
+
+    atomic_store(&self->b_snapshot_pending, false);
+}
+
+// written next to the target, synced and renamed over it
+static bool write_snapshot(journal_t* self) {
+    const board_t* board = &self->snapshot.board;
+    journal_snapshot_header_t header;
+    char snapshot_path[JOURNAL_PATH_SIZE + 16];
+    char temp_path[JOURNAL_PATH_SIZE + 16];
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "TSNP", 4);
+    header.version = JOURNAL_VERSION;
+    header.serial = self->serial;
+    header.tick = self->snapshot.tick;
+    header.seed = self->snapshot.seed;
+    header.width = board->width;
+    header.height = board->height;
+
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s.snap", self->path);
+    snprintf(temp_path, sizeof(temp_path), "%s.snap.tmp", self->path);
+    const int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool b_ok = write_all(fd, &header, sizeof(header))
+        && write_all(fd, board->cells, sizeof(grid_square_t) * get_cell_count(board))
+        && write_all(fd, board->incoming_piece, sizeof(board->incoming_piece))
+        && write_all(fd, board->hold_piece, sizeof(board->hold_piece))
+        && write_all(fd, board->piece, sizeof(board->piece))
+        && write_all(fd, &board->game_state, sizeof(game_state_t))
+        && write_all(fd, &board->counter, sizeof(counter_t))
+        && write_all(fd, &board->rng_state, sizeof(board->rng_state))
+        && write_all(fd, &board->garbage_rng_state, sizeof(board->garbage_rng_state))
+        && write_all(fd, &board->pending_garbage, sizeof(board->pending_garbage))
+        && write_all(fd, &board->b_stray_moving, sizeof(board->b_stray_moving))
+        && write_all(fd, &board->top_row, sizeof(board->top_row))
+        && write_all(fd, &board->garbage_rows, sizeof(board->garbage_rows))
+        && write_all(fd, &board->dig_rows, sizeof(board->dig_rows))
+        && write_all(fd, &board->dug_rows, sizeof(board->dug_rows))
+        && fdatasync(fd) == 0;
+    b_ok = close(fd) == 0 && b_ok;
+    b_ok = b_ok && rename(temp_path, snapshot_path) == 0;
+    if(b_ok) {
+        sync_directory(self->path);
+    }
+
+    return b_ok;
+}
+
+// the game keeps going without autosave. the error is printed once
+static void fail_journal(journal_t* self, const char* path) {
+    if(!self->b_failed) {
+        perror(path);
+    }
+    self->b_failed = true;
+}
+
+// the rename is only durable once the directory entry is
+static void sync_directory(const char* path) {
+    char directory[JOURNAL_PATH_SIZE];
+    snprintf(directory, sizeof(directory), "%s", path);
+
+    char* slash = strrchr(directory, '/');
+    if(slash == NULL) {
+        snprintf(directory, sizeof(directory), ".");
+    } else if(slash == directory) {
+        slash[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+
+    const int fd = open(directory, O_RDONLY);
+    if(fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
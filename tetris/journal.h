@@ -0,0 +1,92 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "engine.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    JOURNAL_VERSION = 2, // version 1 에는 top_row, garbage_rows, dig_rows, dug_rows 가 없음
+    JOURNAL_RING_SIZE = 16384, // 2 의 거듭제곱. 60 fps 로 4 분 넘게 디스크가 멈춰도 버팀
+    JOURNAL_SNAPSHOT_TICKS = 600, // 이 tick 마다 snapshot 을 쓰고 journal 을 새로 시작
+    JOURNAL_SYNC_MS = 500, // writer 가 모아서 fdatasync 하는 간격
+    JOURNAL_POLL_MS = 20,
+    JOURNAL_BATCH = 1024, // write 한 번에 보내는 record 수
+    JOURNAL_PATH_SIZE = 512
+};
+
+// PATH.snap: the whole board after tick ticks, then PATH.journal continues it. the serial ties the two together,
+// a journal left over from an older snapshot is not replayed
+typedef struct journal_snapshot_header_t {
+    char magic[4]; // "TSNP"
+    uint32_t version;
+    uint64_t serial;
+    int64_t tick;
+    uint32_t seed;
+    int32_t width;
+    int32_t height;
+    uint32_t reserved;
+} journal_snapshot_header_t;
+
+// PATH.journal: the header, then one record per tick from base_tick on
+typedef struct journal_header_t {
+    char magic[4]; // "TJNL"
+    uint32_t version;
+    uint64_t serial;
+    int64_t base_tick;
+} journal_header_t;
+
+// tick 은 하위 16 bit 만. 끝이 잘리거나 0 으로 채워진 record 에서 replay 를 멈추는 데 씀
+typedef struct journal_record_t {
+    uint8_t down;
+    uint8_t pressed;
+    uint16_t tick;
+} journal_record_t;
+
+// the board as the game loop left it. the writer owns it while b_snapshot_pending is set
+typedef struct journal_snapshot_t {
+    board_t board;
+    unsigned int seed;
+    long tick;
+    unsigned int sequence; // 이 snapshot 이후의 첫 record 의 ring 위치
+} journal_snapshot_t;
+
+// single producer ring like telemetry_t, but a record is never dropped on its own: a full ring stops the journal
+// until the next snapshot, which starts it again from the board as it is then
+typedef struct journal_t {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head; // game loop 만 씀
+    unsigned int cached_tail;
+    bool b_need_snapshot; // ring 이 찼거나 game 이 step 밖에서 바뀜. snapshot 전까지 record 를 넣지 않음
+    long snapshot_tick;
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail; // writer 만 씀
+    atomic_bool b_snapshot_pending;
+    atomic_bool b_stop;
+    journal_record_t* records;
+    journal_snapshot_t snapshot;
+    pthread_t writer;
+    char path[JOURNAL_PATH_SIZE];
+    // 아래는 writer thread 만 만짐
+    int fd;
+    uint64_t serial;
+    bool b_dirty; // fdatasync 하지 않은 write 가 있음
+    bool b_failed;
+    journal_record_t batch[JOURNAL_BATCH];
+    int batch_count;
+} journal_t;
+
+// journal_t functions
+
+bool init_journal(journal_t* self, const char* path, const board_t* board, unsigned int seed, long tick);
+void free_journal(journal_t* self);
+void record_journal_step(journal_t* self, const board_t* board, input_t input, unsigned int seed, long tick);
+void mark_journal_reset(journal_t* self, const board_t* board, unsigned int seed, long tick);
+bool load_journal(const char* path, board_t* board, unsigned int* seed, long* tick);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,403 @@
+// monte carlo tree search over placements. every thread of the pool runs iterations on the same tree:
+// select down with PUCT, expand a leaf with all its placements, play a short guided playout and add the reward
+// back up the path. threads pass each other with virtual loss and a CAS on the node state, the tree has no lock
+
+#include <float.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "engine.h"
+#include "board_features.h"
+#include "bot.h"
+#include "thread_pool.h"
+#include "mcts.h"
+
+static const double MCTS_EXPLORATION = 1.5;
+
+enum {
+    MCTS_COMPARISON_TICKS = 20000, // --ticks 가 없을 때 비교 게임 하나의 최대 tick
+    MCTS_MAX_CHILDREN = 4 * (BOARD_MAX_WIDTH - PLACEMENT_MIN_X + 1)
+};
+
+static void run_mcts_worker(void* ctx, int index);
+static void run_iteration(mcts_t* self, mcts_worker_t* worker);
+static int expand_node(mcts_t* self, mcts_worker_t* worker, int index);
+static int select_child(const mcts_t* self, const mcts_node_t* node);
+static double run_playout(const mcts_t* self, mcts_worker_t* worker);
+static void init_node(mcts_node_t* node, placement_t placement, float prior);
+static void play_comparison_game(board_t* board, bot_t* bot, unsigned int seed, long tick_limit, int gravity);
+
+// --------------------------------------------------
+// mcts_t functions
+// --------------------------------------------------
+
+// one worker per pool thread, each with its own boards and random state
+bool init_mcts(mcts_t* self, thread_pool_t* pool, int width, int height, int iterations, unsigned int seed) {
+    bot_t defaults;
+
+    reset_bot(&defaults);
+    self->pool = pool;
+    self->weights = defaults.weights;
+    self->iterations = iterations > 0 ? iterations : MCTS_DEFAULT_ITERATIONS;
+    self->root_board = NULL;
+    self->worker_count = pool->thread_count;
+    self->nodes = malloc(sizeof(mcts_node_t) * MCTS_ARENA_NODES);
+    self->workers = calloc(self->worker_count, sizeof(mcts_worker_t));
+    if(self->nodes == NULL || self->workers == NULL) {
+        free_mcts(self);
+        return false;
+    }
+
+    for(int i = 0; i < self->worker_count; ++i) {
+        mcts_worker_t* worker = &self->workers[i];
+        worker->rng_state = (seed + (unsigned int)i) * 0x9e3779b9u ^ 0x7f4a7c15u;
+        if(worker->rng_state == 0) {
+            worker->rng_state = 0x7f4a7c15u;
+        }
+        if(!create_board(&worker->board, width, height) || !create_board(&worker->scratch, width, height) || !create_board(&worker->candidate, width, height)) {
+            free_mcts(self);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// workers come from calloc, so boards create_board did not reach are NULL and free_board skips them
+void free_mcts(mcts_t* self) {
+    for(int i = 0; self->workers != NULL && i < self->worker_count; ++i) {
+        free_board(&self->workers[i].board);
+        free_board(&self->workers[i].scratch);
+        free_board(&self->workers[i].candidate);
+    }
+    free(self->workers);
+    free(self->nodes);
+    self->workers = NULL;
+    self->nodes = NULL;
+}
+
+// board has an active piece. the arena is reset, so nothing of the previous move's tree is kept
+placement_t search_mcts(mcts_t* self, const board_t* board) {
+    const placement_t current = { 0, board->game_state.piece_position_x };
+    const mcts_node_t* root = &self->nodes[0];
+
+    init_node(&self->nodes[0], current, 1.0f);
+    atomic_store(&self->node_count, 1);
+    atomic_store(&self->iterations_started, 0);
+    self->root_board = board;
+
+    run_thread_pool(self->pool, self->worker_count, run_mcts_worker, self);
+
+    if(atomic_load(&root->state) != MCTS_EXPANDED) {
+        double score;
+        return find_best_placement(&self->weights, board, &self->workers[0].scratch, &score);
+    }
+
+    int best = root->first_child;
+    for(int i = root->first_child; i < root->first_child + root->child_count; ++i) {
+        if(atomic_load(&self->nodes[i].visits) > atomic_load(&self->nodes[best].visits)) {
+            best = i;
+        }
+    }
+
+    return self->nodes[best].placement;
+}
+
+// plays game_count seeds with the static evaluation bot and with the mcts bot under the same gravity, and prints
+// how long each survived
+int run_mcts_comparison(int game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, int iterations, int gravity) {
+    thread_pool_t pool;
+    mcts_t mcts;
+    board_t board;
+    bot_t heuristic;
+    bot_t searcher;
+    long heuristic_pieces = 0;
+    long heuristic_lines = 0;
+    long mcts_pieces = 0;
+    long mcts_lines = 0;
+    struct timespec begin;
+    struct timespec end;
+
+    if(!init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        return 1;
+    }
+    if(!init_mcts(&mcts, &pool, width, height, iterations, seed)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        return 1;
+    }
+    const bool b_board = create_board(&board, width, height);
+    const bool b_heuristic = init_bot(&heuristic, width, height);
+    const bool b_searcher = init_bot(&searcher, width, height);
+    if(!b_board || !b_heuristic || !b_searcher) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_board(&board);
+        free_bot(&heuristic);
+        free_bot(&searcher);
+        free_mcts(&mcts);
+        free_thread_pool(&pool);
+        return 1;
+    }
+    searcher.mcts = &mcts;
+
+    if(tick_limit <= 0) {
+        tick_limit = MCTS_COMPARISON_TICKS;
+    }
+
+    for(int k = 0; k < game_count; ++k) {
+        const unsigned int game_seed = seed + k;
+
+        play_comparison_game(&board, &heuristic, game_seed, tick_limit, gravity);
+        const int pieces = board.game_state.g_pieces;
+        const int lines = board.game_state.g_lines;
+        const bool b_alive = !board.game_state.b_game_over;
+
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        play_comparison_game(&board, &searcher, game_seed, tick_limit, gravity);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        const double milliseconds = (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6;
+
+        printf("seed %u: heuristic %d pieces, %d lines%s | mcts %d pieces, %d lines%s, %.1f ms/piece\n", game_seed,
+            pieces, lines, b_alive ? " (alive)" : "",
+            board.game_state.g_pieces, board.game_state.g_lines, board.game_state.b_game_over ? "" : " (alive)",
+            board.game_state.g_pieces > 0 ? milliseconds / board.game_state.g_pieces : 0);
+
+        heuristic_pieces += pieces;
+        heuristic_lines += lines;
+        mcts_pieces += board.game_state.g_pieces;
+        mcts_lines += board.game_state.g_lines;
+    }
+
+    printf("gravity %d, %d iterations on %d threads: heuristic %.1f pieces %.1f lines avg, mcts %.1f pieces %.1f lines avg\n",
+        gravity, mcts.iterations, pool.thread_count,
+        (double)heuristic_pieces / game_count, (double)heuristic_lines / game_count,
+        (double)mcts_pieces / game_count, (double)mcts_lines / game_count);
+
+    free_board(&board);
+    free_bot(&heuristic);
+    free_bot(&searcher);
+    free_mcts(&mcts);
+    free_thread_pool(&pool);
+
+    return 0;
+}
+
+// one pool task per worker. the iteration budget is shared, so a slow worker just runs fewer of them
+static void run_mcts_worker(void* ctx, int index) {
+    mcts_t* self = ctx;
+    mcts_worker_t* worker = &self->workers[index];
+
+    while(atomic_fetch_add_explicit(&self->iterations_started, 1, memory_order_relaxed) < self->iterations) {
+        run_iteration(self, worker);
+    }
+}
+
+// the tree keeps placements only, the boards along the path are played again from the root every iteration
+static void run_iteration(mcts_t* self, mcts_worker_t* worker) {
+    mcts_node_t* nodes = self->nodes;
+    int path[MCTS_MAX_DEPTH + 1];
+    int depth = 0;
+    int index = 0;
+    double reward;
+
+    copy_board(&worker->board, self->root_board);
+    path[0] = 0;
+    atomic_fetch_add_explicit(&nodes[0].virtual_loss, 1, memory_order_relaxed);
+
+    for(;;) {
+        mcts_node_t* node = &nodes[index];
+        int state = atomic_load_explicit(&node->state, memory_order_acquire);
+
+        // 새로 확장한 node 는 자식으로 내려가지 않고 여기서 playout
+        if(state == MCTS_LEAF && depth < MCTS_MAX_DEPTH
+            && atomic_compare_exchange_strong_explicit(&node->state, &state, MCTS_EXPANDING, memory_order_acquire, memory_order_acquire)) {
+            state = expand_node(self, worker, index);
+            reward = state == MCTS_TERMINAL ? 0 : run_playout(self, worker);
+            break;
+        }
+
+        if(state == MCTS_TERMINAL) {
+            reward = 0;
+            break;
+        }
+        if(state != MCTS_EXPANDED || depth == MCTS_MAX_DEPTH) {
+            reward = run_playout(self, worker);
+            break;
+        }
+
+        index = select_child(self, node);
+        path[++depth] = index;
+        atomic_fetch_add_explicit(&nodes[index].virtual_loss, 1, memory_order_relaxed);
+
+        // 자식은 확장할 때 시험해본 수라서 실패하면 게임이 끝난 경우뿐
+        if(!simulate_placement(&worker->board, nodes[index].placement) || worker->board.game_state.b_game_over || !wait_next_piece(&worker->board)) {
+            reward = 0;
+            break;
+        }
+    }
+
+    const long value = (long)(reward * MCTS_VALUE_SCALE);
+    for(int i = 0; i <= depth; ++i) {
+        atomic_fetch_add_explicit(&nodes[path[i]].visits, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&nodes[path[i]].value, value, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&nodes[path[i]].virtual_loss, 1, memory_order_relaxed);
+    }
+}
+
+// called by the one thread that won the CAS. placements that end on the same grid become one child.
+// when the arena is full the node stays EXPANDING, which every thread treats as a leaf
+static int expand_node(mcts_t* self, mcts_worker_t* worker, int index) {
+    const board_t* board = &worker->board;
+    mcts_node_t* node = &self->nodes[index];
+    placement_t placements[MCTS_MAX_CHILDREN];
+    double scores[MCTS_MAX_CHILDREN];
+    uint64_t hashes[MCTS_MAX_CHILDREN];
+    double min_score = DBL_MAX;
+    double max_score = -DBL_MAX;
+    int count = 0;
+
+    for(int rotation = 0; rotation < 4; ++rotation) {
+        for(int x = PLACEMENT_MIN_X; x <= board->width; ++x) {
+            const placement_t placement = { rotation, x };
+
+            copy_board(&worker->scratch, board);
+            if(!simulate_placement(&worker->scratch, placement) || worker->scratch.game_state.b_game_over) {
+                continue;
+            }
+
+            const uint64_t hash = hash_grid(&worker->scratch);
+            bool b_seen = false;
+            for(int k = 0; k < count && !b_seen; ++k) {
+                b_seen = hashes[k] == hash;
+            }
+            if(b_seen) {
+                continue;
+            }
+
+            placements[count] = placement;
+            hashes[count] = hash;
+            scores[count] = evaluate_grid(&self->weights, &worker->scratch);
+            min_score = scores[count] < min_score ? scores[count] : min_score;
+            max_score = scores[count] > max_score ? scores[count] : max_score;
+            ++count;
+        }
+    }
+
+    if(count == 0) {
+        atomic_store_explicit(&node->state, MCTS_TERMINAL, memory_order_release);
+        return MCTS_TERMINAL;
+    }
+
+    const int first = atomic_fetch_add_explicit(&self->node_count, count, memory_order_relaxed);
+    if(first + count > MCTS_ARENA_NODES) {
+        return MCTS_EXPANDING;
+    }
+
+    for(int k = 0; k < count; ++k) {
+        const float prior = max_score > min_score ? (float)((scores[k] - min_score) / (max_score - min_score)) : 1.0f;
+        init_node(&self->nodes[first + k], placements[k], prior);
+    }
+    node->first_child = first;
+    node->child_count = count;
+    atomic_store_explicit(&node->state, MCTS_EXPANDED, memory_order_release);
+
+    return MCTS_EXPANDED;
+}
+
+// PUCT. a child being searched by other threads counts their visits as losses, so the next thread tends elsewhere.
+// unvisited children start from the parent's mean
+static int select_child(const mcts_t* self, const mcts_node_t* node) {
+    const int parent_visits = atomic_load_explicit(&node->visits, memory_order_relaxed);
+    const double parent_mean = parent_visits > 0 ? (double)atomic_load_explicit(&node->value, memory_order_relaxed) / MCTS_VALUE_SCALE / parent_visits : 0.5;
+    const double exploration = MCTS_EXPLORATION * sqrt(parent_visits + atomic_load_explicit(&node->virtual_loss, memory_order_relaxed));
+    int best = node->first_child;
+    double best_score = -DBL_MAX;
+
+    for(int i = node->first_child; i < node->first_child + node->child_count; ++i) {
+        const mcts_node_t* child = &self->nodes[i];
+        const int visits = atomic_load_explicit(&child->visits, memory_order_relaxed) + atomic_load_explicit(&child->virtual_loss, memory_order_relaxed);
+        const double mean = visits > 0 ? (double)atomic_load_explicit(&child->value, memory_order_relaxed) / MCTS_VALUE_SCALE / visits : parent_mean;
+        const double score = mean + exploration * child->prior / (1 + visits);
+
+        if(score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// a few pieces, each the best by static evaluation of MCTS_PLAYOUT_CANDIDATES random placements.
+// reward: half for surviving the playout, the other half for how low the stack ends
+static double run_playout(const mcts_t* self, mcts_worker_t* worker) {
+    board_t* board = &worker->board;
+    board_features_t features;
+
+    if(board->game_state.b_game_over) {
+        return 0;
+    }
+
+    for(int piece = 0; piece < MCTS_PLAYOUT_PIECES; ++piece) {
+        placement_t best = { 0, 0 };
+        double best_score = -DBL_MAX;
+        int found = 0;
+
+        for(int tries = 0; tries < MCTS_PLAYOUT_CANDIDATES * 4 && found < MCTS_PLAYOUT_CANDIDATES; ++tries) {
+            const placement_t placement = {
+                next_random_value(&worker->rng_state, 0, 3),
+                next_random_value(&worker->rng_state, PLACEMENT_MIN_X, board->width)
+            };
+
+            copy_board(&worker->candidate, board);
+            if(!simulate_placement(&worker->candidate, placement) || worker->candidate.game_state.b_game_over) {
+                continue;
+            }
+
+            const double score = evaluate_grid(&self->weights, &worker->candidate);
+            if(score > best_score) {
+                best_score = score;
+                best = placement;
+            }
+            ++found;
+        }
+
+        if(found == 0 || !simulate_placement(board, best) || board->game_state.b_game_over || !wait_next_piece(board)) {
+            return 0.5 * piece / MCTS_PLAYOUT_PIECES;
+        }
+    }
+
+    extract_features(board, 1, &features);
+
+    return 0.5 + 0.5 * (1.0 - (double)features.max_height / board->height);
+}
+
+static void init_node(mcts_node_t* node, placement_t placement, float prior) {
+    node->placement = placement;
+    node->first_child = -1;
+    node->child_count = 0;
+    node->prior = prior;
+    atomic_init(&node->state, MCTS_LEAF);
+    atomic_init(&node->visits, 0);
+    atomic_init(&node->virtual_loss, 0);
+    atomic_init(&node->value, 0);
+}
+
+static void play_comparison_game(board_t* board, bot_t* bot, unsigned int seed, long tick_limit, int gravity) {
+    input_t input;
+
+    init_board(board, seed);
+    set_begin_game(&board->game_state, true);
+    set_gravity_speed(&board->game_state, gravity);
+    reset_bot(bot);
+
+    for(long tick = 0; tick < tick_limit && !board->game_state.b_game_over; ++tick) {
+        get_bot_input(bot, board, &input);
+        step_board(board, input);
+    }
+}
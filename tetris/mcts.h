@@ -0,0 +1,71 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "engine.h"
+#include "bot.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    MCTS_DEFAULT_ITERATIONS = 256, // 수 하나를 고를 때 playout 수
+    MCTS_ARENA_NODES = 1 << 18, // 수 하나에 쓰는 최대 node 수
+    MCTS_MAX_DEPTH = 32,
+    MCTS_PLAYOUT_PIECES = 6,
+    MCTS_PLAYOUT_CANDIDATES = 3, // playout 에서 무작위로 뽑아 평가해보는 수
+    MCTS_VALUE_SCALE = 1 << 20, // reward 는 0..1, atomic 정수로 더하기 위해 고정 소수점
+    MCTS_DEFAULT_GRAVITY = 2 // --mcts 비교의 중력. 기본 게임은 30 tick 에 한 줄
+};
+
+typedef enum mcts_node_state {
+    MCTS_LEAF,
+    MCTS_EXPANDING, // 한 thread 가 자식을 만드는 중. 다른 thread 는 leaf 로 취급
+    MCTS_EXPANDED,
+    MCTS_TERMINAL // 놓을 수 있는 수가 없음
+} mcts_node_state_t;
+
+// one placement after the parent's. children are contiguous in the arena and written before state becomes EXPANDED
+typedef struct mcts_node_t {
+    placement_t placement;
+    int first_child;
+    int child_count;
+    float prior; // 자식들 사이에서 정적 평가를 0..1 로 맞춘 값
+    atomic_int state;
+    atomic_int visits;
+    atomic_int virtual_loss; // 이 node 를 지나는 중인 thread 수. 아직 0 점으로 계산됨
+    atomic_long value; // reward 합 * MCTS_VALUE_SCALE
+} mcts_node_t;
+
+// what one pool task owns: boards to replay the path on and its own random state
+typedef struct mcts_worker_t {
+    board_t board;
+    board_t scratch;
+    board_t candidate;
+    unsigned int rng_state;
+} mcts_worker_t;
+
+// the tree lives in an arena allocated once and reset before every move, so a search does no malloc
+typedef struct mcts_t {
+    thread_pool_t* pool;
+    bot_weights_t weights; // 자식 prior 와 playout 에 쓰는 정적 평가
+    int iterations;
+    mcts_node_t* nodes;
+    atomic_int node_count;
+    atomic_int iterations_started;
+    const board_t* root_board;
+    mcts_worker_t* workers; // pool 의 thread 마다 하나
+    int worker_count;
+} mcts_t;
+
+// mcts_t functions
+
+bool init_mcts(mcts_t* self, thread_pool_t* pool, int width, int height, int iterations, unsigned int seed);
+void free_mcts(mcts_t* self);
+placement_t search_mcts(mcts_t* self, const board_t* board);
+int run_mcts_comparison(int game_count, unsigned int seed, int thread_count, long tick_limit, int width, int height, int iterations, int gravity);
+
+#endif /* MCTS_H */
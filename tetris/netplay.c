@@ -0,0 +1,582 @@
+// rollback versus between two processes over UDP. both simulate the same two-board versus_t; each sends its own
+// keys every frame and runs ahead on a prediction of the peer's, which is the peer's last confirmed keys held down.
+// when the real keys arrive and differ, the match goes back to the snapshot taken before that tick and is simulated
+// forward again inside the same frame. step_board is deterministic and a snapshot is a copy_versus, so both are cheap
+//
+//   tetris --netplay 7001 127.0.0.1:7002 --headless --net-delay 40 --net-loss 5
+//   tetris --netplay 7002 127.0.0.1:7001 --headless --net-delay 40 --net-loss 5
+//
+// --net-delay and --net-loss are applied to the packets this process sends, for testing on loopback
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+#include "io.h"
+#include "thread_pool.h"
+#include "versus.h"
+#include "netplay.h"
+
+typedef enum frame_action {
+    FRAME_STEP,
+    FRAME_STALL, // 상대 input 이 너무 밀림
+    FRAME_SYNC, // 상대보다 앞서 있어서 한 frame 쉼
+    FRAME_IDLE // 게임 중이 아니거나 끝났는데 아직 확정되지 않음
+} frame_action_t;
+
+static int open_socket(int port, const char* peer);
+static void receive_packet(netplay_t* self, const netplay_packet_t* packet);
+static void start_match(netplay_t* self, const netplay_packet_t* packet);
+static void roll_back(netplay_t* self);
+static void simulate_tick(netplay_t* self, long tick);
+static void get_netplay_input(void* ctx, int board_index, const board_t* board, input_t* input);
+static frame_action_t get_frame_action(const netplay_t* self);
+static void check_finish(netplay_t* self);
+static void compare_checksums(netplay_t* self);
+static const netplay_checksum_t* find_checksum(const netplay_t* self, long tick);
+static uint32_t hash_versus(const versus_t* versus);
+static void send_state(netplay_t* self);
+static void fill_packet(const netplay_t* self, netplay_packet_t* packet);
+static void transmit_packet(netplay_t* self, const netplay_packet_t* packet, int size);
+static void flush_delayed(netplay_t* self);
+
+// --------------------------------------------------
+// netplay_t functions
+// --------------------------------------------------
+
+// binds port on every interface and only talks to peer, "HOST:PORT". the match starts when the peer's first packet
+// arrives; until then seed, width and height are what this side offers
+bool init_netplay(netplay_t* self, int port, const char* peer, unsigned int seed, int width, int height, long tick_limit, int delay_ms, int loss_percent) {
+    // 0 으로 채워두면 만들다 만 versus_t 도 free_netplay 로 정리됨
+    memset(self, 0, sizeof(netplay_t));
+    self->fd = -1;
+
+    if(!init_thread_pool(&self->pool, 1)) {
+        return false;
+    }
+    self->delayed = malloc(sizeof(netplay_delayed_t) * NETPLAY_DELAY_QUEUE);
+    bool b_ready = self->delayed != NULL && init_versus(&self->versus, 2, width, height, seed, &self->pool, get_netplay_input, self);
+    for(int i = 0; b_ready && i < NETPLAY_SNAPSHOT_RING; ++i) {
+        b_ready = init_versus(&self->snapshots[i], 2, width, height, seed, &self->pool, get_netplay_input, self);
+    }
+    if(b_ready) {
+        self->fd = open_socket(port, peer);
+    }
+    if(self->fd < 0) {
+        free_netplay(self);
+        return false;
+    }
+
+    // pid 를 섞어서 같은 시각에 뜬 두 process 도 다른 nonce
+    self->nonce = (uint32_t)get_time_ns() ^ (uint32_t)getpid() * 0x9e3779b9u;
+    self->loss_rng_state = self->nonce | 1;
+    self->status = NETPLAY_CONNECTING;
+    self->seed = seed;
+    self->width = width;
+    self->height = height;
+    self->tick_limit = tick_limit;
+    self->rollback_tick = -1;
+    self->peer_checksum_tick = -1;
+    self->last_checksum_tick = -1;
+    for(int i = 0; i < NETPLAY_CHECKSUM_RING; ++i) {
+        self->checksums[i].tick = -1;
+    }
+    self->delay_ms = delay_ms;
+    self->loss_percent = loss_percent;
+    self->last_receive_ns = get_time_ns();
+
+    return true;
+}
+
+void free_netplay(netplay_t* self) {
+    if(self->fd >= 0) {
+        close(self->fd);
+    }
+    self->fd = -1;
+    free_versus(&self->versus);
+    for(int i = 0; i < NETPLAY_SNAPSHOT_RING; ++i) {
+        free_versus(&self->snapshots[i]);
+    }
+    free(self->delayed);
+    self->delayed = NULL;
+    free_thread_pool(&self->pool);
+}
+
+// start of a frame: every packet that arrived, then one rollback to the earliest wrong prediction
+void poll_netplay(netplay_t* self) {
+    netplay_packet_t packet;
+
+    if(self->status != NETPLAY_CONNECTING && self->status != NETPLAY_RUNNING && self->status != NETPLAY_FINISHED) {
+        return;
+    }
+
+    for(;;) {
+        const ssize_t size = recv(self->fd, &packet, sizeof(packet), 0);
+        if(size < 0) {
+            // 상대 process 가 아직 없으면 ICMP 때문에 ECONNREFUSED 가 옴
+            if(errno == EINTR || errno == ECONNREFUSED) {
+                continue;
+            }
+            break;
+        }
+
+        const size_t header_size = offsetof(netplay_packet_t, inputs);
+        if((size_t)size < header_size || memcmp(packet.magic, "TNET", 4) != 0 || packet.input_count > NETPLAY_PACKET_INPUTS ||
+            (size_t)size != header_size + sizeof(input_t) * packet.input_count) {
+            continue;
+        }
+        if(packet.version != NETPLAY_VERSION) {
+            self->status = NETPLAY_MISMATCH;
+            return;
+        }
+
+        receive_packet(self, &packet);
+        if(self->status != NETPLAY_CONNECTING && self->status != NETPLAY_RUNNING && self->status != NETPLAY_FINISHED) {
+            return;
+        }
+    }
+
+    const long long timeout_ms = self->status == NETPLAY_CONNECTING ? NETPLAY_CONNECT_MS : NETPLAY_TIMEOUT_MS;
+    if(self->status != NETPLAY_FINISHED && get_time_ns() - self->last_receive_ns > timeout_ms * 1000000LL) {
+        self->status = NETPLAY_PEER_LOST;
+        return;
+    }
+
+    if(self->status == NETPLAY_RUNNING && self->rollback_tick >= 0) {
+        roll_back(self);
+    }
+    if(self->status == NETPLAY_RUNNING) {
+        compare_checksums(self);
+        check_finish(self);
+    }
+}
+
+// whether advance_netplay will use the input of this frame. bots and the keyboard are only read when it does
+bool can_step_netplay(const netplay_t* self) {
+    return get_frame_action(self) == FRAME_STEP;
+}
+
+// end of a frame: one new tick when the remote inputs are not too far behind, then this side's state goes out
+void advance_netplay(netplay_t* self, input_t input) {
+    struct timespec begin;
+    struct timespec end;
+
+    if(self->status == NETPLAY_RUNNING) {
+        const long tick = self->versus.ticks;
+
+        ++(self->stats.frames);
+        switch(get_frame_action(self)) {
+            case FRAME_STEP:
+                // versus 에는 pause 가 없음
+                input.down &= ~INPUT_PAUSE;
+                input.pressed &= ~INPUT_PAUSE;
+                self->local_inputs[tick & (NETPLAY_INPUT_RING - 1)] = input;
+
+                clock_gettime(CLOCK_MONOTONIC, &begin);
+                simulate_tick(self, tick);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                self->stats.step_us += (end.tv_sec - begin.tv_sec) * 1.0e6 + (end.tv_nsec - begin.tv_nsec) / 1.0e3;
+                check_finish(self);
+                break;
+            case FRAME_STALL:
+                ++(self->stats.stall_frames);
+                break;
+            case FRAME_SYNC:
+                ++(self->stats.sync_frames);
+                self->last_sync_frame = self->stats.frames;
+                break;
+            case FRAME_IDLE:
+                break;
+        }
+    }
+
+    if(self->status == NETPLAY_CONNECTING || self->status == NETPLAY_RUNNING || self->status == NETPLAY_FINISHED) {
+        send_state(self);
+    }
+    flush_delayed(self);
+}
+
+// finished once the peer has every local input, or after NETPLAY_LINGER_MS when its acks are lost
+bool is_netplay_done(const netplay_t* self) {
+    switch(self->status) {
+        case NETPLAY_CONNECTING:
+        case NETPLAY_RUNNING:
+            return false;
+        case NETPLAY_FINISHED:
+            return self->peer_ack >= self->versus.ticks || get_time_ns() - self->finish_ns > NETPLAY_LINGER_MS * 1000000LL;
+        default:
+            return true;
+    }
+}
+
+// leaving early. sent a few times right away, past the simulated delay and loss; a peer that misses them times out
+void quit_netplay(netplay_t* self) {
+    netplay_packet_t packet;
+
+    if(self->status != NETPLAY_CONNECTING && self->status != NETPLAY_RUNNING) {
+        return;
+    }
+
+    fill_packet(self, &packet);
+    packet.flags |= NETPLAY_FLAG_QUIT;
+    packet.input_count = 0;
+    for(int i = 0; i < NETPLAY_QUIT_PACKETS; ++i) {
+        send(self->fd, &packet, offsetof(netplay_packet_t, inputs), 0);
+    }
+}
+
+// the predicted state for drawing and for the local bot
+const board_t* get_netplay_board(const netplay_t* self, int side) {
+    return &self->versus.boards[side];
+}
+
+const char* get_netplay_status_name(netplay_status_t status) {
+    switch(status) {
+        case NETPLAY_CONNECTING:
+            return "connecting";
+        case NETPLAY_RUNNING:
+            return "running";
+        case NETPLAY_FINISHED:
+            return "finished";
+        case NETPLAY_PEER_QUIT:
+            return "peer quit";
+        case NETPLAY_PEER_LOST:
+            return "peer lost";
+        case NETPLAY_MISMATCH:
+            return "peer has another version or board size";
+        default:
+            return "desynced";
+    }
+}
+
+static int open_socket(int port, const char* peer) {
+    struct sockaddr_in address;
+    struct addrinfo hints;
+    struct addrinfo* result;
+    char host[256];
+
+    const char* colon = strrchr(peer, ':');
+    if(colon == NULL || colon == peer || (size_t)(colon - peer) >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, peer, colon - peer);
+    host[colon - peer] = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if(getaddrinfo(host, colon + 1, &hints, &result) != 0) {
+        return -1;
+    }
+
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        freeaddrinfo(result);
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    // connect 해두면 peer 가 보낸 datagram 만 받음
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        freeaddrinfo(result);
+        close(fd);
+        return -1;
+    }
+
+    freeaddrinfo(result);
+
+    return fd;
+}
+
+static void receive_packet(netplay_t* self, const netplay_packet_t* packet) {
+    ++(self->stats.packets_received);
+    self->last_receive_ns = get_time_ns();
+
+    if(self->status == NETPLAY_CONNECTING) {
+        // 같은 nonce 면 side 를 정할 수 없으니 다시 뽑고 다음 packet 을 기다림
+        if(packet->nonce == self->nonce) {
+            self->nonce = self->nonce * 0x2545f491u + 1;
+            return;
+        }
+        if(packet->width != self->width || packet->height != self->height) {
+            self->status = NETPLAY_MISMATCH;
+            return;
+        }
+        start_match(self, packet);
+    } else if(packet->nonce != self->peer_nonce) {
+        return; // 이전 세션의 packet
+    }
+
+    if(packet->flags & NETPLAY_FLAG_QUIT) {
+        if(self->status == NETPLAY_RUNNING) {
+            self->status = NETPLAY_PEER_QUIT;
+        }
+        return;
+    }
+
+    if(packet->ack > self->peer_ack) {
+        self->peer_ack = packet->ack;
+    }
+    if(packet->tick >= self->peer_tick) {
+        self->peer_tick = packet->tick;
+        self->peer_advantage = packet->advantage;
+    }
+
+    // 빠짐없이 이어지는 부분만 받음. 이미 simulate 한 tick 이면 그때 쓴 예측과 비교
+    const long end = (long)packet->first_tick + packet->input_count;
+    if(packet->first_tick <= self->remote_count) {
+        for(long tick = self->remote_count; tick < end; ++tick) {
+            input_t* slot = &self->remote_inputs[tick & (NETPLAY_INPUT_RING - 1)];
+            const input_t input = packet->inputs[tick - packet->first_tick];
+
+            if(tick < self->versus.ticks && (slot->down != input.down || slot->pressed != input.pressed) && (self->rollback_tick < 0 || tick < self->rollback_tick)) {
+                self->rollback_tick = tick;
+            }
+            *slot = input;
+        }
+        if(end > self->remote_count) {
+            self->remote_count = end;
+        }
+    }
+
+    if(packet->checksum_tick > self->peer_checksum_tick && packet->checksum_tick > self->last_checksum_tick) {
+        self->peer_checksum_tick = packet->checksum_tick;
+        self->peer_checksum = packet->checksum;
+    }
+}
+
+// the smaller nonce is side 0 and its seed is the match seed, so the two sides need not agree on --seed
+static void start_match(netplay_t* self, const netplay_packet_t* packet) {
+    self->peer_nonce = packet->nonce;
+    self->side = self->nonce < self->peer_nonce ? 0 : 1;
+    if(self->side == 1) {
+        self->seed = packet->seed;
+    }
+    reset_versus(&self->versus, self->seed);
+    self->status = NETPLAY_RUNNING;
+}
+
+// back to the snapshot before the first wrong prediction and forward again to where the frame was
+static void roll_back(netplay_t* self) {
+    struct timespec begin;
+    struct timespec end;
+    const long first = self->rollback_tick;
+    const long last = self->versus.ticks;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    copy_versus(&self->versus, &self->snapshots[first & (NETPLAY_SNAPSHOT_RING - 1)]);
+    for(long tick = first; tick < last; ++tick) {
+        simulate_tick(self, tick);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double us = (end.tv_sec - begin.tv_sec) * 1.0e6 + (end.tv_nsec - begin.tv_nsec) / 1.0e3;
+    const int ticks = (int)(last - first);
+    ++(self->stats.rollbacks);
+    self->stats.resimulated_ticks += ticks;
+    self->stats.resimulation_us += us;
+    if(ticks > self->stats.max_resimulated_ticks) {
+        self->stats.max_resimulated_ticks = ticks;
+    }
+    if(us > self->stats.max_resimulation_us) {
+        self->stats.max_resimulation_us = us;
+    }
+    self->rollback_tick = -1;
+}
+
+// snapshot, then one versus tick. a remote input that has not arrived is predicted and kept for the comparison
+static void simulate_tick(netplay_t* self, long tick) {
+    const int remote = 1 - self->side;
+    input_t* remote_input = &self->remote_inputs[tick & (NETPLAY_INPUT_RING - 1)];
+
+    copy_versus(&self->snapshots[tick & (NETPLAY_SNAPSHOT_RING - 1)], &self->versus);
+    if(tick % NETPLAY_CHECKSUM_TICKS == 0) {
+        netplay_checksum_t* checksum = &self->checksums[tick / NETPLAY_CHECKSUM_TICKS % NETPLAY_CHECKSUM_RING];
+        checksum->tick = tick;
+        checksum->checksum = hash_versus(&self->versus);
+    }
+
+    // 마지막으로 확정된 키를 계속 누르고 있다고 예측
+    if(tick >= self->remote_count) {
+        remote_input->down = self->remote_count > 0 ? self->remote_inputs[(self->remote_count - 1) & (NETPLAY_INPUT_RING - 1)].down : 0;
+        remote_input->pressed = 0;
+    }
+
+    self->step_inputs[self->side] = self->local_inputs[tick & (NETPLAY_INPUT_RING - 1)];
+    self->step_inputs[remote] = *remote_input;
+    step_versus(&self->versus);
+}
+
+static void get_netplay_input(void* ctx, int board_index, const board_t* board, input_t* input) {
+    const netplay_t* self = ctx;
+    (void)board;
+    *input = self->step_inputs[board_index];
+}
+
+// the side that runs ahead of the peer by NETPLAY_SYNC_TICKS waits a frame now and then, so neither keeps stalling
+static frame_action_t get_frame_action(const netplay_t* self) {
+    const long tick = self->versus.ticks;
+
+    if(self->status != NETPLAY_RUNNING || is_versus_over(&self->versus) || (self->tick_limit > 0 && tick >= self->tick_limit)) {
+        return FRAME_IDLE;
+    }
+    if(tick - self->remote_count >= NETPLAY_MAX_ROLLBACK) {
+        return FRAME_STALL;
+    }
+
+    const long advantage = tick - self->remote_count;
+    if((advantage - self->peer_advantage) / 2 >= NETPLAY_SYNC_TICKS && self->stats.frames - self->last_sync_frame >= NETPLAY_SYNC_FRAMES) {
+        return FRAME_SYNC;
+    }
+
+    return FRAME_STEP;
+}
+
+// the match is over when its end no longer depends on a prediction
+static void check_finish(netplay_t* self) {
+    const long tick = self->versus.ticks;
+
+    if(self->remote_count >= tick && (is_versus_over(&self->versus) || (self->tick_limit > 0 && tick >= self->tick_limit))) {
+        self->status = NETPLAY_FINISHED;
+        self->finish_ns = get_time_ns();
+    }
+}
+
+// the state before tick t is confirmed once the remote inputs up to t are in
+static void compare_checksums(netplay_t* self) {
+    const long confirmed = self->remote_count < self->versus.ticks - 1 ? self->remote_count : self->versus.ticks - 1;
+
+    if(self->peer_checksum_tick < 0 || self->peer_checksum_tick > confirmed) {
+        return;
+    }
+
+    // ring 에서 밀려난 오래된 checksum 은 버림
+    const netplay_checksum_t* checksum = find_checksum(self, self->peer_checksum_tick);
+    self->last_checksum_tick = self->peer_checksum_tick;
+    if(checksum != NULL) {
+        ++(self->stats.checksums);
+        if(checksum->checksum != self->peer_checksum) {
+            self->status = NETPLAY_DESYNCED;
+        }
+    }
+    self->peer_checksum_tick = -1;
+}
+
+static const netplay_checksum_t* find_checksum(const netplay_t* self, long tick) {
+    const netplay_checksum_t* checksum = &self->checksums[tick / NETPLAY_CHECKSUM_TICKS % NETPLAY_CHECKSUM_RING];
+    return tick % NETPLAY_CHECKSUM_TICKS == 0 && checksum->tick == tick ? checksum : NULL;
+}
+
+// cells with the moving piece, the generators and the counters that decide the next ticks
+static uint32_t hash_versus(const versus_t* versus) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for(int i = 0; i < versus->board_count; ++i) {
+        const board_t* board = &versus->boards[i];
+        const size_t count = get_cell_count(board);
+        const int64_t fields[] = {
+            board->game_state.g_lines, board->game_state.g_pieces, board->game_state.piece_position_x, board->game_state.piece_position_y,
+            board->rng_state, board->garbage_rng_state, board->pending_garbage, board->top_row, versus->placement[i]
+        };
+
+        for(size_t k = 0; k < count; ++k) {
+            hash = (hash ^ (uint64_t)board->cells[k]) * 0x100000001b3ull;
+        }
+        for(size_t k = 0; k < sizeof(fields) / sizeof(fields[0]); ++k) {
+            hash = (hash ^ (uint64_t)fields[k]) * 0x100000001b3ull;
+        }
+    }
+    hash = (hash ^ versus->rng_state) * 0x100000001b3ull;
+
+    return (uint32_t)(hash ^ hash >> 32);
+}
+
+static void send_state(netplay_t* self) {
+    netplay_packet_t packet;
+
+    fill_packet(self, &packet);
+    transmit_packet(self, &packet, (int)(offsetof(netplay_packet_t, inputs) + sizeof(input_t) * packet.input_count));
+}
+
+// every local input from the peer's ack on, and the newest confirmed checksum
+static void fill_packet(const netplay_t* self, netplay_packet_t* packet) {
+    const long tick = self->status == NETPLAY_CONNECTING ? 0 : self->versus.ticks;
+    long count = tick - self->peer_ack;
+
+    if(count > NETPLAY_PACKET_INPUTS) {
+        count = NETPLAY_PACKET_INPUTS;
+    }
+
+    memcpy(packet->magic, "TNET", 4);
+    packet->version = NETPLAY_VERSION;
+    packet->flags = 0;
+    packet->input_count = (uint8_t)count;
+    packet->reserved = 0;
+    packet->nonce = self->nonce;
+    packet->seed = self->seed;
+    packet->width = (uint16_t)self->width;
+    packet->height = (uint16_t)self->height;
+    packet->tick = (int32_t)tick;
+    packet->advantage = (int32_t)(tick - self->remote_count);
+    packet->ack = (int32_t)self->remote_count;
+    packet->first_tick = (int32_t)self->peer_ack;
+    for(long i = 0; i < count; ++i) {
+        packet->inputs[i] = self->local_inputs[(self->peer_ack + i) & (NETPLAY_INPUT_RING - 1)];
+    }
+
+    const long confirmed = self->remote_count < tick - 1 ? self->remote_count : tick - 1;
+    const netplay_checksum_t* checksum = confirmed >= 0 ? find_checksum(self, confirmed / NETPLAY_CHECKSUM_TICKS * NETPLAY_CHECKSUM_TICKS) : NULL;
+    packet->checksum_tick = checksum != NULL ? (int32_t)checksum->tick : -1;
+    packet->checksum = checksum != NULL ? checksum->checksum : 0;
+}
+
+// the simulated network: a packet is dropped with loss_percent, otherwise held for delay_ms
+static void transmit_packet(netplay_t* self, const netplay_packet_t* packet, int size) {
+    ++(self->stats.packets_sent);
+
+    if(self->loss_percent > 0 && next_random_value(&self->loss_rng_state, 0, 99) < self->loss_percent) {
+        ++(self->stats.packets_dropped);
+        return;
+    }
+    if(self->delay_ms == 0) {
+        send(self->fd, packet, size, 0);
+        return;
+    }
+
+    // 가득 차면 잃어버린 것으로 침
+    if(self->delayed_tail - self->delayed_head == NETPLAY_DELAY_QUEUE) {
+        ++(self->stats.packets_dropped);
+        return;
+    }
+    netplay_delayed_t* delayed = &self->delayed[self->delayed_tail & (NETPLAY_DELAY_QUEUE - 1)];
+    delayed->release_ns = get_time_ns() + self->delay_ms * 1000000LL;
+    delayed->size = size;
+    memcpy(&delayed->packet, packet, size);
+    ++(self->delayed_tail);
+}
+
+// delay is the same for every packet, so the queue releases in order
+static void flush_delayed(netplay_t* self) {
+    const long long now = get_time_ns();
+
+    while(self->delayed_head != self->delayed_tail) {
+        const netplay_delayed_t* delayed = &self->delayed[self->delayed_head & (NETPLAY_DELAY_QUEUE - 1)];
+        if(delayed->release_ns > now) {
+            break;
+        }
+        send(self->fd, &delayed->packet, delayed->size, 0);
+        ++(self->delayed_head);
+    }
+}
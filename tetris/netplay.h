@@ -0,0 +1,146 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "engine.h"
+#include "thread_pool.h"
+#include "versus.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    NETPLAY_VERSION = 1,
+    NETPLAY_MAX_ROLLBACK = 10, // 확정되지 않은 상대 input 으로 앞서 갈 수 있는 tick 수. 넘으면 상대를 기다림
+    NETPLAY_SNAPSHOT_RING = 16, // 2 의 거듭제곱, NETPLAY_MAX_ROLLBACK 보다 큼
+    NETPLAY_INPUT_RING = 64, // 2 의 거듭제곱, NETPLAY_PACKET_INPUTS 이상
+    NETPLAY_PACKET_INPUTS = 32, // ack 되지 않은 내 input 은 2 * NETPLAY_MAX_ROLLBACK + 1 을 넘지 않음
+    NETPLAY_CHECKSUM_TICKS = 60, // 이 tick 마다 확정된 상태의 checksum 을 주고받음
+    NETPLAY_CHECKSUM_RING = 4,
+    NETPLAY_SYNC_TICKS = 2, // 상대보다 이만큼 앞서면 frame 하나를 쉬어서 맞춤
+    NETPLAY_SYNC_FRAMES = 10, // 맞추려고 쉬는 frame 사이의 최소 간격
+    NETPLAY_DELAY_QUEUE = 256, // 2 의 거듭제곱. 흉내 낸 지연 중인 packet
+    NETPLAY_MAX_DELAY_MS = 2000,
+    NETPLAY_CONNECT_MS = 30000, // 상대 process 가 뜰 때까지 기다리는 시간
+    NETPLAY_TIMEOUT_MS = 5000, // 게임 중에 packet 이 이만큼 안 오면 끊긴 것으로 봄
+    NETPLAY_LINGER_MS = 1000, // 끝난 뒤 상대가 내 마지막 input 을 받을 때까지 보내는 시간
+    NETPLAY_QUIT_PACKETS = 3
+};
+
+enum {
+    NETPLAY_FLAG_QUIT = 1 << 0
+};
+
+typedef enum netplay_status {
+    NETPLAY_CONNECTING,
+    NETPLAY_RUNNING,
+    NETPLAY_FINISHED, // 확정된 상태에서 승부가 났거나 tick_limit 에 닿음
+    NETPLAY_PEER_QUIT,
+    NETPLAY_PEER_LOST,
+    NETPLAY_MISMATCH, // 상대가 다른 version 이거나 다른 board 크기
+    NETPLAY_DESYNCED // checksum 이 다름. 두 process 가 다른 build 이거나 engine 이 결정적이지 않음
+} netplay_status_t;
+
+// one datagram, sent every frame. both ends are the same build, so fields are in host order. inputs are every local
+// input the peer has not acknowledged, so a lost packet is covered by the next one
+typedef struct netplay_packet_t {
+    char magic[4]; // "TNET"
+    uint8_t version;
+    uint8_t flags;
+    uint8_t input_count;
+    uint8_t reserved;
+    uint32_t nonce; // process 마다 무작위. 작은 쪽이 side 0 이고 그쪽 seed 로 게임함
+    uint32_t seed;
+    uint16_t width;
+    uint16_t height;
+    int32_t tick; // 보낸 쪽이 simulate 한 tick 수
+    int32_t advantage; // 보낸 쪽의 tick - 받은 상대 input 수
+    int32_t ack; // 보낸 쪽이 빠짐없이 받은 상대 input 수
+    int32_t first_tick; // inputs[0] 의 tick
+    int32_t checksum_tick; // -1 이면 checksum 없음
+    uint32_t checksum;
+    input_t inputs[NETPLAY_PACKET_INPUTS];
+} netplay_packet_t;
+
+typedef struct netplay_delayed_t {
+    long long release_ns;
+    int size;
+    netplay_packet_t packet;
+} netplay_delayed_t;
+
+typedef struct netplay_checksum_t {
+    long tick; // -1 이면 비어있음
+    uint32_t checksum;
+} netplay_checksum_t;
+
+typedef struct netplay_stats_t {
+    long frames;
+    long stall_frames; // 상대 input 이 NETPLAY_MAX_ROLLBACK 넘게 밀려서 멈춘 frame
+    long sync_frames; // 앞서 있어서 쉰 frame
+    long rollbacks;
+    long resimulated_ticks;
+    int max_resimulated_ticks; // rollback 한 번에
+    double resimulation_us; // restore 와 다시 simulate 한 시간의 합
+    double max_resimulation_us; // 한 frame 에서
+    double step_us; // 새 tick 을 simulate 한 시간의 합
+    long packets_sent;
+    long packets_dropped; // --net-loss 로 버린 packet
+    long packets_received;
+    long checksums; // 비교한 checksum 수
+} netplay_stats_t;
+
+// two boards in a versus_t, boards[side] is played here. every frame the confirmed remote inputs come in, a wrong
+// prediction rolls the match back to the snapshot before it and simulates forward again, then one new tick is
+// simulated on the local input and a predicted remote input
+typedef struct netplay_t {
+    netplay_status_t status;
+    int fd;
+    uint32_t nonce;
+    uint32_t peer_nonce;
+    unsigned int seed;
+    int width;
+    int height;
+    int side;
+    long tick_limit; // 0 이면 승부가 날 때까지
+    thread_pool_t pool; // thread 1 개. versus_t 가 요구함
+    versus_t versus; // 지금까지 simulate 한 상태, 마지막 몇 tick 은 예측
+    versus_t snapshots[NETPLAY_SNAPSHOT_RING]; // tick t 를 simulate 하기 전의 상태
+    input_t local_inputs[NETPLAY_INPUT_RING];
+    input_t remote_inputs[NETPLAY_INPUT_RING]; // 받은 것은 확정, 나머지는 simulate 할 때 쓴 예측
+    input_t step_inputs[2]; // step_versus 의 input_fn 이 읽음
+    long remote_count; // 빠짐없이 받은 상대 input 수
+    long rollback_tick; // 예측이 틀린 가장 이른 tick, -1 이면 없음
+    long peer_ack; // 상대가 받은 내 input 수
+    long peer_tick;
+    int peer_advantage;
+    long last_sync_frame;
+    netplay_checksum_t checksums[NETPLAY_CHECKSUM_RING];
+    long peer_checksum_tick; // 아직 비교하지 않은 상대 checksum, -1 이면 없음
+    uint32_t peer_checksum;
+    long last_checksum_tick; // 마지막으로 비교한 tick
+    long long last_receive_ns;
+    long long finish_ns;
+    int delay_ms;
+    int loss_percent;
+    unsigned int loss_rng_state;
+    netplay_delayed_t* delayed;
+    unsigned int delayed_head;
+    unsigned int delayed_tail;
+    netplay_stats_t stats;
+} netplay_t;
+
+// netplay_t functions
+
+bool init_netplay(netplay_t* self, int port, const char* peer, unsigned int seed, int width, int height, long tick_limit, int delay_ms, int loss_percent);
+void free_netplay(netplay_t* self);
+void poll_netplay(netplay_t* self);
+bool can_step_netplay(const netplay_t* self);
+void advance_netplay(netplay_t* self, input_t input);
+bool is_netplay_done(const netplay_t* self);
+void quit_netplay(netplay_t* self);
+const board_t* get_netplay_board(const netplay_t* self, int side);
+const char* get_netplay_status_name(netplay_status_t status);
+
+#endif /* NETPLAY_H */
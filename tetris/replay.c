@@ -0,0 +1,158 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "engine.h"
+#include "io.h"
+#include "replay.h"
+
+
+// --------------------------------------------------
+// replay_t functions
+// --------------------------------------------------
+
+void init_replay(replay_t* self, unsigned int seed, int width, int height, int dig_rows) {
+    self->seed = seed;
+    self->width = width;
+    self->height = height;
+    self->dig_rows = dig_rows;
+    self->tick_count = 0;
+    self->capacity = 0;
+    self->inputs = NULL;
+    self->lines = 0;
+    self->level = 1;
+    self->pieces = 0;
+}
+
+void free_replay(replay_t* self) {
+    free(self->inputs);
+    self->inputs = NULL;
+    self->tick_count = 0;
+    self->capacity = 0;
+}
+
+// one call per step_board
+bool record_replay_input(replay_t* self, input_t input) {
+    if(self->tick_count == self->capacity) {
+        const int capacity = self->capacity == 0 ? 4096 : self->capacity * 2;
+        input_t* inputs = realloc(self->inputs, sizeof(input_t) * capacity);
+        if(inputs == NULL) {
+            return false;
+        }
+        self->inputs = inputs;
+        self->capacity = capacity;
+    }
+
+    self->inputs[self->tick_count++] = input;
+
+    return true;
+}
+
+// final numbers go to the header so tools can read them without replaying
+void finish_replay(replay_t* self, const game_state_t* game_state) {
+    self->lines = game_state->g_lines;
+    self->level = game_state->g_level;
+    self->pieces = game_state->g_pieces;
+}
+
+// plays every input on board, created by the caller with the replay's size. false when the end differs from what was recorded
+bool play_replay(const replay_t* self, board_t* board) {
+    set_dig_rows(board, self->dig_rows);
+    init_board(board, self->seed);
+    set_begin_game(&board->game_state, true);
+
+    for(int tick = 0; tick < self->tick_count; ++tick) {
+        step_board(board, self->inputs[tick]);
+    }
+
+    return board->game_state.g_lines == self->lines && board->game_state.g_level == self->level && board->game_state.g_pieces == self->pieces;
+}
+
+bool save_replay(const replay_t* self, const char* path) {
+    FILE* file = fopen(path, "wb");
+
+    if(file == NULL) {
+        return false;
+    }
+
+    bool b_ok = write_replay(self, file);
+    b_ok = (fclose(file) == 0) && b_ok;
+
+    return b_ok;
+}
+
+bool load_replay(replay_t* self, const char* path) {
+    const int fd = open(path, O_RDONLY);
+
+    if(fd < 0) {
+        return false;
+    }
+
+    const bool b_ok = read_replay(self, fd, 0);
+    close(fd);
+
+    return b_ok;
+}
+
+// header and inputs at the current position. archive segments are many of these back to back
+bool write_replay(const replay_t* self, FILE* file) {
+    replay_header_t header;
+
+    memcpy(header.magic, "TRPL", 4);
+    header.version = REPLAY_VERSION;
+    header.seed = self->seed;
+    header.tick_count = self->tick_count;
+    header.lines = self->lines;
+    header.level = self->level;
+    header.pieces = self->pieces;
+    header.width = self->width;
+    header.height = self->height;
+    header.dig_rows = self->dig_rows;
+
+    return fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(self->inputs, sizeof(input_t), self->tick_count, file) == (size_t)self->tick_count;
+}
+
+// version 1 files end their header before width, version 2 files before dig_rows
+bool read_replay(replay_t* self, int fd, off_t offset) {
+    replay_header_t header;
+    size_t header_size = offsetof(replay_header_t, width);
+
+    if(!pread_all(fd, &header, header_size, offset) || memcmp(header.magic, "TRPL", 4) != 0 ||
+        header.version < 1 || header.version > REPLAY_VERSION || header.tick_count < 0) {
+        return false;
+    }
+
+    header.width = BOARD_DEFAULT_WIDTH;
+    header.height = BOARD_DEFAULT_HEIGHT;
+    header.dig_rows = 0;
+    if(header.version >= 2) {
+        const size_t end = header.version == 2 ? offsetof(replay_header_t, dig_rows) : sizeof(header);
+        if(!pread_all(fd, &header.width, end - header_size, offset + header_size)) {
+            return false;
+        }
+        header_size = end;
+    }
+    if(!is_board_size_valid(header.width, header.height) || header.dig_rows < 0 || header.dig_rows > header.height - DIG_FREE_ROWS) {
+        return false;
+    }
+
+    init_replay(self, header.seed, header.width, header.height, header.dig_rows);
+    self->inputs = malloc(sizeof(input_t) * (header.tick_count > 0 ? header.tick_count : 1));
+    if(self->inputs == NULL || !pread_all(fd, self->inputs, sizeof(input_t) * header.tick_count, offset + header_size)) {
+        free_replay(self);
+        return false;
+    }
+
+    self->tick_count = header.tick_count;
+    self->capacity = header.tick_count;
+    self->lines = header.lines;
+    self->level = header.level;
+    self->pieces = header.pieces;
+
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    REPLAY_VERSION = 3 // version 1 은 width, height 가 없고 기본 크기 board, version 2 는 dig_rows 가 없고 0
+};
+
+// file layout: replay_header_t, then tick_count input_t
+typedef struct replay_header_t {
+    char magic[4]; // "TRPL"
+    int version;
+    unsigned int seed;
+    int tick_count;
+    int lines;
+    int level;
+    int pieces;
+    int width;
+    int height;
+    int dig_rows;
+} replay_header_t;
+
+// the engine is deterministic, so a seed and the keys of every tick are the whole game
+typedef struct replay_t {
+    unsigned int seed;
+    int tick_count;
+    int capacity;
+    input_t* inputs;
+    int lines;
+    int level;
+    int pieces;
+    int width;
+    int height;
+    int dig_rows; // set_dig_rows 로 board 에 줌
+} replay_t;
+
+// replay_t functions
+
+void init_replay(replay_t* self, unsigned int seed, int width, int height, int dig_rows);
+void free_replay(replay_t* self);
+bool record_replay_input(replay_t* self, input_t input);
+void finish_replay(replay_t* self, const game_state_t* game_state);
+bool play_replay(const replay_t* self, board_t* board);
+bool save_replay(const replay_t* self, const char* path);
+bool load_replay(replay_t* self, const char* path);
+bool write_replay(const replay_t* self, FILE* file);
+bool read_replay(replay_t* self, int fd, off_t offset);
+
+#endif /* REPLAY_H */
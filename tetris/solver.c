@@ -0,0 +1,595 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "bot.h"
+#include "thread_pool.h"
+#include "solver.h"
+
+// field bit (row * SOLVER_WIDTH + column), row 0 is the bottom row of the playfield
+#define ROW_MASK ((UINT64_C(1) << SOLVER_WIDTH) - 1)
+
+enum {
+    SEARCH_NONE,
+    SEARCH_FOUND,
+    SEARCH_STOPPED, // 더 앞선 task 가 이미 해를 찾음
+    MAX_CHILDREN = 4 * SOLVER_X_COUNT,
+    CHECK_TICK_LIMIT = 1000 // 줄이 지워지고 다음 블록이 나올 때까지 최대 tick
+};
+
+typedef struct child_t {
+    uint64_t field;
+    int limit;
+    placement_t placement;
+} child_t;
+
+// a subtree below the first SOLVER_SPLIT_DEPTH placements
+typedef struct search_task_t {
+    uint64_t field;
+    int depth;
+    int limit;
+    placement_t path[SOLVER_MAX_PIECES];
+} search_task_t;
+
+// what one task carries down its subtree
+typedef struct search_worker_t {
+    placement_t path[SOLVER_MAX_PIECES];
+    int length; // 해를 찾았을 때 사용한 블록 수
+    long nodes;
+} search_worker_t;
+
+// one height of one solve, shared by all workers
+typedef struct search_t {
+    solver_t* solver;
+    const int* sequence;
+    int piece_count; // 이 높이에서 perfect clear 에 필요한 블록 수
+    search_task_t* tasks;
+    int task_count;
+    int task_capacity;
+    atomic_int best_task; // 해를 찾은 가장 앞의 task. 뒤의 task 들은 멈춤
+} search_t;
+
+static void init_shapes(solver_t* self);
+static int get_children(const search_t* search, uint64_t field, int depth, int limit, child_t children[MAX_CHILDREN]);
+static bool drop_shape(const solver_shape_t* shape, uint64_t field, int limit, uint64_t* placed);
+static int clear_lines(uint64_t* field, int limit);
+static bool check_regions(const solver_t* self, uint64_t field, int limit);
+static bool collect_tasks(search_t* search, uint64_t field, int depth, int limit, placement_t path[]);
+static int search_node(search_t* search, int task_index, search_worker_t* worker, uint64_t field, int depth, int limit);
+static void search_task(void* ctx, int index);
+static uint64_t get_table_key(uint64_t field, int depth);
+static bool find_in_table(const solver_t* self, uint64_t key);
+static void add_to_table(solver_t* self, uint64_t key);
+
+// --------------------------------------------------
+// solver_t functions
+// --------------------------------------------------
+
+bool init_solver(solver_t* self, thread_pool_t* pool) {
+    self->pool = pool;
+    self->table = calloc((size_t)1 << SOLVER_TABLE_BITS, sizeof(uint64_t));
+    atomic_init(&self->nodes, 0);
+
+    if(self->table == NULL) {
+        return false;
+    }
+
+    init_shapes(self);
+
+    for(int height = 0; height <= SOLVER_MAX_HEIGHT; ++height) {
+        for(int column = 0; column < SOLVER_WIDTH; ++column) {
+            uint64_t mask = 0;
+            for(int row = 0; row < height; ++row) {
+                mask |= UINT64_C(1) << (row * SOLVER_WIDTH + column);
+            }
+            self->column_masks[height][column] = mask;
+        }
+    }
+
+    return true;
+}
+
+void free_solver(solver_t* self) {
+    free((void*)self->table);
+    self->table = NULL;
+}
+
+// board must be right after a spawn, the way get_bot_input sees it. the sequence is the active piece,
+// the incoming piece and whatever the board's generator gives next.
+// heights are tried from low to high, so the first solution uses the fewest pieces
+solver_result_t solve_perfect_clear(solver_t* self, const board_t* board, int max_pieces, placement_t solution[SOLVER_MAX_PIECES], int* solution_length) {
+    uint64_t masks[board->height];
+    int sequence[SOLVER_MAX_PIECES];
+    unsigned int rng_state = board->rng_state;
+    uint64_t field = 0;
+    int stack_height = 0;
+    int filled = 0;
+
+    *solution_length = 0;
+    atomic_store(&self->nodes, 0);
+
+    if(board->width != SOLVER_WIDTH || !board->game_state.b_piece_active || board->game_state.b_line_to_delete || board->game_state.b_game_over) {
+        return SOLVER_UNSUPPORTED;
+    }
+
+    get_row_masks(board, masks);
+    for(int i = 0; i < board->height; ++i) {
+        const int row = board->height - 1 - i;
+
+        if(masks[i] == 0) {
+            continue;
+        }
+        if(row >= SOLVER_MAX_HEIGHT) {
+            return SOLVER_UNSUPPORTED;
+        }
+        if(row + 1 > stack_height) {
+            stack_height = row + 1;
+        }
+        field |= masks[i] << (row * SOLVER_WIDTH);
+    }
+    filled = __builtin_popcountll(field);
+
+    if(max_pieces > SOLVER_MAX_PIECES) {
+        max_pieces = SOLVER_MAX_PIECES;
+    }
+
+    sequence[0] = board->game_state.finished_piece_num;
+    sequence[1] = board->game_state.current_piece_num;
+    for(int i = 2; i < SOLVER_MAX_PIECES; ++i) {
+        sequence[i] = next_random_value(&rng_state, 0, 6);
+    }
+
+    for(int height = stack_height > 0 ? stack_height : 1; height <= SOLVER_MAX_HEIGHT; ++height) {
+        const int empty = height * SOLVER_WIDTH - filled;
+        search_t search;
+        placement_t path[SOLVER_MAX_PIECES];
+
+        if(empty <= 0 || empty % 4 != 0) {
+            continue;
+        }
+        if(empty / 4 > max_pieces) {
+            break;
+        }
+        if(!check_regions(self, field, height)) {
+            continue;
+        }
+
+        search.solver = self;
+        search.sequence = sequence;
+        search.piece_count = empty / 4;
+        search.tasks = NULL;
+        search.task_count = 0;
+        search.task_capacity = 0;
+        atomic_init(&search.best_task, INT32_MAX);
+
+        // 높이마다 limit 이 달라지므로 table 을 비움
+        memset((void*)self->table, 0, sizeof(uint64_t) << SOLVER_TABLE_BITS);
+
+        if(!collect_tasks(&search, field, 0, height, path)) {
+            free(search.tasks);
+            return SOLVER_UNSUPPORTED;
+        }
+
+        run_thread_pool(self->pool, search.task_count, search_task, &search);
+
+        const int best = atomic_load(&search.best_task);
+        if(best != INT32_MAX) {
+            const search_task_t* task = &search.tasks[best];
+
+            // 해를 찾은 task 는 path 와 depth 를 끝까지 채워 둠
+            *solution_length = task->depth;
+            memcpy(solution, task->path, sizeof(placement_t) * task->depth);
+            free(search.tasks);
+            return SOLVER_FOUND;
+        }
+
+        free(search.tasks);
+    }
+
+    return SOLVER_NONE;
+}
+
+// plays the solution with the bot's keys on a copy and checks that the playfield ends up empty
+bool check_perfect_clear(const board_t* board, const placement_t solution[], int solution_length) {
+    board_t copy;
+    uint64_t masks[board->height];
+    bool b_clear = true;
+
+    if(!create_board(&copy, board->width, board->height)) {
+        return false;
+    }
+    copy_board(&copy, board);
+
+    for(int i = 0; i < solution_length && b_clear; ++i) {
+        if(i > 0 && !wait_next_piece(&copy)) {
+            b_clear = false;
+        } else if(!simulate_placement(&copy, solution[i]) || copy.game_state.b_game_over) {
+            b_clear = false;
+        }
+    }
+
+    for(int tick = 0; tick < CHECK_TICK_LIMIT && b_clear && copy.game_state.b_line_to_delete; ++tick) {
+        const input_t input = { 0, 0 };
+        step_board(&copy, input);
+    }
+
+    get_row_masks(&copy, masks);
+    for(int i = 0; i < copy.height && b_clear; ++i) {
+        if(masks[i] != 0) {
+            b_clear = false;
+        }
+    }
+
+    free_board(&copy);
+
+    return b_clear;
+}
+
+// solves the empty board of each seed and prints the placements, one position per line
+int run_perfect_clear(int max_pieces, unsigned int seed, int position_count, int thread_count) {
+    static const char piece_names[] = "OLJITSZ";
+    thread_pool_t pool;
+    solver_t* solver = malloc(sizeof(solver_t));
+    placement_t solution[SOLVER_MAX_PIECES];
+    int solution_length;
+    int found = 0;
+    int result = 0;
+    struct timespec begin;
+    struct timespec end;
+
+    if(solver == NULL || !init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free(solver);
+        return 1;
+    }
+    if(!init_solver(solver, &pool)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        free(solver);
+        return 1;
+    }
+
+    for(int k = 0; k < position_count; ++k) {
+        const unsigned int position_seed = seed + k;
+        const input_t input = { 0, 0 };
+        board_t board;
+
+        if(!create_board(&board, BOARD_DEFAULT_WIDTH, BOARD_DEFAULT_HEIGHT)) {
+            fprintf(stderr, "tetris: out of memory\n");
+            result = 1;
+            break;
+        }
+        init_board(&board, position_seed);
+        set_begin_game(&board.game_state, true);
+        step_board(&board, input); // 첫 블록 생성
+
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        const solver_result_t solved = solve_perfect_clear(solver, &board, max_pieces, solution, &solution_length);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        const double milliseconds = (end.tv_sec - begin.tv_sec) * 1e3 + (end.tv_nsec - begin.tv_nsec) / 1e6;
+        printf("seed %u: ", position_seed);
+
+        if(solved == SOLVER_FOUND) {
+            unsigned int rng_state = board.rng_state;
+            int piece_num = board.game_state.finished_piece_num;
+
+            printf("%d pieces,", solution_length);
+            for(int i = 0; i < solution_length; ++i) {
+                printf(" %c:%d,%d", piece_names[piece_num], solution[i].rotation, solution[i].x);
+                piece_num = i == 0 ? board.game_state.current_piece_num : next_random_value(&rng_state, 0, 6);
+            }
+
+            if(!check_perfect_clear(&board, solution, solution_length)) {
+                printf(" (engine disagrees)");
+                result = 1;
+            }
+            ++found;
+        } else if(solved == SOLVER_NONE) {
+            printf("none within %d pieces", max_pieces);
+        } else {
+            printf("unsupported position");
+        }
+
+        printf(" [%ld nodes, %.1f ms]\n", atomic_load(&solver->nodes), milliseconds);
+        free_board(&board);
+    }
+
+    printf("%d of %d positions have a perfect clear on %d threads\n", found, position_count, pool.thread_count);
+
+    free_solver(solver);
+    free_thread_pool(&pool);
+    free(solver);
+
+    return result;
+}
+
+// rotations follow resolve_turn_movement: new[i][j] = old[j][3 - i]
+static void init_shapes(solver_t* self) {
+    for(int piece_num = 0; piece_num < 7; ++piece_num) {
+        grid_square_t frame[4][4];
+        set_piece_shape(frame, piece_num);
+
+        for(int rotation = 0; rotation < 4; ++rotation) {
+            int bottom = -1;
+            int top = 4;
+
+            for(int i = 0; i < 4; ++i) {
+                for(int j = 0; j < 4; ++j) {
+                    if(frame[i][j] == MOVING) {
+                        if(i > bottom) {
+                            bottom = i;
+                        }
+                        if(i < top) {
+                            top = i;
+                        }
+                    }
+                }
+            }
+
+            for(int x = PLACEMENT_MIN_X; x <= SOLVER_WIDTH; ++x) {
+                solver_shape_t* shape = &self->shapes[piece_num][rotation][x - PLACEMENT_MIN_X];
+                shape->mask = 0;
+                shape->height = bottom - top + 1;
+                shape->b_valid = true;
+
+                for(int i = 0; i < 4; ++i) {
+                    for(int j = 0; j < 4; ++j) {
+                        if(frame[i][j] != MOVING) {
+                            continue;
+                        }
+
+                        // grid 의 j 번째 칸은 field 의 j - 1 번째 칸
+                        const int column = x + j - 1;
+                        if(column < 0 || column >= SOLVER_WIDTH) {
+                            shape->b_valid = false;
+                        } else {
+                            shape->mask |= UINT64_C(1) << ((bottom - i) * SOLVER_WIDTH + column);
+                        }
+                    }
+                }
+            }
+
+            grid_square_t turned[4][4];
+            for(int i = 0; i < 4; ++i) {
+                for(int j = 0; j < 4; ++j) {
+                    turned[i][j] = frame[j][3 - i];
+                }
+            }
+            memcpy(frame, turned, sizeof(frame));
+        }
+    }
+}
+
+// every distinct landing of the piece at depth that keeps the position solvable by the cheap checks
+static int get_children(const search_t* search, uint64_t field, int depth, int limit, child_t children[MAX_CHILDREN]) {
+    const solver_t* self = search->solver;
+    const int piece_num = search->sequence[depth];
+    uint64_t placed_masks[MAX_CHILDREN];
+    int placed_count = 0;
+    int count = 0;
+
+    for(int rotation = 0; rotation < 4; ++rotation) {
+        for(int x = PLACEMENT_MIN_X; x <= SOLVER_WIDTH; ++x) {
+            const solver_shape_t* shape = &self->shapes[piece_num][rotation][x - PLACEMENT_MIN_X];
+            uint64_t placed;
+            bool b_duplicate = false;
+
+            if(!shape->b_valid || !drop_shape(shape, field, limit, &placed)) {
+                continue;
+            }
+
+            // O 나 S, Z, I 는 다른 rotation 이 같은 자리에 놓임
+            for(int i = 0; i < placed_count; ++i) {
+                if(placed_masks[i] == placed) {
+                    b_duplicate = true;
+                    break;
+                }
+            }
+            if(b_duplicate) {
+                continue;
+            }
+            placed_masks[placed_count++] = placed;
+
+            child_t* child = &children[count];
+            child->field = field | placed;
+            child->limit = limit - clear_lines(&child->field, limit);
+            child->placement.rotation = rotation;
+            child->placement.x = x;
+
+            if(child->field == 0 || check_regions(self, child->field, child->limit)) {
+                ++count;
+            }
+        }
+    }
+
+    return count;
+}
+
+// hard drop from just above the limit, where nothing can be. false when the piece would stick out over the limit.
+// bits shifted past 64 are above the limit too, so losing them cannot hide a collision
+static bool drop_shape(const solver_shape_t* shape, uint64_t field, int limit, uint64_t* placed) {
+    int row = limit;
+
+    while(row > 0 && ((shape->mask << ((row - 1) * SOLVER_WIDTH)) & field) == 0) {
+        --row;
+    }
+
+    if(row + shape->height > limit) {
+        return false;
+    }
+
+    *placed = shape->mask << (row * SOLVER_WIDTH);
+    return true;
+}
+
+// removes full rows like delete_complete_lines. top first, so the lower row numbers stay valid
+static int clear_lines(uint64_t* field, int limit) {
+    int cleared = 0;
+
+    for(int row = limit - 1; row >= 0; --row) {
+        if(((*field >> (row * SOLVER_WIDTH)) & ROW_MASK) == ROW_MASK) {
+            const uint64_t below = *field & ((UINT64_C(1) << (row * SOLVER_WIDTH)) - 1);
+            const uint64_t above = *field >> ((row + 1) * SOLVER_WIDTH);
+
+            *field = below | (above << (row * SOLVER_WIDTH));
+            ++cleared;
+        }
+    }
+
+    return cleared;
+}
+
+// cell parity: a column filled up to the limit can never be crossed, even after clears,
+// so the empty cells between two such columns must be a multiple of 4
+static bool check_regions(const solver_t* self, uint64_t field, int limit) {
+    int empty = 0;
+
+    for(int column = 0; column < SOLVER_WIDTH; ++column) {
+        const uint64_t column_mask = self->column_masks[limit][column];
+        const uint64_t cells = field & column_mask;
+
+        if(cells == column_mask) {
+            if(empty % 4 != 0) {
+                return false;
+            }
+            empty = 0;
+        } else {
+            empty += limit - __builtin_popcountll(cells);
+        }
+    }
+
+    return empty % 4 == 0;
+}
+
+// expands the first levels on the calling thread. every node left at SOLVER_SPLIT_DEPTH becomes a task
+static bool collect_tasks(search_t* search, uint64_t field, int depth, int limit, placement_t path[]) {
+    child_t children[MAX_CHILDREN];
+
+    if(depth == SOLVER_SPLIT_DEPTH || depth == search->piece_count || (field == 0 && depth > 0)) {
+        if(search->task_count == search->task_capacity) {
+            const int capacity = search->task_capacity > 0 ? search->task_capacity * 2 : 256;
+            search_task_t* tasks = realloc(search->tasks, sizeof(search_task_t) * capacity);
+            if(tasks == NULL) {
+                return false;
+            }
+            search->tasks = tasks;
+            search->task_capacity = capacity;
+        }
+
+        search_task_t* task = &search->tasks[search->task_count++];
+        task->field = field;
+        task->depth = depth;
+        task->limit = limit;
+        memcpy(task->path, path, sizeof(placement_t) * depth);
+        return true;
+    }
+
+    const int count = get_children(search, field, depth, limit, children);
+    for(int i = 0; i < count; ++i) {
+        path[depth] = children[i].placement;
+        if(!collect_tasks(search, children[i].field, depth + 1, children[i].limit, path)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// depth-first with a shared table of dead positions. a subtree is only marked dead when it was searched to the end
+static int search_node(search_t* search, int task_index, search_worker_t* worker, uint64_t field, int depth, int limit) {
+    child_t children[MAX_CHILDREN];
+
+    if(field == 0 && depth > 0) {
+        worker->length = depth;
+        return SEARCH_FOUND;
+    }
+    if(depth == search->piece_count) {
+        return SEARCH_NONE;
+    }
+    if(atomic_load_explicit(&search->best_task, memory_order_relaxed) < task_index) {
+        return SEARCH_STOPPED;
+    }
+
+    const uint64_t key = get_table_key(field, depth);
+    if(find_in_table(search->solver, key)) {
+        return SEARCH_NONE;
+    }
+
+    ++worker->nodes;
+
+    const int count = get_children(search, field, depth, limit, children);
+    for(int i = 0; i < count; ++i) {
+        worker->path[depth] = children[i].placement;
+
+        const int result = search_node(search, task_index, worker, children[i].field, depth + 1, children[i].limit);
+        if(result != SEARCH_NONE) {
+            return result;
+        }
+    }
+
+    add_to_table(search->solver, key);
+
+    return SEARCH_NONE;
+}
+
+static void search_task(void* ctx, int index) {
+    search_t* search = ctx;
+    search_task_t* task = &search->tasks[index];
+    search_worker_t worker;
+
+    memcpy(worker.path, task->path, sizeof(placement_t) * task->depth);
+    worker.length = 0;
+    worker.nodes = 0;
+
+    if(search_node(search, index, &worker, task->field, task->depth, task->limit) == SEARCH_FOUND) {
+        memcpy(task->path, worker.path, sizeof(placement_t) * worker.length);
+        task->depth = worker.length;
+
+        // 더 앞선 task 가 없을 때만 바꿈
+        int best = atomic_load(&search->best_task);
+        while(index < best && !atomic_compare_exchange_weak(&search->best_task, &best, index)) {
+        }
+    }
+
+    atomic_fetch_add_explicit(&search->solver->nodes, worker.nodes, memory_order_relaxed);
+}
+
+// depth fits in the 4 bits above the field. + 1 so that 0 can mean an empty slot
+static uint64_t get_table_key(uint64_t field, int depth) {
+    return (field | (uint64_t)depth << (SOLVER_WIDTH * SOLVER_MAX_HEIGHT)) + 1;
+}
+
+static bool find_in_table(const solver_t* self, uint64_t key) {
+    const size_t mask = ((size_t)1 << SOLVER_TABLE_BITS) - 1;
+    size_t slot = (size_t)((key * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - SOLVER_TABLE_BITS));
+
+    for(int i = 0; i < SOLVER_TABLE_PROBES; ++i, slot = (slot + 1) & mask) {
+        const uint64_t stored = atomic_load_explicit(&self->table[slot], memory_order_relaxed);
+        if(stored == key) {
+            return true;
+        }
+        if(stored == 0) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+// lossy: when the probe window is full the position is just not remembered
+static void add_to_table(solver_t* self, uint64_t key) {
+    const size_t mask = ((size_t)1 << SOLVER_TABLE_BITS) - 1;
+    size_t slot = (size_t)((key * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - SOLVER_TABLE_BITS));
+
+    for(int i = 0; i < SOLVER_TABLE_PROBES; ++i, slot = (slot + 1) & mask) {
+        uint64_t stored = 0;
+        if(atomic_compare_exchange_strong_explicit(&self->table[slot], &stored, key, memory_order_relaxed, memory_order_relaxed) || stored == key) {
+            return;
+        }
+    }
+}
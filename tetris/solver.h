@@ -0,0 +1,55 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "engine.h"
+#include "bot.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    SOLVER_WIDTH = BOARD_DEFAULT_WIDTH, // 이 폭의 board 만 풀 수 있음
+    SOLVER_MAX_HEIGHT = 6, // field 전체가 uint64_t 하나에 들어가는 높이
+    SOLVER_MAX_PIECES = SOLVER_WIDTH * SOLVER_MAX_HEIGHT / 4,
+    SOLVER_X_COUNT = SOLVER_WIDTH - PLACEMENT_MIN_X + 1,
+    SOLVER_SPLIT_DEPTH = 2, // 이 깊이까지는 혼자 펼쳐서 thread 들에게 나눔
+    SOLVER_TABLE_BITS = 21,
+    SOLVER_TABLE_PROBES = 8
+};
+
+typedef enum solver_result {
+    SOLVER_FOUND,
+    SOLVER_NONE, // N 개 안에 perfect clear 가 없음이 증명됨
+    SOLVER_UNSUPPORTED // 폭이 SOLVER_WIDTH 가 아니거나, 이미 SOLVER_MAX_HEIGHT 보다 높거나, 블록이 움직이는 중
+} solver_result_t;
+
+// one rotation of one piece at one piece_position_x, as rows of the bitboard with its lowest row at 0
+typedef struct solver_shape_t {
+    uint64_t mask;
+    int height;
+    bool b_valid;
+} solver_shape_t;
+
+// tables and the transposition table live here, so one solver can answer many positions
+typedef struct solver_t {
+    thread_pool_t* pool;
+    solver_shape_t shapes[7][4][SOLVER_X_COUNT];
+    uint64_t column_masks[SOLVER_MAX_HEIGHT + 1][SOLVER_WIDTH];
+    _Atomic uint64_t* table; // 해가 없다고 확인된 (field, depth)
+    atomic_long nodes;
+} solver_t;
+
+// solver_t functions
+
+bool init_solver(solver_t* self, thread_pool_t* pool);
+void free_solver(solver_t* self);
+solver_result_t solve_perfect_clear(solver_t* self, const board_t* board, int max_pieces, placement_t solution[SOLVER_MAX_PIECES], int* solution_length);
+bool check_perfect_clear(const board_t* board, const placement_t solution[], int solution_length);
+int run_perfect_clear(int max_pieces, unsigned int seed, int position_count, int thread_count);
+
+#endif /* SOLVER_H */
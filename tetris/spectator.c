@@ -0,0 +1,182 @@
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "engine.h"
+#include "spectator.h"
+
+static size_t get_header_size(void);
+static int get_slot_size(int width, int height);
+static spectator_slot_t* get_slot(const spectator_t* self, unsigned int frame);
+
+// --------------------------------------------------
+// spectator_t functions
+// --------------------------------------------------
+
+// a stream left behind by a game that died is unlinked first. viewers still attached to it keep their old mapping
+bool open_spectator_publisher(spectator_t* self, const char* name, int width, int height) {
+    const int slot_size = get_slot_size(width, height);
+
+    snprintf(self->name, sizeof(self->name), "/tetris-%s", name);
+    self->size = get_header_size() + (size_t)slot_size * SPECTATOR_SLOTS;
+    self->b_publisher = true;
+    self->frame_count = 0;
+
+    shm_unlink(self->name);
+    const int fd = shm_open(self->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) {
+        return false;
+    }
+    if(ftruncate(fd, self->size) != 0) {
+        close(fd);
+        shm_unlink(self->name);
+        return false;
+    }
+
+    void* memory = mmap(NULL, self->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED) {
+        shm_unlink(self->name);
+        return false;
+    }
+
+    // ftruncate 가 0 으로 채움. magic 을 마지막에 써서 viewer 가 반쯤 쓴 header 를 보지 않게 함
+    self->header = memory;
+    self->header->version = SPECTATOR_VERSION;
+    self->header->width = width;
+    self->header->height = height;
+    self->header->slot_size = slot_size;
+    atomic_thread_fence(memory_order_release);
+    memcpy(self->header->magic, "TSPC", 4);
+
+    return true;
+}
+
+// called after every step_board. the game only writes: no lock, no syscall, nothing that depends on the viewers
+void publish_spectator_frame(spectator_t* self, const board_t* board) {
+    spectator_slot_t* slot = get_slot(self, self->frame_count);
+    const unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    const int cell_count = (board->height + 1) * (board->width + 2);
+
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->frame = self->frame_count;
+    slot->game_state = board->game_state;
+    slot->fade_line_counter = board->counter.fade_line_counter;
+    for(int i = 0; i < 4; ++i) {
+        for(int j = 0; j < 4; ++j) {
+            slot->incoming_piece[i][j] = (unsigned char)board->incoming_piece[i][j];
+            slot->hold_piece[i][j] = (unsigned char)board->hold_piece[i][j];
+        }
+    }
+    for(int k = 0; k < cell_count; ++k) {
+        slot->cells[k] = (unsigned char)board->grid[k];
+    }
+
+    atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+    ++self->frame_count;
+    atomic_store_explicit(&self->header->frame_count, self->frame_count, memory_order_release);
+}
+
+bool open_spectator_viewer(spectator_t* self, const char* name) {
+    struct stat status;
+
+    snprintf(self->name, sizeof(self->name), "/tetris-%s", name);
+    self->b_publisher = false;
+    self->frame_count = 0;
+
+    const int fd = shm_open(self->name, O_RDONLY, 0);
+    if(fd < 0) {
+        return false;
+    }
+    if(fstat(fd, &status) != 0 || (size_t)status.st_size < get_header_size()) {
+        close(fd);
+        return false;
+    }
+
+    self->size = status.st_size;
+    void* memory = mmap(NULL, self->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED) {
+        return false;
+    }
+    self->header = memory;
+
+    const spectator_header_t* header = self->header;
+    const bool b_valid = memcmp(header->magic, "TSPC", 4) == 0 && header->version == SPECTATOR_VERSION
+        && is_board_size_valid(header->width, header->height) && header->slot_size == get_slot_size(header->width, header->height)
+        && self->size >= get_header_size() + (size_t)header->slot_size * SPECTATOR_SLOTS;
+    if(!b_valid) {
+        munmap(memory, self->size);
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    return true;
+}
+
+// copies the latest frame into board, created with the stream's size. a read that overlaps a write is thrown away
+// and done again, the game never waits for it
+spectator_read_t read_spectator_frame(spectator_t* self, board_t* board) {
+    const int cell_count = (board->height + 1) * (board->width + 2);
+
+    for(;;) {
+        const unsigned int frame_count = atomic_load_explicit(&self->header->frame_count, memory_order_acquire);
+        if(frame_count == self->frame_count) {
+            return atomic_load_explicit(&self->header->b_closed, memory_order_acquire) ? SPECTATOR_CLOSED : SPECTATOR_NO_FRAME;
+        }
+
+        const spectator_slot_t* slot = get_slot(self, frame_count - 1);
+        const unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if(sequence & 1) {
+            continue;
+        }
+
+        board->game_state = slot->game_state;
+        board->counter.fade_line_counter = slot->fade_line_counter;
+        for(int i = 0; i < 4; ++i) {
+            for(int j = 0; j < 4; ++j) {
+                board->incoming_piece[i][j] = slot->incoming_piece[i][j];
+                board->hold_piece[i][j] = slot->hold_piece[i][j];
+            }
+        }
+        for(int k = 0; k < cell_count; ++k) {
+            board->grid[k] = slot->cells[k];
+        }
+        const unsigned int frame = slot->frame;
+
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence && frame == frame_count - 1) {
+            self->frame_count = frame_count;
+            return SPECTATOR_NEW_FRAME;
+        }
+    }
+}
+
+// the game marks the stream closed so viewers can stop, then removes the name
+void close_spectator(spectator_t* self) {
+    if(self->b_publisher) {
+        atomic_store_explicit(&self->header->b_closed, true, memory_order_release);
+        shm_unlink(self->name);
+    }
+    munmap(self->header, self->size);
+}
+
+static size_t get_header_size(void) {
+    return (sizeof(spectator_header_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+// slots start on their own cache line so that a write to one does not disturb readers of another
+static int get_slot_size(int width, int height) {
+    const int size = sizeof(spectator_slot_t) + (height + 1) * (width + 2);
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+static spectator_slot_t* get_slot(const spectator_t* self, unsigned int frame) {
+    return (spectator_slot_t*)((char*)self->header + get_header_size() + (size_t)self->header->slot_size * (frame % SPECTATOR_SLOTS));
+}
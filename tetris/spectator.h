@@ -0,0 +1,67 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "engine.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    SPECTATOR_VERSION = 1,
+    SPECTATOR_SLOTS = 4, // viewer 가 slot 하나를 읽는 동안 게임은 나머지에 씀
+    SPECTATOR_NAME_SIZE = 256
+};
+
+typedef enum spectator_read {
+    SPECTATOR_NEW_FRAME,
+    SPECTATOR_NO_FRAME, // 마지막으로 읽은 뒤 새 tick 이 없음
+    SPECTATOR_CLOSED // 게임이 끝나고 stream 을 닫음
+} spectator_read_t;
+
+// start of the shared memory. written once by the game before any frame, then only frame_count and b_closed change
+typedef struct spectator_header_t {
+    char magic[4]; // "TSPC"
+    int version;
+    int width;
+    int height;
+    int slot_size;
+    _Alignas(CACHE_LINE_SIZE) atomic_uint frame_count; // 다 쓴 frame 수. 마지막 frame 은 slot (frame_count - 1) % SPECTATOR_SLOTS
+    atomic_bool b_closed;
+} spectator_header_t;
+
+// one published tick, guarded by a seqlock: sequence is odd while the game writes the slot.
+// cells is the grid with walls and floor, (height + 1) rows of width + 2, one byte per grid_square_t
+typedef struct spectator_slot_t {
+    atomic_uint sequence;
+    unsigned int frame;
+    game_state_t game_state;
+    int fade_line_counter;
+    unsigned char incoming_piece[4][4];
+    unsigned char hold_piece[4][4];
+    unsigned char cells[];
+} spectator_slot_t;
+
+// the game side maps the object read-write and never waits for anyone. viewers map it read-only,
+// so any number of them can attach without the game knowing
+typedef struct spectator_t {
+    char name[SPECTATOR_NAME_SIZE]; // "/tetris-" + 이름
+    spectator_header_t* header;
+    size_t size;
+    bool b_publisher;
+    unsigned int frame_count; // publisher: 쓴 frame 수, viewer: 마지막으로 읽은 frame_count
+} spectator_t;
+
+// spectator_t functions
+
+bool open_spectator_publisher(spectator_t* self, const char* name, int width, int height);
+void publish_spectator_frame(spectator_t* self, const board_t* board);
+bool open_spectator_viewer(spectator_t* self, const char* name);
+spectator_read_t read_spectator_frame(spectator_t* self, board_t* board);
+void close_spectator(spectator_t* self);
+
+#endif /* SPECTATOR_H */
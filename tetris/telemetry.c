@@ -0,0 +1,250 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gamedata.h"
+#include "io.h"
+#include "telemetry.h"
+
+static void push_telemetry_event(telemetry_t* self, int type, int value, const game_state_t* game_state, long tick, long long time_ns);
+static void* exporter_main(void* arg);
+static void drain_events(telemetry_t* self);
+static void add_event(telemetry_stats_t* stats, const telemetry_event_t* event);
+static void write_metrics(telemetry_t* self);
+static int compare_int(const void* a, const void* b);
+
+// --------------------------------------------------
+// telemetry_t functions
+// --------------------------------------------------
+
+// the ring is allocated here once, nothing on the recording side allocates
+bool init_telemetry(telemetry_t* self, const char* path) {
+    memset(&self->stats, 0, sizeof(telemetry_stats_t));
+    atomic_init(&self->head, 0);
+    atomic_init(&self->tail, 0);
+    atomic_init(&self->dropped, 0);
+    atomic_init(&self->b_stop, false);
+    self->cached_tail = 0;
+    self->b_failed = false;
+    snprintf(self->path, sizeof(self->path), "%s", path);
+
+    self->events = malloc(sizeof(telemetry_event_t) * TELEMETRY_RING_SIZE);
+    if(self->events == NULL) {
+        return false;
+    }
+    if(pthread_create(&self->exporter, NULL, exporter_main, self) != 0) {
+        free(self->events);
+        return false;
+    }
+
+    return true;
+}
+
+// the exporter drains what is left and writes the file one last time
+void free_telemetry(telemetry_t* self) {
+    atomic_store(&self->b_stop, true);
+    pthread_join(self->exporter, NULL);
+    free(self->events);
+}
+
+// before and after are the game state around one step_board
+void record_telemetry_step(telemetry_t* self, const game_state_t* before, const game_state_t* after, long tick) {
+    if(before->g_pieces == after->g_pieces && before->g_lines == after->g_lines && before->g_level == after->g_level
+        && before->b_piece_active == after->b_piece_active && before->b_game_over == after->b_game_over) {
+        return;
+    }
+
+    const long long time_ns = get_time_ns();
+
+    if(before->b_piece_active && !after->b_piece_active) {
+        push_telemetry_event(self, TELEMETRY_PIECE_LOCKED, 0, after, tick, time_ns);
+    }
+    if(after->g_lines > before->g_lines) {
+        push_telemetry_event(self, TELEMETRY_LINES_CLEARED, after->g_lines - before->g_lines, after, tick, time_ns);
+    }
+    if(after->g_level > before->g_level) {
+        push_telemetry_event(self, TELEMETRY_LEVEL_UP, after->g_level, after, tick, time_ns);
+    }
+    if(after->g_pieces > before->g_pieces) {
+        push_telemetry_event(self, TELEMETRY_PIECE_SPAWNED, 0, after, tick, time_ns);
+    }
+    if(!before->b_game_over && after->b_game_over) {
+        push_telemetry_event(self, TELEMETRY_GAME_OVER, 0, after, tick, time_ns);
+    }
+}
+
+// budget_us is the frame time the target fps allows
+void record_telemetry_frame(telemetry_t* self, const game_state_t* game_state, long tick, int frame_us, int budget_us) {
+    const long long time_ns = get_time_ns();
+
+    push_telemetry_event(self, TELEMETRY_FRAME, frame_us, game_state, tick, time_ns);
+    if((long)frame_us * 100 > (long)budget_us * TELEMETRY_OVERRUN_PERCENT) {
+        push_telemetry_event(self, TELEMETRY_FRAME_OVERRUN, frame_us, game_state, tick, time_ns);
+    }
+}
+
+// game loop side. tail is only read again when the cached one says the ring is full
+static void push_telemetry_event(telemetry_t* self, int type, int value, const game_state_t* game_state, long tick, long long time_ns) {
+    const unsigned int head = atomic_load_explicit(&self->head, memory_order_relaxed);
+
+    if(head - self->cached_tail == TELEMETRY_RING_SIZE) {
+        self->cached_tail = atomic_load_explicit(&self->tail, memory_order_acquire);
+        if(head - self->cached_tail == TELEMETRY_RING_SIZE) {
+            atomic_fetch_add_explicit(&self->dropped, 1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    telemetry_event_t* event = &self->events[head & (TELEMETRY_RING_SIZE - 1)];
+    event->time_ns = time_ns;
+    event->tick = tick;
+    event->type = type;
+    event->value = value;
+    event->pieces = game_state->g_pieces;
+    event->lines = game_state->g_lines;
+    event->level = game_state->g_level;
+
+    atomic_store_explicit(&self->head, head + 1, memory_order_release);
+}
+
+// --------------------------------------------------
+// exporter thread
+// --------------------------------------------------
+
+// a slow disk only holds up this thread. the ring fills and drops meanwhile, the game loop does not notice
+static void* exporter_main(void* arg) {
+    telemetry_t* self = arg;
+    const struct timespec poll = { 0, TELEMETRY_POLL_MS * 1000000L };
+    long long next_export = get_time_ns() + TELEMETRY_EXPORT_MS * 1000000LL;
+
+    while(!atomic_load(&self->b_stop)) {
+        drain_events(self);
+
+        if(get_time_ns() >= next_export) {
+            write_metrics(self);
+            next_export = get_time_ns() + TELEMETRY_EXPORT_MS * 1000000LL;
+        }
+
+        nanosleep(&poll, NULL);
+    }
+
+    drain_events(self);
+    write_metrics(self);
+
+    return NULL;
+}
+
+static void drain_events(telemetry_t* self) {
+    const unsigned int head = atomic_load_explicit(&self->head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&self->tail, memory_order_relaxed);
+
+    for(; tail != head; ++tail) {
+        add_event(&self->stats, &self->events[tail & (TELEMETRY_RING_SIZE - 1)]);
+    }
+
+    atomic_store_explicit(&self->tail, tail, memory_order_release);
+}
+
+static void add_event(telemetry_stats_t* stats, const telemetry_event_t* event) {
+    stats->level = event->level;
+
+    switch(event->type) {
+        case TELEMETRY_PIECE_SPAWNED:
+            ++stats->pieces;
+            break;
+        case TELEMETRY_PIECE_LOCKED:
+            ++stats->locked_pieces;
+            break;
+        case TELEMETRY_LINES_CLEARED:
+            stats->lines += event->value;
+            break;
+        case TELEMETRY_FRAME:
+            stats->frame_samples[stats->frames % TELEMETRY_FRAME_SAMPLES] = event->value;
+            if(stats->frame_sample_count < TELEMETRY_FRAME_SAMPLES) {
+                ++stats->frame_sample_count;
+            }
+            stats->frame_seconds += event->value / 1.0e6;
+            ++stats->frames;
+            break;
+        case TELEMETRY_FRAME_OVERRUN:
+            ++stats->overruns;
+            break;
+        case TELEMETRY_GAME_OVER:
+            ++stats->games_over;
+            break;
+        default: // TELEMETRY_LEVEL_UP 는 level 만 바꿈
+            break;
+    }
+}
+
+// prometheus text format, written next to the target and renamed over it so a scraper never reads half a file
+static void write_metrics(telemetry_t* self) {
+    telemetry_stats_t* stats = &self->stats;
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+    int sorted[TELEMETRY_FRAME_SAMPLES];
+    char text[4096];
+    char temp_path[TELEMETRY_PATH_SIZE + 8];
+    int length = 0;
+
+    // rate window: the oldest of the last TELEMETRY_RATE_WINDOW exports against now
+    const int slot = stats->window_count % TELEMETRY_RATE_WINDOW;
+    const int oldest = stats->window_count < TELEMETRY_RATE_WINDOW ? 0 : (slot + 1) % TELEMETRY_RATE_WINDOW;
+    stats->window_pieces[slot] = stats->pieces;
+    stats->window_lines[slot] = stats->lines;
+    stats->window_time_ns[slot] = get_time_ns();
+    ++stats->window_count;
+
+    const double seconds = (stats->window_time_ns[slot] - stats->window_time_ns[oldest]) / 1.0e9;
+    const double pieces_per_second = seconds > 0 ? (stats->window_pieces[slot] - stats->window_pieces[oldest]) / seconds : 0;
+    const double lines_per_minute = seconds > 0 ? (stats->window_lines[slot] - stats->window_lines[oldest]) * 60 / seconds : 0;
+
+    length += snprintf(text + length, sizeof(text) - length,
+        "# HELP tetris_pieces_total Pieces spawned.\n# TYPE tetris_pieces_total counter\ntetris_pieces_total %ld\n"
+        "# HELP tetris_locked_pieces_total Pieces that stopped moving.\n# TYPE tetris_locked_pieces_total counter\ntetris_locked_pieces_total %ld\n"
+        "# HELP tetris_lines_total Lines cleared.\n# TYPE tetris_lines_total counter\ntetris_lines_total %ld\n"
+        "# HELP tetris_level Level of the current game.\n# TYPE tetris_level gauge\ntetris_level %d\n"
+        "# HELP tetris_games_over_total Games that ended.\n# TYPE tetris_games_over_total counter\ntetris_games_over_total %ld\n"
+        "# HELP tetris_pieces_per_second Pieces spawned per second over the last %d s.\n# TYPE tetris_pieces_per_second gauge\ntetris_pieces_per_second %.3f\n"
+        "# HELP tetris_lines_per_minute Lines cleared per minute over the last %d s.\n# TYPE tetris_lines_per_minute gauge\ntetris_lines_per_minute %.3f\n"
+        "# HELP tetris_frame_overruns_total Frames longer than %d%% of the target frame time.\n# TYPE tetris_frame_overruns_total counter\ntetris_frame_overruns_total %ld\n"
+        "# HELP tetris_telemetry_dropped_total Events dropped because the ring was full.\n# TYPE tetris_telemetry_dropped_total counter\ntetris_telemetry_dropped_total %u\n"
+        "# HELP tetris_frame_time_seconds Frame time over the last %d frames.\n# TYPE tetris_frame_time_seconds summary\n",
+        stats->pieces, stats->locked_pieces, stats->lines, stats->level, stats->games_over,
+        TELEMETRY_RATE_WINDOW * TELEMETRY_EXPORT_MS / 1000, pieces_per_second,
+        TELEMETRY_RATE_WINDOW * TELEMETRY_EXPORT_MS / 1000, lines_per_minute,
+        TELEMETRY_OVERRUN_PERCENT, stats->overruns,
+        atomic_load_explicit(&self->dropped, memory_order_relaxed),
+        TELEMETRY_FRAME_SAMPLES);
+
+    memcpy(sorted, stats->frame_samples, sizeof(int) * stats->frame_sample_count);
+    qsort(sorted, stats->frame_sample_count, sizeof(int), compare_int);
+    for(int i = 0; i < 3 && stats->frame_sample_count > 0; ++i) {
+        const int k = (int)(quantiles[i] * (stats->frame_sample_count - 1));
+        length += snprintf(text + length, sizeof(text) - length, "tetris_frame_time_seconds{quantile=\"%g\"} %.6f\n", quantiles[i], sorted[k] / 1.0e6);
+    }
+    snprintf(text + length, sizeof(text) - length, "tetris_frame_time_seconds_sum %.6f\ntetris_frame_time_seconds_count %ld\n", stats->frame_seconds, stats->frames);
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", self->path);
+    FILE* file = fopen(temp_path, "w");
+    bool b_ok = file != NULL;
+    if(file != NULL) {
+        b_ok = fputs(text, file) >= 0;
+        b_ok = fclose(file) == 0 && b_ok;
+    }
+    b_ok = b_ok && rename(temp_path, self->path) == 0;
+
+    // 매초 같은 오류를 찍지 않도록 처음 한 번만
+    if(!b_ok && !self->b_failed) {
+        perror(self->path);
+    }
+    self->b_failed = !b_ok;
+}
+
+static int compare_int(const void* a, const void* b) {
+    const int x = *(const int*)a;
+    const int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "gamedata.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    TELEMETRY_RING_SIZE = 4096, // 2 의 거듭제곱. 60 fps 로 30 초 넘게 버팀
+    TELEMETRY_FRAME_SAMPLES = 1024, // percentile 을 계산하는 최근 frame 수
+    TELEMETRY_RATE_WINDOW = 10, // pieces/s, lines/min 을 계산하는 최근 export 수
+    TELEMETRY_EXPORT_MS = 1000,
+    TELEMETRY_POLL_MS = 50,
+    TELEMETRY_OVERRUN_PERCENT = 125, // frame budget 의 이만큼을 넘으면 overrun
+    TELEMETRY_PATH_SIZE = 512
+};
+
+typedef enum telemetry_event_type {
+    TELEMETRY_PIECE_SPAWNED,
+    TELEMETRY_PIECE_LOCKED,
+    TELEMETRY_LINES_CLEARED, // value: 지운 줄 수
+    TELEMETRY_LEVEL_UP, // value: 새 level
+    TELEMETRY_FRAME, // value: frame time in us
+    TELEMETRY_FRAME_OVERRUN, // value: frame time in us
+    TELEMETRY_GAME_OVER
+} telemetry_event_type_t;
+
+// counters are copied from game_state_t when the event happens
+typedef struct telemetry_event_t {
+    long long time_ns; // CLOCK_MONOTONIC
+    long tick;
+    int type;
+    int value;
+    int pieces;
+    int lines;
+    int level;
+} telemetry_event_t;
+
+// what the exporter has seen so far, written out every TELEMETRY_EXPORT_MS
+typedef struct telemetry_stats_t {
+    long pieces;
+    long locked_pieces;
+    long lines;
+    long frames;
+    long overruns;
+    long games_over;
+    int level;
+    double frame_seconds; // 모든 frame time 의 합
+    int frame_samples[TELEMETRY_FRAME_SAMPLES]; // us, ring
+    int frame_sample_count;
+    long window_pieces[TELEMETRY_RATE_WINDOW]; // export 때마다 pieces, lines, 시각을 ring 에 남김
+    long window_lines[TELEMETRY_RATE_WINDOW];
+    long long window_time_ns[TELEMETRY_RATE_WINDOW];
+    int window_count;
+} telemetry_stats_t;
+
+// single producer ring: the game loop pushes and never waits, the exporter thread drains it.
+// a full ring drops the event and counts it
+typedef struct telemetry_t {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head; // game loop 만 씀
+    unsigned int cached_tail; // game loop 가 마지막으로 본 tail
+    atomic_uint dropped; // 가득 차서 버린 event 수
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail; // exporter 만 씀
+    atomic_bool b_stop;
+    telemetry_event_t* events;
+    pthread_t exporter;
+    char path[TELEMETRY_PATH_SIZE];
+    bool b_failed;
+    telemetry_stats_t stats; // exporter thread 만 만짐
+} telemetry_t;
+
+// telemetry_t functions
+
+bool init_telemetry(telemetry_t* self, const char* path);
+void free_telemetry(telemetry_t* self);
+void record_telemetry_step(telemetry_t* self, const game_state_t* before, const game_state_t* after, long tick);
+void record_telemetry_frame(telemetry_t* self, const game_state_t* game_state, long tick, int frame_us, int budget_us);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,340 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "engine.h"
+#include "term_render.h"
+
+// 256-color palette + 1. same order as get_piece_color in tetris.c
+enum {
+    TERM_GRAY = 245,
+    TERM_LIGHTGRAY = 251,
+    TERM_DARKGRAY = 240,
+    TERM_TEXT = 250
+};
+
+static const unsigned char piece_colors[] = {
+    221, // cube, gold
+    29, // L, dark green
+    209, // J, orange
+    206, // I, pink
+    118, // T, sky blue
+    98, // S, violet
+    125, // Z, maroon
+    95 // garbage, brown
+};
+
+static void put_cell(term_screen_t* self, int x, int y, char glyph, unsigned char fg, unsigned char bg);
+static int get_term_board_rows(const board_t* board);
+static void get_term_tile_size(const board_t* board, int* tile_width, int* tile_height);
+static void draw_term_preview(term_screen_t* self, grid_square_t preview[4][4], int x, int y, int piece_num);
+static void append_text(term_screen_t* self, const char* text, int length);
+static void append_number(term_screen_t* self, int value);
+static void append_color(term_screen_t* self, unsigned char fg, unsigned char bg);
+static void write_out_buffer(term_screen_t* self);
+
+// --------------------------------------------------
+// term_screen_t functions
+// --------------------------------------------------
+
+bool init_term_screen(term_screen_t* self, int fd, int width, int height) {
+    self->fd = fd;
+    self->width = width;
+    self->height = height;
+    self->cells = calloc((size_t)width * height, sizeof(term_cell_t));
+    self->shown = calloc((size_t)width * height, sizeof(term_cell_t));
+    self->out_buffer = malloc(TERM_OUT_BUFFER_SIZE);
+    self->out_length = 0;
+    self->b_first_frame = true;
+
+    if(self->cells == NULL || self->shown == NULL || self->out_buffer == NULL) {
+        free(self->cells);
+        free(self->shown);
+        free(self->out_buffer);
+        return false;
+    }
+
+    clear_term_screen(self);
+
+    return true;
+}
+
+// gives the terminal back: default colors, cursor on, main screen
+void free_term_screen(term_screen_t* self) {
+    if(!self->b_first_frame) {
+        append_text(self, "\x1b[0m\x1b[?25h\x1b[?1049l", (int)strlen("\x1b[0m\x1b[?25h\x1b[?1049l"));
+        write_out_buffer(self);
+    }
+
+    free(self->cells);
+    free(self->shown);
+    free(self->out_buffer);
+}
+
+void clear_term_screen(term_screen_t* self) {
+    for(int i = 0; i < self->width * self->height; ++i) {
+        self->cells[i].glyph = ' ';
+        self->cells[i].fg = 0;
+        self->cells[i].bg = 0;
+    }
+}
+
+void draw_term_text(term_screen_t* self, int x, int y, const char* text, unsigned char fg) {
+    for(; *text != '\0'; ++text, ++x) {
+        put_cell(self, x, y, *text, fg, 0);
+    }
+}
+
+// walls and floor included. boards taller than TERM_MAX_ROWS show the rows around the piece
+void draw_term_board(term_screen_t* self, board_t* board, int x, int y) {
+    const int columns = board->width + 2;
+    const int rows = get_term_board_rows(board);
+    const int top = get_view_top(board, rows);
+    grid_square_t (*grid)[columns] = (grid_square_t (*)[columns])board->grid;
+    unsigned char fading_color;
+    unsigned char current_piece_color = TERM_LIGHTGRAY;
+
+    if(board->game_state.finished_piece_num >= 0) {
+        current_piece_color = piece_colors[board->game_state.finished_piece_num];
+    }
+
+    if(board->counter.fade_line_counter % 8 < 4) {
+        fading_color = TERM_DARKGRAY;
+    } else {
+        fading_color = TERM_LIGHTGRAY;
+    }
+
+    for(int i = 0; i < rows; ++i) {
+        for(int j = 0; j < columns; ++j) {
+            const grid_square_t square = grid[top + i][j];
+            const int cell_x = x + j * TERM_CELL_WIDTH;
+            unsigned char bg = 0;
+            char glyph = ' ';
+
+            if(square == EMPTY) {
+                glyph = '.';
+            } else if(square == BLOCK) {
+                bg = TERM_GRAY;
+            } else if(square == MOVING) {
+                bg = current_piece_color;
+            } else if(square == FADING) {
+                bg = fading_color;
+            } else if(square >= FULL) {
+                bg = piece_colors[square - 5];
+            }
+
+            put_cell(self, cell_x, y + i, ' ', 0, bg);
+            put_cell(self, cell_x + 1, y + i, glyph, TERM_DARKGRAY, bg);
+        }
+    }
+}
+
+// same layout as draw_map: one board with previews, or several boards tiled with a short label
+void draw_term_map(term_screen_t* self, board_t boards[], const int visible[], const int visible_count) {
+    char text[64];
+
+    clear_term_screen(self);
+
+    if(visible_count == 1) {
+        board_t* board = &boards[visible[0]];
+        game_state_t* game_state = &board->game_state;
+        const int panel_x = (board->width + 2) * TERM_CELL_WIDTH + 3;
+
+        draw_term_board(self, board, 0, 0);
+
+        draw_term_text(self, panel_x, 1, "INCOMING:", TERM_TEXT);
+        draw_term_preview(self, board->incoming_piece, panel_x, 2, game_state->current_piece_num);
+
+        draw_term_text(self, panel_x, 7, "HOLD:", TERM_TEXT);
+        draw_term_preview(self, board->hold_piece, panel_x, 8, game_state->hold_piece_num);
+
+        snprintf(text, sizeof(text), "Level: %02d", game_state->g_level);
+        draw_term_text(self, panel_x, 13, text, TERM_TEXT);
+        snprintf(text, sizeof(text), "Lines: %d", game_state->g_lines);
+        draw_term_text(self, panel_x, 14, text, TERM_TEXT);
+
+        if(game_state->b_game_over) {
+            draw_term_text(self, panel_x, 16, "GAME OVER!", piece_colors[6]);
+        } else if(game_state->b_pause) {
+            draw_term_text(self, panel_x, 16, "GAME PAUSED", TERM_TEXT);
+        }
+    } else {
+        int tile_width;
+        int tile_height;
+
+        get_term_tile_size(&boards[visible[0]], &tile_width, &tile_height);
+
+        for(int k = 0; k < visible_count; ++k) {
+            board_t* board = &boards[visible[k]];
+            const int x = (k % TERM_MAX_COLUMNS) * tile_width;
+            const int y = (k / TERM_MAX_COLUMNS) * tile_height;
+
+            if(board->game_state.b_game_over) {
+                snprintf(text, sizeof(text), "#%d GAME OVER", visible[k]);
+            } else {
+                snprintf(text, sizeof(text), "#%d L%02d %d", visible[k], board->game_state.g_level, board->game_state.g_lines);
+            }
+            draw_term_text(self, x, y, text, TERM_TEXT);
+            draw_term_board(self, board, x, y + 1);
+        }
+    }
+}
+
+// sends only the cells that differ from the shown frame, in one write
+void present_term_screen(term_screen_t* self) {
+    int cursor_x = -1;
+    int cursor_y = -1;
+    // 255 는 아직 색을 보내지 않았다는 뜻
+    unsigned char fg = 255;
+    unsigned char bg = 255;
+
+    if(self->b_first_frame) {
+        // alternate screen, cursor off, clear. shown 을 무효화해서 전부 다시 그림
+        append_text(self, "\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J", (int)strlen("\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J"));
+        memset(self->shown, 0, sizeof(term_cell_t) * self->width * self->height);
+        self->b_first_frame = false;
+    }
+
+    for(int y = 0; y < self->height; ++y) {
+        for(int x = 0; x < self->width; ++x) {
+            const int index = y * self->width + x;
+            const term_cell_t cell = self->cells[index];
+            term_cell_t* shown = &self->shown[index];
+
+            if(cell.glyph == shown->glyph && cell.fg == shown->fg && cell.bg == shown->bg) {
+                continue;
+            }
+
+            if(cursor_x != x || cursor_y != y) {
+                append_text(self, "\x1b[", 2);
+                append_number(self, y + 1);
+                append_text(self, ";", 1);
+                append_number(self, x + 1);
+                append_text(self, "H", 1);
+            }
+            if(cell.fg != fg || cell.bg != bg) {
+                append_color(self, cell.fg, cell.bg);
+                fg = cell.fg;
+                bg = cell.bg;
+            }
+            append_text(self, &cell.glyph, 1);
+
+            *shown = cell;
+            cursor_x = x + 1;
+            cursor_y = y;
+        }
+    }
+
+    write_out_buffer(self);
+}
+
+// boards of one map all have the size of board
+void get_term_map_size(const board_t* board, const int visible_count, int* width, int* height) {
+    if(visible_count == 1) {
+        *width = (board->width + 2) * TERM_CELL_WIDTH + 3 + 4 * TERM_CELL_WIDTH + 4;
+        *height = get_term_board_rows(board);
+        if(*height < 17) { // panel 의 마지막 줄까지
+            *height = 17;
+        }
+    } else {
+        int tile_width;
+        int tile_height;
+        const int columns = visible_count < TERM_MAX_COLUMNS ? visible_count : TERM_MAX_COLUMNS;
+
+        get_term_tile_size(board, &tile_width, &tile_height);
+        *width = columns * tile_width;
+        *height = (visible_count + TERM_MAX_COLUMNS - 1) / TERM_MAX_COLUMNS * tile_height;
+    }
+}
+
+// playfield rows and the floor, at most TERM_MAX_ROWS
+static int get_term_board_rows(const board_t* board) {
+    return board->height + 1 < TERM_MAX_ROWS ? board->height + 1 : TERM_MAX_ROWS;
+}
+
+// one board and its label line, with a gap on the right
+static void get_term_tile_size(const board_t* board, int* tile_width, int* tile_height) {
+    *tile_width = (board->width + 2) * TERM_CELL_WIDTH + 2;
+    *tile_height = get_term_board_rows(board) + 1;
+}
+
+static void put_cell(term_screen_t* self, int x, int y, char glyph, unsigned char fg, unsigned char bg) {
+    if(x < 0 || y < 0 || x >= self->width || y >= self->height) {
+        return;
+    }
+
+    term_cell_t* cell = &self->cells[y * self->width + x];
+    cell->glyph = glyph;
+    cell->fg = fg;
+    cell->bg = bg;
+}
+
+static void draw_term_preview(term_screen_t* self, grid_square_t preview[4][4], int x, int y, int piece_num) {
+    const unsigned char color = piece_num >= 0 ? piece_colors[piece_num] : TERM_LIGHTGRAY;
+
+    for(int i = 0; i < 4; ++i) {
+        for(int j = 0; j < 4; ++j) {
+            if(preview[i][j] == MOVING) {
+                put_cell(self, x + j * TERM_CELL_WIDTH, y + i, ' ', 0, color);
+                put_cell(self, x + j * TERM_CELL_WIDTH + 1, y + i, ' ', 0, color);
+            } else {
+                put_cell(self, x + j * TERM_CELL_WIDTH, y + i, ' ', 0, 0);
+                put_cell(self, x + j * TERM_CELL_WIDTH + 1, y + i, '.', TERM_DARKGRAY, 0);
+            }
+        }
+    }
+}
+
+static void append_text(term_screen_t* self, const char* text, int length) {
+    if(self->out_length + length > TERM_OUT_BUFFER_SIZE) {
+        write_out_buffer(self);
+    }
+
+    memcpy(self->out_buffer + self->out_length, text, length);
+    self->out_length += length;
+}
+
+static void append_number(term_screen_t* self, int value) {
+    char text[12];
+    int length = 0;
+
+    do {
+        text[sizeof(text) - 1 - length++] = '0' + value % 10;
+        value /= 10;
+    } while(value != 0);
+
+    append_text(self, text + sizeof(text) - length, length);
+}
+
+// 0 은 기본 색으로 되돌림
+static void append_color(term_screen_t* self, unsigned char fg, unsigned char bg) {
+    append_text(self, "\x1b[0", 3);
+    if(fg != 0) {
+        append_text(self, ";38;5;", 6);
+        append_number(self, fg - 1);
+    }
+    if(bg != 0) {
+        append_text(self, ";48;5;", 6);
+        append_number(self, bg - 1);
+    }
+    append_text(self, "m", 1);
+}
+
+static void write_out_buffer(term_screen_t* self) {
+    int written = 0;
+
+    while(written < self->out_length) {
+        const ssize_t count = write(self->fd, self->out_buffer + written, self->out_length - written);
+        if(count < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += count;
+    }
+
+    self->out_length = 0;
+}
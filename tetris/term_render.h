@@ -0,0 +1,49 @@
+#ifndef TERM_RENDER_H
+#define TERM_RENDER_H
+
+#include <stdbool.h>
+#include "engine.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    TERM_CELL_WIDTH = 2, // board 한 칸 = 터미널 두 글자
+    TERM_MAX_ROWS = 40, // 더 높은 board 는 블록을 따라가는 창으로 보여줌
+    TERM_MAX_COLUMNS = 4, // 여러 board 를 그릴 때 한 줄에 놓는 최대 수
+    TERM_MAX_BOARDS = 8,
+    TERM_OUT_BUFFER_SIZE = 1 << 16
+};
+
+// colors are 256-color palette index + 1, 0 keeps the terminal default
+typedef struct term_cell_t {
+    char glyph;
+    unsigned char fg;
+    unsigned char bg;
+} term_cell_t;
+
+// the frame being drawn and the frame the terminal currently shows
+typedef struct term_screen_t {
+    int fd;
+    int width;
+    int height;
+    term_cell_t* cells;
+    term_cell_t* shown;
+    char* out_buffer;
+    int out_length;
+    bool b_first_frame;
+} term_screen_t;
+
+// term_screen_t functions
+
+bool init_term_screen(term_screen_t* self, int fd, int width, int height);
+void free_term_screen(term_screen_t* self);
+void clear_term_screen(term_screen_t* self);
+void draw_term_text(term_screen_t* self, int x, int y, const char* text, unsigned char fg);
+void draw_term_board(term_screen_t* self, board_t* board, int x, int y);
+void draw_term_map(term_screen_t* self, board_t boards[], const int visible[], const int visible_count);
+void present_term_screen(term_screen_t* self);
+void get_term_map_size(const board_t* board, const int visible_count, int* width, int* height);
+
+#endif /* TERM_RENDER_H */
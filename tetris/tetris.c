@@ -1,10 +1,32 @@
 #include <assert.h>
 #include <math.h>
 #include <raylib.h>
+#include <rlgl.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "gamedata.h"
+#include "engine.h"
+#include "engine_check.h"
+#include "analysis.h"
+#include "archive.h"
+#include "autoplay.h"
+#include "book.h"
+#include "bot.h"
+#include "bot_server.h"
+#include "frame_export.h"
+#include "journal.h"
+#include "mcts.h"
+#include "netplay.h"
+#include "replay.h"
+#include "solver.h"
+#include "term_render.h"
+#include "thread_pool.h"
+#include "tournament.h"
+#include "versus.h"
 #include "tetris.h"
 
 static void draw_init_page(void) {
@@ -135,642 +157,827 @@ static void check_game_start(game_state_t* game_state) {
 }
 
 // initialize game variables
-static void init_game(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, counter_t* counter) {
-    reset_game_state(game_state);
-    reset_counter(counter);
-    SetTargetFPS(60);
-
-    for(int i = 0; i < GRID_Y_SIZE; ++i) {
-        for(int j = 0; j < GRID_X_SIZE; ++j) {
-            if((i == GRID_Y_SIZE - 1) || (j == 0) || (j == GRID_X_SIZE - 1)) {
-                grid[i][j] = BLOCK;
-            } else {
-                grid[i][j] = EMPTY;
-            }
-        }
+static void init_game(board_t* board, unsigned int seed) {
+    init_board(board, seed);
+    SetTargetFPS(BASE_FPS);
+}
+
+// squares shrink for wide or tall boards until the window fits in MAX_SCREEN_*, then tall boards show a window of rows.
+// board at (22, 12), then 3 squares of gap, a 4 square preview and 40 px on the right
+static layout_t get_layout(int width, int height) {
+    layout_t layout;
+    int square_size = SQUARE_SIZE;
+
+    while(square_size > MIN_SQUARE_SIZE && 22 + square_size * (width + 9) + 40 > MAX_SCREEN_WIDTH) {
+        --square_size;
+    }
+    while(square_size > MIN_SQUARE_SIZE && 12 + square_size * (height + 1) + 18 > MAX_SCREEN_HEIGHT) {
+        --square_size;
     }
 
-    for(int i = 0; i < 4; ++i) {
-        for(int j = 0; j < 4; ++j) {
-            incoming_piece[i][j] = EMPTY;
-            hold_piece[i][j] = EMPTY;
-            piece[i][j] = EMPTY;
-        }
+    layout.square_size = square_size;
+    layout.visible_rows = height + 1;
+    if(12 + square_size * layout.visible_rows + 18 > MAX_SCREEN_HEIGHT) {
+        layout.visible_rows = (MAX_SCREEN_HEIGHT - 30) / square_size;
+    }
+
+    // 낮은 board 도 옆의 preview 와 level 이 들어가야 함
+    const int rows = layout.visible_rows > 13 ? layout.visible_rows : 13;
+    layout.screen_width = 22 + square_size * (width + 9) + 40;
+    layout.screen_height = 12 + square_size * rows + 18;
+    if(layout.screen_width < SCREEN_WIDTH) {
+        layout.screen_width = SCREEN_WIDTH;
     }
+    if(layout.screen_height < SCREEN_HEIGHT) {
+        layout.screen_height = SCREEN_HEIGHT;
+    }
+
+    return layout;
 }
 
-static void draw_map(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], game_state_t* game_state, Color* current_piece_color, Color* incoming_piece_color, Color* hold_piece_color, counter_t* counter) {
+static void draw_map(const layout_t* layout, board_t boards[], const int visible[], const int visible_count, const finesse_t* finesse) {
     BeginDrawing();
-    ClearBackground(WHITE);
+    render_map(layout, boards, visible, visible_count, finesse);
+    EndDrawing();
+}
 
-    if(!game_state->b_game_over) {
-        Color square_color;
-        Color fading_color;
-        Vector2 offset;
-        offset.x = 22;
-        offset.y = 12;
-        int controller_x = offset.x;
-        int controller_y = offset.y;
-
-        if(counter->fade_line_counter % 8 < 4) {
-            fading_color = DARKGRAY;
-        } else {
-            fading_color = LIGHTGRAY;
-        }
-
-        for(int i = 0; i < GRID_Y_SIZE; ++i) {
-            for(int j = 0; j < GRID_X_SIZE; ++j) {
-                if(grid[i][j] == EMPTY) {
-                    DrawLine(offset.x, offset.y, offset.x + SQUARE_SIZE, offset.y, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y, offset.x, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x + SQUARE_SIZE, offset.y, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y + SQUARE_SIZE, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                } else if(grid[i][j] == BLOCK) {
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, GRAY);
-                } else if(grid[i][j] == MOVING) {
-                    DrawLine(offset.x, offset.y, offset.x + SQUARE_SIZE, offset.y, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y, offset.x, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x + SQUARE_SIZE, offset.y, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y + SQUARE_SIZE, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, *current_piece_color);
-                } else if(grid[i][j] == FADING) {
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, fading_color);
-                } else if(grid[i][j] >= FULL) {
-                    square_color = get_piece_color(grid[i][j] - 5);
-                    DrawLine(offset.x, offset.y, offset.x + SQUARE_SIZE, offset.y, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y, offset.x, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x + SQUARE_SIZE, offset.y, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y + SQUARE_SIZE, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, square_color);
-                }
-                offset.x += SQUARE_SIZE;
-            }
-            offset.x = controller_x;
-            offset.y += SQUARE_SIZE;
-        }
-
-        offset.x += (SQUARE_SIZE * (GRID_X_SIZE + 3));
-        offset.y = controller_y + (SQUARE_SIZE);
-        controller_x = offset.x;
-        controller_y = offset.y;
-
-        DrawText("INCOMING:", offset.x, offset.y - 20, 10, GRAY);
-        for(int i = 0; i < 4; ++i) {
-            for(int j = 0; j < 4; ++j) {
-                if(incoming_piece[i][j] == EMPTY) {
-                    DrawLine(offset.x, offset.y, offset.x + SQUARE_SIZE, offset.y, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y, offset.x, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x + SQUARE_SIZE, offset.y, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y + SQUARE_SIZE, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                } else if(incoming_piece[i][j] == MOVING) {
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, *incoming_piece_color);
-                }
-                offset.x += SQUARE_SIZE;
-            }
-            offset.x = controller_x;
-            offset.y += SQUARE_SIZE;
-        }
-
-        offset.y += (SQUARE_SIZE * 2);
-        controller_y = offset.y;
-
-        DrawText("HOLD:", offset.x, offset.y - 20, 10, GRAY);
-        for(int i = 0; i < 4; ++i) {
-            for(int j = 0; j < 4; ++j) {
-                if(hold_piece[i][j] == EMPTY) {
-                    DrawLine(offset.x, offset.y, offset.x + SQUARE_SIZE, offset.y, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y, offset.x, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x + SQUARE_SIZE, offset.y, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                    DrawLine(offset.x, offset.y + SQUARE_SIZE, offset.x + SQUARE_SIZE, offset.y + SQUARE_SIZE, LIGHTGRAY);
-                } else if(hold_piece[i][j] == MOVING) {
-                    DrawRectangle(offset.x, offset.y, SQUARE_SIZE, SQUARE_SIZE, *hold_piece_color);
-                }
-                offset.x += SQUARE_SIZE;
-            }
-            offset.x = controller_x;
-            offset.y += SQUARE_SIZE;
-        }
+// one board fills the screen with its previews. several boards are tiled in a grid without them.
+// no BeginDrawing here, so the same picture can go to a render texture. finesse is NULL when nobody is judged
+static void render_map(const layout_t* layout, board_t boards[], const int visible[], const int visible_count, const finesse_t* finesse) {
+    const int square = layout->square_size;
 
-        offset.y += SQUARE_SIZE;
-        DrawText(TextFormat("Level: %02d", game_state->g_level), offset.x, offset.y, 12, GRAY);
+    ClearBackground(WHITE);
 
-        if(game_state->b_pause) {
-            DrawText("GAME PAUSED", (SCREEN_WIDTH - MeasureText("GAME_PAUSED", 40)) / 2, SCREEN_HEIGHT / 2 - 40 , 40, GRAY);
-        }
-    } else { // game over 문구
-        struct timespec specific_time;
-        clock_gettime(CLOCK_REALTIME, &specific_time);
-        const int time_seed = floor(specific_time.tv_nsec / 1.0e6);
+    if(visible_count == 1) {
+        board_t* board = &boards[visible[0]];
+        game_state_t* game_state = &board->game_state;
 
-        if(time_seed < 500) {
-            DrawText("GAME OVER!", (SCREEN_WIDTH - MeasureText("GAME OVER!", 20)) / 2, SCREEN_HEIGHT / 2 - 60 , 20, GRAY);
-            DrawText("PRESS [ENTER] TO PLAY AGAIN...", (SCREEN_WIDTH - MeasureText("PRESS [ENTER] TO PLAY AGAIN...", 20)) / 2, SCREEN_HEIGHT / 2 - 40 , 20, GRAY);
-        } else {
-            DrawText("GAME OVER!", (SCREEN_WIDTH - MeasureText("GAME OVER!", 20)) / 2, SCREEN_HEIGHT / 2 - 60 , 20, WHITE);
-            DrawText("PRESS [ENTER] TO PLAY AGAIN...", (SCREEN_WIDTH - MeasureText("PRESS [ENTER] TO PLAY AGAIN...", 20)) / 2, SCREEN_HEIGHT / 2 - 40 , 20, WHITE);
-        }
-    }
+        if(!game_state->b_game_over) {
+            Vector2 offset;
+            offset.x = 22;
+            offset.y = 12;
 
-    EndDrawing();
-}
+            draw_board(board, offset, square, layout->visible_rows);
 
-static void update_draw_frame(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, counter_t* counter, Color* current_piece_color, Color* incoming_piece_color) {
-    if(IsKeyPressed(KEY_P)) {
-        set_pause(game_state, !game_state->b_pause);
-    }
+            offset.x += (square * (board->width + 5));
+            offset.y += square;
 
-    if(!game_state->b_pause) {
-        if(!game_state->b_line_to_delete) {
-            if(!game_state->b_piece_active) {
-                set_piece_active(game_state, create_piece(grid, incoming_piece, piece, game_state, current_piece_color, incoming_piece_color));
-                set_fast_fall_movement_counter(counter, 0);
-                resolve_level(game_state);
-            } else {
-                if(!game_state->b_hard_drop) {
-                    increment_fast_fall_movement_counter(counter);
-                    increment_gravity_movement_counter(counter);
-                    increment_lateral_movement_counter(counter);
-                    increment_turn_movement_counter(counter);
-
-                    if(IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_RIGHT)) {
-                        set_lateral_movement_counter(counter, LATERAL_SPEED);
-                    }
+            DrawText("INCOMING:", offset.x, offset.y - 20, 10, GRAY);
+            draw_preview(board->incoming_piece, offset, square, game_state->current_piece_num >= 0 ? get_piece_color(game_state->current_piece_num) : LIGHTGRAY);
 
-                    if(IsKeyPressed(KEY_UP)) {
-                        set_turn_movement_counter(counter, TURNING_SPEED);
-                    }
+            offset.y += (square * 6);
 
-                    if(IsKeyDown(KEY_DOWN) && (counter->fast_fall_movement_counter >= FAST_FALL_AWAIT_COUNTER)) {
-                        set_gravity_movement_counter(counter, counter->gravity_movement_counter + game_state->gravity_speed);
-                    }
+            DrawText("HOLD:", offset.x, offset.y - 20, 10, GRAY);
+            draw_preview(board->hold_piece, offset, square, game_state->hold_piece_num >= 0 ? get_piece_color(game_state->hold_piece_num) : LIGHTGRAY);
 
-                    if(IsKeyDown(KEY_SPACE)) {
-                        set_hard_drop(game_state, true);
-                    }
-
-                    if(counter->gravity_movement_counter >= game_state->gravity_speed) {
-                        check_detection(grid, game_state);
-                        resolve_falling_movement(grid, game_state);
-                        check_completion(grid, game_state);
-                        set_gravity_movement_counter(counter, 0);
-                    }
+            offset.y += (square * 5);
+            DrawText(TextFormat("Level: %02d", game_state->g_level), offset.x, offset.y, 12, GRAY);
+            if(board->dig_rows > 0) {
+                offset.y += 16;
+                DrawText(TextFormat("Dug: %ld", board->dug_rows), offset.x, offset.y, 12, GRAY);
+            }
 
-                    if(counter->lateral_movement_counter >= LATERAL_SPEED) {
-                        if(!resolve_lateral_movement(grid, game_state)) {
-                            set_lateral_movement_counter(counter, 0);
-                        }
-                    }
+            // 마지막 블록의 실제 입력 / 최소 입력. 많으면 빨간색
+            if(finesse != NULL && finesse->last.piece_num >= 0) {
+                const finesse_result_t* last = &finesse->last;
 
-                    if(counter->turn_movement_counter >= TURNING_SPEED) {
-                        if(resolve_turn_movement(grid, piece, game_state)) {
-                            set_turn_movement_counter(counter, 0);
-                        }
-                    }
-                } else { // hard drop 인 경우
-                    check_detection(grid, game_state);
-                    resolve_falling_movement(grid, game_state);
-                    check_completion(grid, game_state);
+                offset.y += 16;
+                if(last->b_found) {
+                    DrawText(TextFormat("Finesse: %d/%d", last->actual, last->optimal), offset.x, offset.y, 12, last->actual > last->optimal ? MAROON : GRAY);
+                } else {
+                    DrawText("Finesse: -", offset.x, offset.y, 12, GRAY);
                 }
+                offset.y += 16;
+                DrawText(TextFormat("Faults: %ld/%ld", finesse->faults, finesse->pieces), offset.x, offset.y, 12, GRAY);
             }
 
-            // game over logic
-            for(int i = 0; i < 2; ++i) {
-                for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                    if(grid[i][j] >= FULL) {
-                        set_game_over(game_state, true);
-                    }
-                }
+            if(game_state->b_pause) {
+                DrawText("GAME PAUSED", (layout->screen_width - MeasureText("GAME_PAUSED", 40)) / 2, layout->screen_height / 2 - 40 , 40, GRAY);
+            }
+        } else { // game over 문구
+            struct timespec specific_time;
+            clock_gettime(CLOCK_REALTIME, &specific_time);
+            const int time_seed = floor(specific_time.tv_nsec / 1.0e6);
+
+            if(time_seed < 500) {
+                DrawText("GAME OVER!", (layout->screen_width - MeasureText("GAME OVER!", 20)) / 2, layout->screen_height / 2 - 60 , 20, GRAY);
+                DrawText("PRESS [ENTER] TO PLAY AGAIN...", (layout->screen_width - MeasureText("PRESS [ENTER] TO PLAY AGAIN...", 20)) / 2, layout->screen_height / 2 - 40 , 20, GRAY);
+            } else {
+                DrawText("GAME OVER!", (layout->screen_width - MeasureText("GAME OVER!", 20)) / 2, layout->screen_height / 2 - 60 , 20, WHITE);
+                DrawText("PRESS [ENTER] TO PLAY AGAIN...", (layout->screen_width - MeasureText("PRESS [ENTER] TO PLAY AGAIN...", 20)) / 2, layout->screen_height / 2 - 40 , 20, WHITE);
             }
-        } else { // delete line
-            increment_fade_line_counter(counter);
-
-            if(counter->fade_line_counter >= FADING_TIME) {
-                int deleted_lines = 0;
-                deleted_lines = delete_complete_lines(grid);
-                set_fade_line_counter(counter, 0);
-                set_line_to_delete(game_state, false);
-                game_state->g_lines += deleted_lines;
+        }
+    } else {
+        int columns = 1;
+        while(columns * columns < visible_count) {
+            ++columns;
+        }
+        const int rows = (visible_count + columns - 1) / columns;
+        const int tile_width = layout->screen_width / columns;
+        const int tile_height = layout->screen_height / rows;
+        const int board_rows = layout->visible_rows;
+        int square_size = (tile_width - 4) / (boards[visible[0]].width + 2);
+        if((tile_height - 14) / board_rows < square_size) {
+            square_size = (tile_height - 14) / board_rows;
+        }
+        if(square_size < 1) {
+            square_size = 1;
+        }
+
+        for(int k = 0; k < visible_count; ++k) {
+            board_t* board = &boards[visible[k]];
+            Vector2 offset;
+            offset.x = (k % columns) * tile_width + 2;
+            offset.y = (k / columns) * tile_height + 12;
+
+            DrawText(TextFormat("#%d L%02d %d", visible[k], board->game_state.g_level, board->game_state.g_lines), offset.x, offset.y - 10, 10, GRAY);
+            draw_board(board, offset, square_size, board_rows);
+
+            if(board->game_state.b_game_over) {
+                DrawText("GAME OVER", offset.x, offset.y + square_size * board_rows / 2, 10, MAROON);
             }
         }
     }
 }
 
-static void resolve_level(game_state_t* game_state) {
-    int fps = GetFPS();
-    int current_level = game_state->g_level;
-    int new_level = game_state->g_lines / 10 + 1;
-    if(current_level != new_level) {
-        set_level(game_state, new_level);
-        SetTargetFPS(fps + 10);
+// visible_rows rows from get_view_top, walls included
+static void draw_board(board_t* board, Vector2 offset, const int square_size, const int visible_rows) {
+    const int columns = board->width + 2;
+    const int top = get_view_top(board, visible_rows);
+    grid_square_t (*grid)[columns] = (grid_square_t (*)[columns])board->grid;
+    const int controller_x = offset.x;
+    Color square_color;
+    Color fading_color;
+    Color current_piece_color = LIGHTGRAY;
+
+    if(board->game_state.finished_piece_num >= 0) {
+        current_piece_color = get_piece_color(board->game_state.finished_piece_num);
     }
-}
 
-static void save_color(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], const int piece_num) {
-    for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-        for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-            if(grid[i][j] == FULL) {
-                grid[i][j] = piece_num + 5;
+    if(board->counter.fade_line_counter % 8 < 4) {
+        fading_color = DARKGRAY;
+    } else {
+        fading_color = LIGHTGRAY;
+    }
+
+    for(int i = top; i < top + visible_rows; ++i) {
+        for(int j = 0; j < columns; ++j) {
+            if(grid[i][j] == EMPTY) {
+                DrawLine(offset.x, offset.y, offset.x + square_size, offset.y, LIGHTGRAY);
+                DrawLine(offset.x, offset.y, offset.x, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x + square_size, offset.y, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x, offset.y + square_size, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+            } else if(grid[i][j] == BLOCK) {
+                DrawRectangle(offset.x, offset.y, square_size, square_size, GRAY);
+            } else if(grid[i][j] == MOVING) {
+                DrawLine(offset.x, offset.y, offset.x + square_size, offset.y, LIGHTGRAY);
+                DrawLine(offset.x, offset.y, offset.x, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x + square_size, offset.y, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x, offset.y + square_size, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawRectangle(offset.x, offset.y, square_size, square_size, current_piece_color);
+            } else if(grid[i][j] == FADING) {
+                DrawRectangle(offset.x, offset.y, square_size, square_size, fading_color);
+            } else if(grid[i][j] >= FULL) {
+                square_color = get_piece_color(grid[i][j] - 5);
+                DrawLine(offset.x, offset.y, offset.x + square_size, offset.y, LIGHTGRAY);
+                DrawLine(offset.x, offset.y, offset.x, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x + square_size, offset.y, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x, offset.y + square_size, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawRectangle(offset.x, offset.y, square_size, square_size, square_color);
             }
+            offset.x += square_size;
         }
+        offset.x = controller_x;
+        offset.y += square_size;
     }
 }
 
-static void check_detection(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state) {
-    for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-        for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-            if((grid[i][j] == MOVING) && ((grid[i + 1][j] >= FULL) || (grid[i + 1][j] == BLOCK))) {
-                set_detection(game_state, true);
+static void draw_preview(grid_square_t preview[4][4], Vector2 offset, const int square_size, Color color) {
+    const int controller_x = offset.x;
+
+    for(int i = 0; i < 4; ++i) {
+        for(int j = 0; j < 4; ++j) {
+            if(preview[i][j] == EMPTY) {
+                DrawLine(offset.x, offset.y, offset.x + square_size, offset.y, LIGHTGRAY);
+                DrawLine(offset.x, offset.y, offset.x, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x + square_size, offset.y, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+                DrawLine(offset.x, offset.y + square_size, offset.x + square_size, offset.y + square_size, LIGHTGRAY);
+            } else if(preview[i][j] == MOVING) {
+                DrawRectangle(offset.x, offset.y, square_size, square_size, color);
             }
+            offset.x += square_size;
         }
+        offset.x = controller_x;
+        offset.y += square_size;
     }
 }
 
-static void resolve_falling_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state) {
-    if(game_state->b_detection) { // finish moving piece
-        for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                if(grid[i][j] == MOVING) {
-                    grid[i][j] = FULL;
-                    set_detection(game_state, false);
-                    set_piece_active(game_state, false);
-                }
-            }
-        }
-        save_color(grid, game_state->finished_piece_num);
-        if(game_state->b_hard_drop) {
-            set_hard_drop(game_state, false);
+// keyboard state of this frame as engine input
+static void read_keyboard(input_t* input) {
+    input->down = 0;
+    input->pressed = 0;
+
+    if(IsKeyDown(KEY_LEFT)) input->down |= INPUT_LEFT;
+    if(IsKeyDown(KEY_RIGHT)) input->down |= INPUT_RIGHT;
+    if(IsKeyDown(KEY_UP)) input->down |= INPUT_UP;
+    if(IsKeyDown(KEY_DOWN)) input->down |= INPUT_DOWN;
+    if(IsKeyDown(KEY_SPACE)) input->down |= INPUT_SPACE;
+
+    if(IsKeyPressed(KEY_LEFT)) input->pressed |= INPUT_LEFT;
+    if(IsKeyPressed(KEY_RIGHT)) input->pressed |= INPUT_RIGHT;
+    if(IsKeyPressed(KEY_UP)) input->pressed |= INPUT_UP;
+    if(IsKeyPressed(KEY_P)) input->pressed |= INPUT_PAUSE;
+}
+
+// level 이 바뀌면 frame rate 를 다시 맞춤
+static void resolve_frame_rate(game_state_t* game_state, int* current_level) {
+    if(*current_level != game_state->g_level) {
+        *current_level = game_state->g_level;
+        SetTargetFPS(get_target_fps(game_state->g_level));
+    }
+}
+
+// 10 fps faster every level
+static int get_target_fps(int level) {
+    return BASE_FPS + 10 * (level - 1);
+}
+
+// terminal and headless loops keep their own frame clock. fps 0 runs unthrottled
+static void wait_next_frame(struct timespec* next_frame, int fps) {
+    if(fps <= 0) {
+        return;
+    }
+
+    next_frame->tv_nsec += 1000000000L / fps;
+    if(next_frame->tv_nsec >= 1000000000L) {
+        next_frame->tv_nsec -= 1000000000L;
+        ++(next_frame->tv_sec);
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, next_frame, NULL);
+}
+
+static void get_bot_input_for_board(void* ctx, int board_index, const board_t* board, input_t* input) {
+    bot_t* bots = ctx;
+    get_bot_input(&bots[board_index], board, input);
+}
+
+// bots come from calloc, so the ones init_bot did not reach have no scratch board
+static void free_bots(bot_t bots[], int count) {
+    for(int i = 0; bots != NULL && i < count; ++i) {
+        free_bot(&bots[i]);
+    }
+    free(bots);
+}
+
+// the finished game is saved to record_path when it is given. with metrics_path, gameplay events go to the telemetry ring,
+// with publish_name every tick goes to the spectator stream
+// with autosave_path, a game saved there is resumed with its own board size, seed and dig rows
+static int run_single_player(unsigned int seed, int width, int height, int dig_rows, const char* record_path, const char* metrics_path, const char* publish_name, const char* autosave_path) {
+    board_t board;
+    replay_t replay;
+    input_t input;
+    telemetry_t telemetry;
+    spectator_t spectator;
+    finesse_t finesse;
+    journal_t journal;
+    game_state_t before;
+    const int visible = 0;
+    int current_level = 1;
+    long tick = 0;
+
+    // 이어 하는 게임의 replay 는 중간부터라 저장하지 않음. 다음 게임부터 다시 기록
+    bool b_resumed = autosave_path != NULL && load_journal(autosave_path, &board, &seed, &tick);
+    if(b_resumed) {
+        width = board.width;
+        height = board.height;
+        if(record_path != NULL) {
+            fprintf(stderr, "tetris: resumed game at tick %ld, its replay is not recorded\n", tick);
         }
-    } else { // move piece down
-        for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                if(grid[i][j] == MOVING) {
-                    grid[i + 1][j] = MOVING;
-                    grid[i][j] = EMPTY;
-                }
-            }
+    }
+
+    const layout_t layout = get_layout(width, height);
+    const bool b_board = b_resumed || create_board(&board, width, height);
+    const bool b_finesse = init_finesse(&finesse, width, height);
+    if(b_board && !b_resumed) {
+        set_dig_rows(&board, dig_rows);
+    }
+    if(!b_board || !b_finesse) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_board(&board);
+        free_finesse(&finesse);
+        return 1;
+    }
+    if(metrics_path != NULL && !init_telemetry(&telemetry, metrics_path)) {
+        fprintf(stderr, "tetris: cannot start telemetry\n");
+        free_finesse(&finesse);
+        free_board(&board);
+        return 1;
+    }
+    if(publish_name != NULL && !open_spectator_publisher(&spectator, publish_name, width, height)) {
+        perror(publish_name);
+        if(metrics_path != NULL) {
+            free_telemetry(&telemetry);
         }
-        increment_piece_position_y(game_state);
+        free_finesse(&finesse);
+        free_board(&board);
+        return 1;
     }
-}
 
-static bool resolve_lateral_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state) {
-    bool collision = false;
+    InitWindow(layout.screen_width, layout.screen_height, "tetris");
+    if(b_resumed) {
+        SetTargetFPS(BASE_FPS);
+        resolve_frame_rate(&board.game_state, &current_level);
+    } else {
+        init_game(&board, seed);
+    }
+    init_replay(&replay, seed, width, height, board.dig_rows);
+    if(autosave_path != NULL && !init_journal(&journal, autosave_path, &board, seed, tick)) {
+        fprintf(stderr, "tetris: cannot start autosave\n");
+        autosave_path = NULL;
+    }
 
-    if(IsKeyDown(KEY_LEFT)) {
-        for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                if(grid[i][j] == MOVING) {
-                    if(j == 1 || grid[i][j - 1] >= FULL) {
-                        collision = true;
-                    }
-                }
+    // main game loop
+    while (!WindowShouldClose()) {
+        if(!board.game_state.b_begin_game) {
+            draw_init_page();
+            check_game_start(&board.game_state);
+            if(board.game_state.b_begin_game && autosave_path != NULL) {
+                mark_journal_reset(&journal, &board, seed, tick);
             }
-        }
+        } else {
+            if(!board.game_state.b_game_over) {
+                read_keyboard(&input);
+                before = board.game_state;
+                step_board(&board, input);
+                ++tick;
+                if(autosave_path != NULL) {
+                    record_journal_step(&journal, &board, input, seed, tick);
+                }
+                record_replay_input(&replay, input);
+                record_finesse_step(&finesse, &before, &board);
+                if(metrics_path != NULL) {
+                    record_telemetry_step(&telemetry, &before, &board.game_state, replay.tick_count);
+                    record_telemetry_frame(&telemetry, &board.game_state, replay.tick_count, (int)(GetFrameTime() * 1.0e6f), 1000000 / get_target_fps(current_level));
+                }
+                if(publish_name != NULL) {
+                    publish_spectator_frame(&spectator, &board);
+                }
+                resolve_frame_rate(&board.game_state, &current_level);
 
-        if(!collision) {
-            for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-                for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                    if(grid[i][j] == MOVING) {
-                        grid[i][j - 1] = MOVING;
-                        grid[i][j] = EMPTY;
+                if(board.game_state.b_game_over && record_path != NULL && !b_resumed) {
+                    finish_replay(&replay, &board.game_state);
+                    if(!save_replay(&replay, record_path)) {
+                        perror(record_path);
                     }
                 }
-            }
-            decrement_piece_position_x(game_state);
-        }
-    } else if(IsKeyDown(KEY_RIGHT)) {
-        for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                if(grid[i][j] == MOVING) {
-                    if(j == GRID_X_SIZE - 2 || grid[i][j + 1] >= FULL) {
-                        collision = true;
+            } else { // game over
+                if(IsKeyPressed(KEY_ENTER)) { // restart
+                    ++seed;
+                    init_game(&board, seed);
+                    free_replay(&replay);
+                    init_replay(&replay, seed, width, height, board.dig_rows);
+                    reset_finesse(&finesse);
+                    current_level = 1;
+                    tick = 0;
+                    b_resumed = false;
+                    set_game_over(&board.game_state, false);
+                    set_begin_game(&board.game_state , true);
+                    if(autosave_path != NULL) {
+                        mark_journal_reset(&journal, &board, seed, tick);
                     }
                 }
             }
+            draw_map(&layout, &board, &visible, 1, &finesse);
         }
+    }
 
-        if(!collision) {
-            for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-                for(int j = GRID_X_SIZE - 2; j >= 1; --j) {
-                    if(grid[i][j] == MOVING) {
-                        grid[i][j + 1] = MOVING;
-                        grid[i][j] = EMPTY;
-                    }
-                }
-            }
-            increment_piece_position_x(game_state);
-        }
+    CloseWindow();
+    if(metrics_path != NULL) {
+        free_telemetry(&telemetry);
     }
+    if(publish_name != NULL) {
+        close_spectator(&spectator);
+    }
+    if(autosave_path != NULL) {
+        free_journal(&journal);
+    }
+    free_finesse(&finesse);
+    free_replay(&replay);
+    free_board(&board);
 
-    return collision;
+    return 0;
 }
 
-static bool resolve_turn_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t piece[4][4], game_state_t* game_state) {
-    if(IsKeyDown(KEY_UP)) {
-        grid_square_t temp;
-        bool checker = false;
-
-        if(grid[game_state->piece_position_y][game_state->piece_position_x + 3] == MOVING &&
-            (grid[game_state->piece_position_y][game_state->piece_position_x] != EMPTY &&
-            grid[game_state->piece_position_y][game_state->piece_position_x] != MOVING)) {
-            checker = true;
-        }
+// plays a recorded game in the window, or renders every tick offscreen and hands the frames to the exporter
+static int run_replay(const char* replay_path, const char* export_path, export_format_t format, int worker_count) {
+    board_t board;
+    replay_t replay;
+    const int visible = 0;
+    int current_level = 1;
 
-        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] == MOVING &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 3] != EMPTY &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 3] != MOVING) {
-            checker = true;
-        }
+    if(!load_replay(&replay, replay_path)) {
+        fprintf(stderr, "tetris: cannot read replay %s\n", replay_path);
+        return 1;
+    }
+    if(!create_board(&board, replay.width, replay.height)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_replay(&replay);
+        return 1;
+    }
 
-        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x] == MOVING &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] != EMPTY &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 3] != MOVING) {
-            checker = true;
-        }
+    const layout_t layout = get_layout(replay.width, replay.height);
+    set_dig_rows(&board, replay.dig_rows);
+    init_board(&board, replay.seed);
+    set_begin_game(&board.game_state, true);
 
-        if(grid[game_state->piece_position_y][game_state->piece_position_x] == MOVING &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x] != EMPTY &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x] != MOVING) {
-            checker = true;
-        }
+    if(export_path == NULL) {
+        InitWindow(layout.screen_width, layout.screen_height, "tetris replay");
+        SetTargetFPS(BASE_FPS);
 
-        if(grid[game_state->piece_position_y][game_state->piece_position_x + 1] == MOVING &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x] != EMPTY &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x] != MOVING) {
-            checker = true;
+        for(int tick = 0; !WindowShouldClose(); ++tick) {
+            if(tick < replay.tick_count) {
+                step_board(&board, replay.inputs[tick]);
+                resolve_frame_rate(&board.game_state, &current_level);
+            }
+            draw_map(&layout, &board, &visible, 1, NULL);
         }
 
-        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] == MOVING &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 1] != EMPTY &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 1] != MOVING) {
-            checker = true;
-        }
+        CloseWindow();
+        free_replay(&replay);
+        free_board(&board);
+        return 0;
+    }
 
-        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] == MOVING &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] != EMPTY &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 3] != MOVING) {
-            checker = true;
-        }
+    frame_exporter_t exporter;
+    if(!init_frame_exporter(&exporter, format, export_path, layout.screen_width, layout.screen_height, worker_count)) {
+        perror(export_path);
+        free_replay(&replay);
+        free_board(&board);
+        return 1;
+    }
 
-        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x] == MOVING &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] != EMPTY &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 2] != MOVING) {
-            checker = true;
+    // 창은 GL context 때문에만 필요함. 보이지 않고 vsync 도 없음
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(layout.screen_width, layout.screen_height, "tetris export");
+    RenderTexture2D target = LoadRenderTexture(layout.screen_width, layout.screen_height);
+
+    bool b_read = true;
+    for(int tick = 0; tick < replay.tick_count && b_read; ++tick) {
+        step_board(&board, replay.inputs[tick]);
+
+        BeginTextureMode(target);
+        render_map(&layout, &board, &visible, 1, NULL);
+        EndTextureMode();
+
+        // raylib 은 자기가 할당한 buffer 로만 읽어줌. exporter 의 buffer 로 복사하고 바로 돌려줌
+        unsigned char* pixels = rlReadTexturePixels(target.texture.id, layout.screen_width, layout.screen_height, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        b_read = pixels != NULL;
+        if(b_read) {
+            push_frame(&exporter, pixels);
+            MemFree(pixels);
         }
+    }
 
-        if(grid[game_state->piece_position_y][game_state->piece_position_x + 2] == MOVING &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x] != EMPTY &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x] != MOVING) {
-            checker = true;
-        }
+    UnloadRenderTexture(target);
+    CloseWindow();
 
-        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] == MOVING &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 2] != EMPTY &&
-            grid[game_state->piece_position_y][game_state->piece_position_x + 2] != MOVING) {
-            checker = true;
-        }
+    const bool b_ok = free_frame_exporter(&exporter) && b_read;
+    free_replay(&replay);
+    free_board(&board);
+    if(!b_ok) {
+        fprintf(stderr, "tetris: writing frames to %s failed\n", export_path);
+        return 1;
+    }
 
-        if(grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] == MOVING &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] != EMPTY &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 3] != MOVING) {
-            checker = true;
-        }
+    return 0;
+}
 
-        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x] == MOVING &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] != EMPTY &&
-            grid[game_state->piece_position_y + 3][game_state->piece_position_x + 1] != MOVING) {
-            checker = true;
-        }
+// no window: the game is played as fast as it goes and checked against the result stored in the file.
+// this is also the workload the release build is trained on
+static int run_headless_replay(const char* replay_path) {
+    board_t board;
+    replay_t replay;
 
-        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] == MOVING &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 1] != EMPTY &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 1] != MOVING) {
-            checker = true;
-        }
+    if(!load_replay(&replay, replay_path)) {
+        fprintf(stderr, "tetris: cannot read replay %s\n", replay_path);
+        return 1;
+    }
+    if(!create_board(&board, replay.width, replay.height)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_replay(&replay);
+        return 1;
+    }
 
-        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] == MOVING &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] != EMPTY &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 1] != MOVING) {
-            checker = true;
-        }
+    const bool b_same = play_replay(&replay, &board);
+    printf("%s: board %dx%d, ticks: %d, lines: %d, level: %d, pieces: %d%s\n", replay_path, replay.width, replay.height, replay.tick_count,
+        board.game_state.g_lines, board.game_state.g_level, board.game_state.g_pieces, b_same ? "" : ", recorded game ended differently");
 
-        if(grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] == MOVING &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] != EMPTY &&
-            grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] != MOVING) {
-            checker = true;
-        }
+    free_replay(&replay);
+    free_board(&board);
 
-        if(grid[game_state->piece_position_y + 1][game_state->piece_position_x + 2] == MOVING &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] != EMPTY &&
-            grid[game_state->piece_position_y + 2][game_state->piece_position_x + 2] != MOVING) {
-            checker = true;
-        }
-
-        if(!checker) {
-            temp = piece[0][0];
-            piece[0][0] = piece[0][3];
-            piece[0][3] = piece[3][3];
-            piece[3][3] = piece[3][0];
-            piece[3][0] = temp;
+    return b_same ? 0 : 1;
+}
 
-            temp = piece[0][1];
-            piece[0][1] = piece[1][3];
-            piece[1][3] = piece[3][2];
-            piece[3][2] = piece[2][0];
-            piece[2][0] = temp;
+// bot boards only. headless runs unthrottled and prints the result, otherwise the first boards are tiled on screen
+static int run_versus(int board_count, int thread_count, unsigned int seed, int width, int height, display_mode_t display_mode, long tick_limit, int fps, const char* publish_name) {
+    thread_pool_t pool;
+    versus_t versus;
+    spectator_t spectator;
+    bot_t* bots = calloc(board_count, sizeof(bot_t));
+    int visible[VERSUS_MAX_VISIBLE_BOARDS];
+    int visible_count = board_count < VERSUS_MAX_VISIBLE_BOARDS ? board_count : VERSUS_MAX_VISIBLE_BOARDS;
+    struct timespec begin;
+    struct timespec end;
+
+    if(bots == NULL || !init_thread_pool(&pool, thread_count)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free(bots);
+        return 1;
+    }
+    bool b_bots = true;
+    for(int i = 0; i < board_count; ++i) {
+        b_bots = init_bot(&bots[i], width, height) && b_bots;
+    }
+    if(!b_bots || !init_versus(&versus, board_count, width, height, seed, &pool, get_bot_input_for_board, bots)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_thread_pool(&pool);
+        free_bots(bots, board_count);
+        return 1;
+    }
+    for(int i = 0; i < visible_count; ++i) {
+        visible[i] = i;
+    }
+    if(publish_name != NULL && !open_spectator_publisher(&spectator, publish_name, width, height)) {
+        perror(publish_name);
+        publish_name = NULL;
+    }
 
-            temp = piece[0][2];
-            piece[0][2] = piece[2][3];
-            piece[2][3] = piece[3][1];
-            piece[3][1] = piece[1][0];
-            piece[1][0] = temp;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
 
-            temp = piece[1][1];
-            piece[1][1] = piece[1][2];
-            piece[1][2] = piece[2][2];
-            piece[2][2] = piece[2][1];
-            piece[2][1] = temp;
+    if(display_mode == DISPLAY_NONE) {
+        while(!is_versus_over(&versus) && (tick_limit <= 0 || versus.ticks < tick_limit)) {
+            step_versus(&versus);
+            if(publish_name != NULL) {
+                publish_spectator_frame(&spectator, &versus.boards[0]);
+            }
+        }
+    } else if(display_mode == DISPLAY_TERMINAL) {
+        term_screen_t screen;
+        int screen_width;
+        int screen_height;
+        struct timespec next_frame = begin;
+
+        if(visible_count > TERM_MAX_BOARDS) {
+            visible_count = TERM_MAX_BOARDS;
+        }
+        get_term_map_size(&versus.boards[0], visible_count, &screen_width, &screen_height);
+        if(!init_term_screen(&screen, STDOUT_FILENO, screen_width, screen_height)) {
+            fprintf(stderr, "tetris: out of memory\n");
+            if(publish_name != NULL) {
+                close_spectator(&spectator);
+            }
+            free_versus(&versus);
+            free_thread_pool(&pool);
+            free_bots(bots, board_count);
+            return 1;
         }
 
-        for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                if(grid[i][j] == MOVING) {
-                    grid[i][j] = EMPTY;
-                }
+        while(!is_versus_over(&versus) && (tick_limit <= 0 || versus.ticks < tick_limit)) {
+            step_versus(&versus);
+            if(publish_name != NULL) {
+                publish_spectator_frame(&spectator, &versus.boards[0]);
             }
+            draw_term_map(&screen, versus.boards, visible, visible_count);
+            present_term_screen(&screen);
+
+            wait_next_frame(&next_frame, fps);
         }
 
-        for(int i = game_state->piece_position_y; i < game_state->piece_position_y + 4; ++i) {
-            for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
-                if(piece[i - game_state->piece_position_y][j - game_state->piece_position_x] == MOVING) {
-                    grid[i][j] = MOVING;
+        free_term_screen(&screen);
+    } else {
+        const layout_t layout = get_layout(width, height);
+
+        InitWindow(layout.screen_width, layout.screen_height, "tetris versus");
+        SetTargetFPS(BASE_FPS);
+
+        while(!WindowShouldClose()) {
+            if(!is_versus_over(&versus) && (tick_limit <= 0 || versus.ticks < tick_limit)) {
+                step_versus(&versus);
+                if(publish_name != NULL) {
+                    publish_spectator_frame(&spectator, &versus.boards[0]);
                 }
             }
+            draw_map(&layout, versus.boards, visible, visible_count, NULL);
         }
 
-        return true;
+        CloseWindow();
     }
 
-    return false;
-}
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if(publish_name != NULL) {
+        close_spectator(&spectator);
+    }
 
-static int delete_complete_lines(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE]) {
-    int deleted_lines = 0;
+    if(display_mode != DISPLAY_WINDOW) {
+        const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1.0e9;
 
-    for(int i = GRID_Y_SIZE - 2; i >= 0; --i) {
-        while(grid[i][1] == FADING) {
-            for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-                grid[i][j] = EMPTY;
-            }
+        printf("winner: %d\n", get_versus_winner(&versus));
+        printf("ticks: %ld\n", versus.ticks);
+        for(int i = 0; i < board_count; ++i) {
+            printf("board %d: place %d, lines %d, pieces %d\n", i, versus.placement[i], versus.boards[i].game_state.g_lines, versus.boards[i].game_state.g_pieces);
+        }
+        printf("%.0f ticks/s, %.0f board ticks/s on %d threads\n", versus.ticks / seconds, versus.ticks * (double)board_count / seconds, thread_count);
+    }
 
-            for(int k = i - 1; k >= 0; --k) {
-                for(int l = 1; l < GRID_X_SIZE - 1; ++l) {
-                    if(grid[k][l] >= FULL) {
-                        grid[k + 1][l] = grid[k][l];
-                        grid[k][l] = EMPTY;
-                    } else if(grid[k][l] == FADING) {
-                        grid[k + 1][l] = FADING;
-                        grid[k][l] = EMPTY;
-                    }
-                }
-            }
+    free_versus(&versus);
+    free_thread_pool(&pool);
+    free_bots(bots, board_count);
+
+    return 0;
+}
+
+// one board here and one in the peer process, over UDP. the window plays the keyboard unless b_bot, terminal and
+// headless play the bot. every mode runs at fps, because the peer and the simulated delay run on the clock
+static int run_netplay(int port, const char* peer, int delay_ms, int loss_percent, bool b_bot, unsigned int seed, int width, int height, display_mode_t display_mode, long tick_limit, int fps) {
+    netplay_t netplay;
+    bot_t bot;
+    term_screen_t screen;
+    input_t input = { 0, 0 };
+    unsigned char pressed = 0; // 기다리는 frame 에 눌린 키는 다음 tick 으로 넘김
+    const int visible[2] = { 0, 1 };
+    struct timespec next_frame;
+    bool b_quit = false;
+
+    if(!init_bot(&bot, width, height)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        free_bot(&bot);
+        return 1;
+    }
+    if(!init_netplay(&netplay, port, peer, seed, width, height, tick_limit, delay_ms, loss_percent)) {
+        fprintf(stderr, "tetris: cannot use port %d to reach %s\n", port, peer);
+        free_bot(&bot);
+        return 1;
+    }
+
+    if(display_mode == DISPLAY_TERMINAL) {
+        int screen_width;
+        int screen_height;
 
-            ++deleted_lines;
+        get_term_map_size(get_netplay_board(&netplay, 0), 2, &screen_width, &screen_height);
+        if(!init_term_screen(&screen, STDOUT_FILENO, screen_width, screen_height)) {
+            fprintf(stderr, "tetris: out of memory\n");
+            free_netplay(&netplay);
+            free_bot(&bot);
+            return 1;
         }
     }
 
-    return deleted_lines;
-}
+    const layout_t layout = get_layout(width, height);
+    if(display_mode == DISPLAY_WINDOW) {
+        InitWindow(layout.screen_width, layout.screen_height, "tetris netplay");
+        SetTargetFPS(fps > 0 ? fps : BASE_FPS);
+    } else {
+        b_bot = true;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &next_frame);
 
-static void check_completion(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state) {
-    int calculator;
+    while(!is_netplay_done(&netplay)) {
+        if(display_mode == DISPLAY_WINDOW && WindowShouldClose()) {
+            quit_netplay(&netplay);
+            b_quit = true;
+            break;
+        }
 
-    for(int i = GRID_Y_SIZE - 2; i >= 0 ; --i) {
-        calculator = 0;
-        for(int j = 1; j < GRID_X_SIZE - 1; ++j) {
-            if(grid[i][j] >= FULL) {
-                ++calculator;
+        poll_netplay(&netplay);
+        if(!b_bot) {
+            read_keyboard(&input);
+            pressed |= input.pressed;
+        }
+        if(can_step_netplay(&netplay)) {
+            if(b_bot) {
+                get_bot_input(&bot, get_netplay_board(&netplay, netplay.side), &input);
+            } else {
+                input.pressed = pressed;
+                pressed = 0;
             }
+        }
+        advance_netplay(&netplay, input);
 
-            if(calculator == GRID_X_SIZE - 2) {
-                set_line_to_delete(game_state, true);
-                calculator = 0;
-
-                for(int z = 1; z < GRID_X_SIZE - 1; ++z) {
-                    grid[i][z] = FADING;
-                }
+        if(display_mode == DISPLAY_WINDOW) {
+            draw_map(&layout, netplay.versus.boards, visible, 2, NULL);
+        } else {
+            if(display_mode == DISPLAY_TERMINAL) {
+                draw_term_map(&screen, netplay.versus.boards, visible, 2);
+                present_term_screen(&screen);
             }
+            wait_next_frame(&next_frame, fps);
         }
     }
-}
-
-static bool create_piece(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, Color* current_piece_color, Color* incoming_piece_color) {
-    int piece_num;
-    set_piece_position_x(game_state, (int)((GRID_X_SIZE - 4) / 2));
-    set_piece_position_y(game_state, 0);
-    bool b_collision = false;
 
-    if(game_state->b_begin_play) { // first block creation
-        piece_num = get_random_piece(incoming_piece);
-        set_current_piece_num(game_state, piece_num);
-        set_begin_play(game_state, false);
+    // 끝난 판은 창을 닫을 때까지 보여줌
+    if(display_mode == DISPLAY_WINDOW) {
+        while(!b_quit && !WindowShouldClose()) {
+            draw_map(&layout, netplay.versus.boards, visible, 2, NULL);
+        }
+        CloseWindow();
+    } else if(display_mode == DISPLAY_TERMINAL) {
+        free_term_screen(&screen);
     }
 
-    for(int i = 0; i < 4; ++i) {
-        for(int j = 0; j < 4; ++j) {
-            piece[i][j] = incoming_piece[i][j];
-        }
+    const netplay_stats_t* stats = &netplay.stats;
+    const long frames = stats->frames > 0 ? stats->frames : 1;
+    const long rollbacks = stats->rollbacks > 0 ? stats->rollbacks : 1;
+    const long resimulated_ticks = stats->resimulated_ticks > 0 ? stats->resimulated_ticks : 1;
+    const long ticks = netplay.versus.ticks > 0 ? netplay.versus.ticks : 1;
+
+    printf("netplay: %s, side %d, seed %u, %ld ticks in %ld frames\n", b_quit ? "quit" : get_netplay_status_name(netplay.status), netplay.side, netplay.seed, netplay.versus.ticks, stats->frames);
+    printf("winner: %d\n", get_versus_winner(&netplay.versus));
+    for(int i = 0; i < 2; ++i) {
+        const board_t* board = get_netplay_board(&netplay, i);
+        printf("board %d%s: place %d, lines %d, pieces %d\n", i, i == netplay.side ? " (here)" : "", netplay.versus.placement[i], board->game_state.g_lines, board->game_state.g_pieces);
     }
+    printf("rollbacks: %ld in %.1f%% of frames, %.1f ticks avg, %d max\n", stats->rollbacks, 100.0 * stats->rollbacks / frames, stats->resimulated_ticks / (double)rollbacks, stats->max_resimulated_ticks);
+    printf("resimulation: %.2f us per frame avg, %.1f us per rollback avg, %.1f us max, %.2f us per tick; step %.2f us per tick\n",
+        stats->resimulation_us / frames, stats->resimulation_us / rollbacks, stats->max_resimulation_us, stats->resimulation_us / resimulated_ticks, stats->step_us / ticks);
+    printf("waiting: %ld frames for input, %ld frames to stay in sync\n", stats->stall_frames, stats->sync_frames);
+    printf("packets: %ld sent, %ld dropped, %ld received, %ld checksums matched\n", stats->packets_sent, stats->packets_dropped, stats->packets_received, stats->checksums);
 
-    *current_piece_color = get_piece_color(game_state->current_piece_num);
-    set_finished_piece_num(game_state, game_state->current_piece_num);
+    const bool b_finished = b_quit || netplay.status == NETPLAY_FINISHED;
+    free_netplay(&netplay);
+    free_bot(&bot);
 
-    // assign next random piece
-    piece_num = get_random_piece(incoming_piece);
-    set_current_piece_num(game_state, piece_num);
-    *incoming_piece_color = get_piece_color(piece_num);
+    return b_finished ? 0 : 1;
+}
 
-    for(int i = 0; i < 4; ++i) {
-        for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
-            if(grid[i][j] != EMPTY && piece[i][j - game_state->piece_position_x] == MOVING) {
-                b_collision = true;
-            }
-        }
+// attaches to a game started with --publish NAME and shows every tick it publishes until it ends.
+// headless only counts what it received, which is what a recorder would see
+static int run_spectator(const char* name, display_mode_t display_mode, int fps) {
+    spectator_t spectator;
+    board_t board;
+    const int visible = 0;
+    long frames = 0;
+
+    if(!open_spectator_viewer(&spectator, name)) {
+        fprintf(stderr, "tetris: no game is publishing %s\n", name);
+        return 1;
+    }
+    if(!create_board(&board, spectator.header->width, spectator.header->height)) {
+        fprintf(stderr, "tetris: out of memory\n");
+        close_spectator(&spectator);
+        return 1;
     }
+    init_board(&board, 0);
 
-    if(!b_collision) {
-        for(int i = 0; i < 4; ++i) {
-            for(int j = game_state->piece_position_x; j < game_state->piece_position_x + 4; ++j) {
-                if(piece[i][j - game_state->piece_position_x] == MOVING) {
-                    grid[i][j] = MOVING;
-                }
+    const struct timespec frame_time = { 0, fps > 0 ? 1000000000L / fps : 0 };
+
+    if(display_mode == DISPLAY_NONE) {
+        spectator_read_t read;
+        while((read = read_spectator_frame(&spectator, &board)) != SPECTATOR_CLOSED) {
+            if(read == SPECTATOR_NEW_FRAME) {
+                ++frames;
+            } else {
+                nanosleep(&frame_time, NULL);
             }
         }
+        printf("frames: %ld of %u, lines: %d, level: %d, pieces: %d\n", frames, spectator.header->frame_count, board.game_state.g_lines, board.game_state.g_level, board.game_state.g_pieces);
+    } else if(display_mode == DISPLAY_TERMINAL) {
+        term_screen_t screen;
+        int screen_width;
+        int screen_height;
+
+        get_term_map_size(&board, 1, &screen_width, &screen_height);
+        if(!init_term_screen(&screen, STDOUT_FILENO, screen_width, screen_height)) {
+            fprintf(stderr, "tetris: out of memory\n");
+            close_spectator(&spectator);
+            free_board(&board);
+            return 1;
+        }
+
+        while(read_spectator_frame(&spectator, &board) != SPECTATOR_CLOSED) {
+            draw_term_map(&screen, &board, &visible, 1);
+            present_term_screen(&screen);
+            nanosleep(&frame_time, NULL);
+        }
+
+        free_term_screen(&screen);
     } else {
-        set_game_over(game_state, true);
-    }
+        const layout_t layout = get_layout(board.width, board.height);
 
-    return true;
-}
+        InitWindow(layout.screen_width, layout.screen_height, "tetris spectator");
+        SetTargetFPS(fps);
 
-// generate block randomly
-static int get_random_piece(grid_square_t incoming_piece[4][4]) {
-    const int random = GetRandomValue(0, 6);
-    for(int i = 0; i < 4; ++i) { // clean array
-        for(int j = 0; j < 4; ++j) {
-            incoming_piece[i][j] = EMPTY;
+        while(!WindowShouldClose() && read_spectator_frame(&spectator, &board) != SPECTATOR_CLOSED) {
+            draw_map(&layout, &board, &visible, 1, NULL);
         }
-    }
 
-    switch(random) {
-        case 0: // cube
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[1][2] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            incoming_piece[2][2] = MOVING;
-            break;
-        case 1: // L
-            incoming_piece[0][1] = MOVING;
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            incoming_piece[2][2] = MOVING;
-            break;
-        case 2: // J
-            incoming_piece[0][2] = MOVING;
-            incoming_piece[1][2] = MOVING;
-            incoming_piece[2][2] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            break;
-        case 3: // I
-            incoming_piece[0][1] = MOVING;
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            incoming_piece[3][1] = MOVING;
-            break;
-        case 4: // T
-            incoming_piece[0][1] = MOVING;
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            incoming_piece[1][2] = MOVING;
-            break;
-        case 5: // S
-            incoming_piece[0][1] = MOVING;
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[1][2] = MOVING;
-            incoming_piece[2][2] = MOVING;
-            break;
-        case 6: // Z
-            incoming_piece[0][2] = MOVING;
-            incoming_piece[1][1] = MOVING;
-            incoming_piece[1][2] = MOVING;
-            incoming_piece[2][1] = MOVING;
-            break;
-        default:
-            assert(0);
-            break;
+        CloseWindow();
     }
 
-    return random;
+    close_spectator(&spectator);
+    free_board(&board);
+
+    return 0;
 }
 
 // assign a certain color for a certain shape
@@ -799,6 +1006,9 @@ static Color get_piece_color(const int num) {
         case 6: // Z
             piece_color = MAROON;
             break;
+        case 7: // garbage
+            piece_color = BROWN;
+            break;
         default:
             assert(0);
             break;
@@ -807,40 +1017,267 @@ static Color get_piece_color(const int num) {
     return piece_color;
 }
 
-int main(void) {
-    game_state_t game_state;
-    counter_t counter;
-    grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE]; // tetris map
-    grid_square_t incoming_piece[4][4]; // next block
-    grid_square_t hold_piece[4][4]; // hold block
-    grid_square_t piece[4][4]; // generated block
-    Color current_piece_color;
-    Color incoming_piece_color;
-    Color hold_piece_color;
-
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "tetris");
-    init_game(grid, incoming_piece, hold_piece, piece, &game_state, &counter);
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "usage: %s [--seed S] [--record FILE] [--metrics FILE] [--publish NAME] [--autosave PATH] [--dig ROWS] [--width W] [--height H]\n"
+        "       %s --versus N [--threads T] [--ticks T] [--headless | --term [--fps F]] [--publish NAME] [--seed S] [--width W] [--height H]\n"
+        "       %s --netplay PORT HOST:PORT [--net-delay MS] [--net-loss PERCENT] [--net-bot] [--headless | --term] [--fps F] [--ticks T] [--seed S] [--width W] [--height H]\n"
+        "       %s --spectate NAME [--headless | --term] [--fps F]\n"
+        "       %s --bot-server [--socket PATH] [--seed S] [--width W] [--height H]\n"
+        "       %s --replay FILE [--headless | --export PATH [--format raw|png] [--threads T]]\n"
+        "       %s --autoplay GAMES [--dataset FILE] [--archive DIR] [--book FILE] [--dig ROWS] [--threads T] [--ticks T] [--seed S] [--width W] [--height H]\n"
+        "       %s --dataset-info FILE\n"
+        "       %s --archive DIR (--top N [--by lines|level|ticks|seed] | --find-seed S | --extract ID FILE)\n"
+        "       %s --perfect-clear PIECES [--positions N] [--threads T] [--seed S]\n"
+        "       %s --check-engine GAMES [--ticks T] [--threads T] [--seed S] [--record FILE] [--width W] [--height H]\n"
+        "       %s --mcts GAMES [--iterations N] [--gravity G] [--threads T] [--ticks T] [--seed S] [--width W] [--height H]\n"
+        "       %s --tournament FILE [--mode versus|score] [--pairing round-robin|swiss] [--games N] [--threads P] [--ticks T] [--seed S] [--width W] [--height H]\n"
+        "       %s --analyze FILE [--top N] [--threads T] [--width W] [--height H]\n"
+        "       %s --build-book FILE [--book-depth D] [--threads T] [--width W] [--height H]\n"
+        "board: width %d to %d, height %d to %d, %dx%d when not given\n",
+        program, program, program, program, program, program, program, program, program, program, program, program, program, program, program,
+        BOARD_MIN_WIDTH, BOARD_MAX_WIDTH, BOARD_MIN_HEIGHT, BOARD_MAX_HEIGHT, BOARD_DEFAULT_WIDTH, BOARD_DEFAULT_HEIGHT);
+}
 
-    // main game loop
-    while (!WindowShouldClose()) {
-        if(!game_state.b_begin_game) {
-            draw_init_page();
-            check_game_start(&game_state);
+int main(int argc, char* argv[]) {
+    const char* socket_path = NULL;
+    const char* record_path = NULL;
+    const char* metrics_path = NULL;
+    const char* publish_name = NULL;
+    const char* autosave_path = NULL;
+    const char* spectate_name = NULL;
+    const char* netplay_peer = NULL;
+    int netplay_port = 0;
+    int net_delay = 0;
+    int net_loss = 0;
+    bool b_net_bot = false;
+    const char* replay_path = NULL;
+    const char* export_path = NULL;
+    const char* dataset_path = NULL;
+    const char* dataset_info_path = NULL;
+    const char* archive_path = NULL;
+    const char* extract_path = NULL;
+    archive_key_t archive_key = ARCHIVE_KEY_LINES;
+    int top_count = 0;
+    long find_seed = -1;
+    long extract_id = -1;
+    int game_count = 0;
+    int solver_pieces = 0;
+    int position_count = 1;
+    long check_count = 0;
+    int mcts_count = 0;
+    int mcts_iterations = MCTS_DEFAULT_ITERATIONS;
+    int gravity = MCTS_DEFAULT_GRAVITY;
+    const char* tournament_path = NULL;
+    tournament_mode_t tournament_mode = TOURNAMENT_VERSUS;
+    tournament_pairing_t tournament_pairing = TOURNAMENT_ROUND_ROBIN;
+    int tournament_games = TOURNAMENT_DEFAULT_GAMES;
+    const char* book_path = NULL;
+    const char* build_book_path = NULL;
+    const char* analysis_path = NULL;
+    int book_depth = BOOK_DEFAULT_DEPTH;
+    export_format_t export_format = EXPORT_RAW;
+    bool b_bot_server = false;
+    int board_count = 0;
+    int board_width = BOARD_DEFAULT_WIDTH;
+    int board_height = BOARD_DEFAULT_HEIGHT;
+    int dig_rows = 0;
+    int thread_count = get_cpu_count();
+    unsigned int seed = (unsigned int)time(NULL);
+    long tick_limit = 0;
+    int fps = BASE_FPS;
+    display_mode_t display_mode = DISPLAY_WINDOW;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--versus") == 0 && i + 1 < argc) {
+            board_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            tick_limit = atol(argv[++i]);
+        } else if(strcmp(argv[i], "--headless") == 0) {
+            display_mode = DISPLAY_NONE;
+        } else if(strcmp(argv[i], "--term") == 0) {
+            display_mode = DISPLAY_TERMINAL;
+        } else if(strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--bot-server") == 0) {
+            b_bot_server = true;
+        } else if(strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if(strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if(strcmp(argv[i], "--autosave") == 0 && i + 1 < argc) {
+            autosave_path = argv[++i];
+        } else if(strcmp(argv[i], "--publish") == 0 && i + 1 < argc) {
+            publish_name = argv[++i];
+        } else if(strcmp(argv[i], "--netplay") == 0 && i + 2 < argc) {
+            netplay_port = atoi(argv[++i]);
+            netplay_peer = argv[++i];
+        } else if(strcmp(argv[i], "--net-delay") == 0 && i + 1 < argc) {
+            net_delay = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--net-loss") == 0 && i + 1 < argc) {
+            net_loss = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--net-bot") == 0) {
+            b_net_bot = true;
+        } else if(strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+            spectate_name = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if(strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        } else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc && strcmp(argv[i + 1], "raw") == 0) {
+            export_format = EXPORT_RAW;
+            ++i;
+        } else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc && strcmp(argv[i + 1], "png") == 0) {
+            export_format = EXPORT_PNG;
+            ++i;
+        } else if(strcmp(argv[i], "--autoplay") == 0 && i + 1 < argc) {
+            game_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--dataset") == 0 && i + 1 < argc) {
+            dataset_path = argv[++i];
+        } else if(strcmp(argv[i], "--dataset-info") == 0 && i + 1 < argc) {
+            dataset_info_path = argv[++i];
+        } else if(strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+            archive_path = argv[++i];
+        } else if(strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--by") == 0 && i + 1 < argc && parse_archive_key(argv[i + 1], &archive_key)) {
+            ++i;
+        } else if(strcmp(argv[i], "--find-seed") == 0 && i + 1 < argc) {
+            find_seed = (long)strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--extract") == 0 && i + 2 < argc) {
+            extract_id = atol(argv[++i]);
+            extract_path = argv[++i];
+        } else if(strcmp(argv[i], "--perfect-clear") == 0 && i + 1 < argc) {
+            solver_pieces = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--positions") == 0 && i + 1 < argc) {
+            position_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--check-engine") == 0 && i + 1 < argc) {
+            check_count = atol(argv[++i]);
+        } else if(strcmp(argv[i], "--mcts") == 0 && i + 1 < argc) {
+            mcts_count = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            mcts_iterations = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--gravity") == 0 && i + 1 < argc) {
+            gravity = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--tournament") == 0 && i + 1 < argc) {
+            tournament_path = argv[++i];
+        } else if(strcmp(argv[i], "--mode") == 0 && i + 1 < argc && parse_tournament_mode(argv[i + 1], &tournament_mode)) {
+            ++i;
+        } else if(strcmp(argv[i], "--pairing") == 0 && i + 1 < argc && parse_tournament_pairing(argv[i + 1], &tournament_pairing)) {
+            ++i;
+        } else if(strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            tournament_games = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--analyze") == 0 && i + 1 < argc) {
+            analysis_path = argv[++i];
+        } else if(strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+            book_path = argv[++i];
+        } else if(strcmp(argv[i], "--build-book") == 0 && i + 1 < argc) {
+            build_book_path = argv[++i];
+        } else if(strcmp(argv[i], "--book-depth") == 0 && i + 1 < argc) {
+            book_depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--dig") == 0 && i + 1 < argc) {
+            dig_rows = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            board_width = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            board_height = atoi(argv[++i]);
         } else {
-            if(!game_state.b_game_over) {
-                update_draw_frame(grid, incoming_piece, piece, &game_state, &counter, &current_piece_color, &incoming_piece_color);
-            } else { // game over
-                if(IsKeyPressed(KEY_ENTER)) { // restart
-                    init_game(grid, incoming_piece, hold_piece, piece, &game_state, &counter);
-                    set_game_over(&game_state, false);
-                    set_begin_game(&game_state , true);
-                }
-            }
-            draw_map(grid, incoming_piece, hold_piece, &game_state, &current_piece_color, &incoming_piece_color, &hold_piece_color, &counter);
+            print_usage(argv[0]);
+            return 1;
         }
     }
 
-    CloseWindow();
+    if(!is_board_size_valid(board_width, board_height) || thread_count < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if(dig_rows < 0 || dig_rows > board_height - DIG_FREE_ROWS) {
+        fprintf(stderr, "tetris: --dig takes 0 to %d rows on this board\n", board_height - DIG_FREE_ROWS);
+        return 1;
+    }
 
-    return 0;
+    if(b_bot_server) {
+        return run_bot_server(socket_path, seed, board_width, board_height);
+    }
+
+    if(spectate_name != NULL) {
+        return run_spectator(spectate_name, display_mode, fps);
+    }
+
+    if(netplay_peer != NULL) {
+        if(netplay_port <= 0 || netplay_port > 65535 || net_delay < 0 || net_delay > NETPLAY_MAX_DELAY_MS || net_loss < 0 || net_loss > 100) {
+            fprintf(stderr, "tetris: --netplay takes a port 1 to 65535, --net-delay 0 to %d ms and --net-loss 0 to 100 percent\n", NETPLAY_MAX_DELAY_MS);
+            return 1;
+        }
+        return run_netplay(netplay_port, netplay_peer, net_delay, net_loss, b_net_bot, seed, board_width, board_height, display_mode, tick_limit, fps);
+    }
+
+    if(dataset_info_path != NULL) {
+        return run_dataset_info(dataset_info_path);
+    }
+
+    if(check_count > 0) {
+        return run_engine_check(check_count, seed, thread_count, tick_limit, board_width, board_height, record_path);
+    }
+
+    if(solver_pieces > 0) {
+        return run_perfect_clear(solver_pieces, seed, position_count, thread_count);
+    }
+
+    if(tournament_path != NULL) {
+        return run_tournament(tournament_path, tournament_mode, tournament_pairing, tournament_games, thread_count, seed, tick_limit, board_width, board_height);
+    }
+
+    if(analysis_path != NULL) {
+        return run_analysis(analysis_path, top_count > 0 ? top_count : ANALYSIS_DEFAULT_TOP, thread_count, board_width, board_height);
+    }
+
+    if(build_book_path != NULL) {
+        return run_build_book(build_book_path, book_depth, thread_count, board_width, board_height);
+    }
+
+    if(mcts_count > 0) {
+        return run_mcts_comparison(mcts_count, seed, thread_count, tick_limit, board_width, board_height, mcts_iterations, gravity);
+    }
+
+    if(game_count > 0) {
+        return run_autoplay(game_count, seed, thread_count, tick_limit, board_width, board_height, dataset_path, archive_path, book_path, dig_rows);
+    }
+
+    if(archive_path != NULL) {
+        if(top_count > 0) {
+            return run_archive_top(archive_path, archive_key, top_count);
+        } else if(find_seed >= 0) {
+            return run_archive_find_seed(archive_path, (uint32_t)find_seed);
+        } else if(extract_id >= 0) {
+            return run_archive_extract(archive_path, (uint32_t)extract_id, extract_path);
+        }
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if(replay_path != NULL && display_mode == DISPLAY_NONE) {
+        return run_headless_replay(replay_path);
+    }
+
+    if(replay_path != NULL) {
+        return run_replay(replay_path, export_path, export_format, thread_count);
+    }
+
+    if(board_count == 0) {
+        return run_single_player(seed, board_width, board_height, dig_rows, record_path, metrics_path, publish_name, autosave_path);
+    }
+
+    if(board_count < VERSUS_MIN_BOARDS || board_count > VERSUS_MAX_BOARDS) {
+        fprintf(stderr, "tetris: --versus takes %d to %d boards\n", VERSUS_MIN_BOARDS, VERSUS_MAX_BOARDS);
+        return 1;
+    }
+
+    return run_versus(board_count, thread_count, seed, board_width, board_height, display_mode, tick_limit, fps, publish_name);
 }
@@ -1,55 +1,69 @@
 #ifndef TETRIS_H
 #define TETRIS_H
 
+#include <time.h>
 #include <raylib.h>
 #include "gamedata.h"
+#include "engine.h"
+#include "bot.h"
+#include "finesse.h"
+#include "frame_export.h"
+#include "netplay.h"
+#include "spectator.h"
+#include "telemetry.h"
+#include "term_render.h"
+#include "versus.h"
 
 // --------------------------------------------------
 // types and constants
 // --------------------------------------------------
 
-typedef enum grid_square {
-    EMPTY,
-    MOVING,
-    BLOCK,
-    FADING,
-    FULL,
-    CUBE_BLOCK,
-    L_BLOCK,
-    J_BLOCK,
-    I_BLOCK,
-    T_BLOCK,
-    S_BLOCK,
-    Z_BLOCK,
-} grid_square_t;
-
 enum {
-    SQUARE_SIZE = 20,
-    GRID_X_SIZE = 12,
-    GRID_Y_SIZE = 21,
-    SCREEN_WIDTH = 442,
+    SQUARE_SIZE = 20, // 가장 큰 칸. 시작 화면도 이 크기로 그림
+    MIN_SQUARE_SIZE = 6,
+    SCREEN_WIDTH = 442, // 시작 화면이 들어가는 최소 창 크기
     SCREEN_HEIGHT = 450,
-    LATERAL_SPEED = 15,
-    TURNING_SPEED = 12,
-    FAST_FALL_AWAIT_COUNTER = 30,
-    FADING_TIME = 33
+    MAX_SCREEN_WIDTH = 1600,
+    MAX_SCREEN_HEIGHT = 900,
+    BASE_FPS = 60,
+    VERSUS_MAX_VISIBLE_BOARDS = 16 // 창에 보여줄 최대 board 수
 };
 
+typedef enum display_mode {
+    DISPLAY_WINDOW,
+    DISPLAY_TERMINAL,
+    DISPLAY_NONE
+} display_mode_t;
+
+// window and square size for one board size. the default board gets 20 px squares in a 442x450 window
+typedef struct layout_t {
+    int square_size;
+    int screen_width;
+    int screen_height;
+    int visible_rows; // 보이는 grid 줄 수, 바닥 포함. 높은 board 는 블록을 따라감
+} layout_t;
+
 static void draw_init_page(void);
 static void check_game_start(game_state_t* game_state);
-static void init_game(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, counter_t* counter);
-static void draw_map(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t hold_piece[4][4], game_state_t* game_state, Color* current_piece_color, Color* incoming_piece_color, Color* hold_piece_color, counter_t* counter);
-static void update_draw_frame(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, counter_t* counter, Color* current_piece_color, Color* incoming_piece_color);
-static void resolve_level(game_state_t* game_state);
-static void save_color(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], const int piece_num);
-static void check_detection(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state);
-static void resolve_falling_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state);
-static bool resolve_lateral_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state);
-static bool resolve_turn_movement(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t piece[4][4], game_state_t* game_state);
-static int delete_complete_lines(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE]);
-static void check_completion(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], game_state_t* game_state);
-static bool create_piece(grid_square_t grid[GRID_Y_SIZE][GRID_X_SIZE], grid_square_t incoming_piece[4][4], grid_square_t piece[4][4], game_state_t* game_state, Color* current_piece_color, Color* incoming_piece_color);
-static int get_random_piece(grid_square_t incoming_piece[4][4]);
+static void init_game(board_t* board, unsigned int seed);
+static layout_t get_layout(int width, int height);
+static void draw_map(const layout_t* layout, board_t boards[], const int visible[], const int visible_count, const finesse_t* finesse);
+static void render_map(const layout_t* layout, board_t boards[], const int visible[], const int visible_count, const finesse_t* finesse);
+static void draw_board(board_t* board, Vector2 offset, const int square_size, const int visible_rows);
+static void draw_preview(grid_square_t preview[4][4], Vector2 offset, const int square_size, Color color);
+static void read_keyboard(input_t* input);
+static void resolve_frame_rate(game_state_t* game_state, int* current_level);
+static void wait_next_frame(struct timespec* next_frame, int fps);
+static int get_target_fps(int level);
+static void get_bot_input_for_board(void* ctx, int board_index, const board_t* board, input_t* input);
+static void free_bots(bot_t bots[], int count);
+static int run_single_player(unsigned int seed, int width, int height, int dig_rows, const char* record_path, const char* metrics_path, const char* publish_name, const char* autosave_path);
+static int run_replay(const char* replay_path, const char* export_path, export_format_t format, int worker_count);
+static int run_headless_replay(const char* replay_path);
+static int run_versus(int board_count, int thread_count, unsigned int seed, int width, int height, display_mode_t display_mode, long tick_limit, int fps, const char* publish_name);
+static int run_netplay(int port, const char* peer, int delay_ms, int loss_percent, bool b_bot, unsigned int seed, int width, int height, display_mode_t display_mode, long tick_limit, int fps);
+static int run_spectator(const char* name, display_mode_t display_mode, int fps);
 static Color get_piece_color(const int num);
+static void print_usage(const char* program);
 
 #endif /* TETRIS_H */
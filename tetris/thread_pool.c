@@ -0,0 +1,161 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+typedef struct worker_arg_t {
+    thread_pool_t* pool;
+    int id;
+} worker_arg_t;
+
+static void run_ranges(thread_pool_t* self, int id);
+static void* worker_main(void* arg);
+
+// --------------------------------------------------
+// thread_pool_t functions
+// --------------------------------------------------
+
+// thread_count - 1 threads are created. the caller of run_thread_pool works as worker 0
+bool init_thread_pool(thread_pool_t* self, int thread_count) {
+    if(thread_count < 1) {
+        thread_count = 1;
+    }
+
+    self->thread_count = thread_count;
+    self->generation = 0;
+    self->busy_workers = 0;
+    self->b_shutdown = false;
+    self->task = NULL;
+    self->ctx = NULL;
+    self->threads = malloc(sizeof(pthread_t) * thread_count);
+    self->ranges = aligned_alloc(CACHE_LINE_SIZE, sizeof(work_range_t) * thread_count);
+    if(self->threads == NULL || self->ranges == NULL) {
+        free(self->threads);
+        free(self->ranges);
+        return false;
+    }
+
+    for(int i = 0; i < thread_count; ++i) {
+        atomic_init(&self->ranges[i].next, 0);
+        self->ranges[i].end = 0;
+    }
+
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->wake, NULL);
+    pthread_cond_init(&self->done, NULL);
+
+    for(int i = 1; i < thread_count; ++i) {
+        worker_arg_t* arg = malloc(sizeof(worker_arg_t));
+        if(arg != NULL) {
+            arg->pool = self;
+            arg->id = i;
+        }
+        if(arg == NULL || pthread_create(&self->threads[i], NULL, worker_main, arg) != 0) {
+            // 시작된 worker 만 join 하고 정리
+            free(arg);
+            self->thread_count = i;
+            free_thread_pool(self);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void free_thread_pool(thread_pool_t* self) {
+    pthread_mutex_lock(&self->lock);
+    self->b_shutdown = true;
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+
+    for(int i = 1; i < self->thread_count; ++i) {
+        pthread_join(self->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&self->lock);
+    pthread_cond_destroy(&self->wake);
+    pthread_cond_destroy(&self->done);
+    free(self->threads);
+    free(self->ranges);
+}
+
+// calls task(ctx, i) for every i in [0, count) and returns when all of them are finished
+void run_thread_pool(thread_pool_t* self, int count, task_fn_t task, void* ctx) {
+    if(self->thread_count == 1 || count <= 1) {
+        for(int i = 0; i < count; ++i) {
+            task(ctx, i);
+        }
+        return;
+    }
+
+    // 각 worker 에게 연속된 구간을 나눠줌
+    for(int i = 0; i < self->thread_count; ++i) {
+        atomic_store_explicit(&self->ranges[i].next, (int)((long)count * i / self->thread_count), memory_order_relaxed);
+        self->ranges[i].end = (int)((long)count * (i + 1) / self->thread_count);
+    }
+
+    pthread_mutex_lock(&self->lock);
+    self->task = task;
+    self->ctx = ctx;
+    self->busy_workers = self->thread_count - 1;
+    ++(self->generation);
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+
+    run_ranges(self, 0);
+
+    pthread_mutex_lock(&self->lock);
+    while(self->busy_workers > 0) {
+        pthread_cond_wait(&self->done, &self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+int get_cpu_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// own range first, then steal from the others in ring order
+static void run_ranges(thread_pool_t* self, int id) {
+    for(int k = 0; k < self->thread_count; ++k) {
+        work_range_t* range = &self->ranges[(id + k) % self->thread_count];
+        int index;
+
+        while((index = atomic_fetch_add_explicit(&range->next, 1, memory_order_relaxed)) < range->end) {
+            self->task(self->ctx, index);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    thread_pool_t* self = ((worker_arg_t*)arg)->pool;
+    const int id = ((worker_arg_t*)arg)->id;
+    unsigned int seen_generation = 0;
+    free(arg);
+
+    for(;;) {
+        pthread_mutex_lock(&self->lock);
+        while(!self->b_shutdown && self->generation == seen_generation) {
+            pthread_cond_wait(&self->wake, &self->lock);
+        }
+        if(self->b_shutdown) {
+            pthread_mutex_unlock(&self->lock);
+            break;
+        }
+        seen_generation = self->generation;
+        pthread_mutex_unlock(&self->lock);
+
+        run_ranges(self, id);
+
+        pthread_mutex_lock(&self->lock);
+        if(--(self->busy_workers) == 0) {
+            pthread_cond_signal(&self->done);
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    return NULL;
+}
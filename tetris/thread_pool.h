@@ -0,0 +1,45 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    CACHE_LINE_SIZE = 64
+};
+
+typedef void (*task_fn_t)(void* ctx, int index);
+
+// [next, end) of one worker. other workers steal from it with the same atomic counter when they run dry
+typedef struct work_range_t {
+    _Alignas(CACHE_LINE_SIZE) atomic_int next;
+    int end;
+} work_range_t;
+
+typedef struct thread_pool_t {
+    pthread_t* threads;
+    work_range_t* ranges;
+    int thread_count; // 호출한 thread 포함
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    unsigned int generation; // run_thread_pool 호출마다 증가
+    int busy_workers;
+    bool b_shutdown;
+    task_fn_t task;
+    void* ctx;
+} thread_pool_t;
+
+// thread_pool_t functions
+
+bool init_thread_pool(thread_pool_t* self, int thread_count);
+void free_thread_pool(thread_pool_t* self);
+void run_thread_pool(thread_pool_t* self, int count, task_fn_t task, void* ctx);
+int get_cpu_count(void);
+
+#endif /* THREAD_POOL_H */
@@ -0,0 +1,530 @@
+// bot tournament. the parent pairs entrants and keeps the ratings, forked workers play the games headless and
+// unthrottled. jobs go down one pipe per worker, results come back on one pipe shared by all of them
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+#include "io.h"
+#include "autoplay.h"
+#include "bot.h"
+#include "thread_pool.h"
+#include "versus.h"
+#include "tournament.h"
+
+static const double GLICKO_INITIAL_RATING = 1500;
+static const double GLICKO_INITIAL_DEVIATION = 350;
+static const double PI = 3.14159265358979323846;
+
+static bool load_entrants(tournament_t* self, const char* path);
+static bool start_workers(tournament_t* self);
+static void stop_workers(tournament_t* self);
+static void worker_main(const tournament_t* self, int worker, int job_fd, int result_fd);
+static double play_tournament_game(const tournament_t* self, const tournament_job_t* job, bot_t bots[2], board_t* board, thread_pool_t* pool, tournament_result_t* result);
+static void get_tournament_input(void* ctx, int board_index, const board_t* board, input_t* input);
+static bool get_next_job(tournament_t* self, tournament_job_t* job, int in_flight);
+static void pair_swiss_round(tournament_t* self);
+static void add_result(tournament_t* self, const tournament_result_t* result);
+static void update_glicko(tournament_entrant_t* self, const tournament_entrant_t* opponent, double score);
+static void print_standings(const tournament_t* self, int count);
+static int compare_rating(const void* a, const void* b);
+static bool wait_result(tournament_t* self, tournament_result_t* result);
+
+// --------------------------------------------------
+// tournament functions
+// --------------------------------------------------
+
+bool parse_tournament_mode(const char* name, tournament_mode_t* mode) {
+    static const char* names[TOURNAMENT_MODE_COUNT] = { "versus", "score" };
+
+    for(int i = 0; i < TOURNAMENT_MODE_COUNT; ++i) {
+        if(strcmp(name, names[i]) == 0) {
+            *mode = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool parse_tournament_pairing(const char* name, tournament_pairing_t* pairing) {
+    static const char* names[TOURNAMENT_PAIRING_COUNT] = { "round-robin", "swiss" };
+
+    for(int i = 0; i < TOURNAMENT_PAIRING_COUNT; ++i) {
+        if(strcmp(name, names[i]) == 0) {
+            *pairing = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ratings are updated in the order results arrive, so they depend a little on scheduling. the games do not
+int run_tournament(const char* entrants_path, tournament_mode_t mode, tournament_pairing_t pairing, int game_count, int worker_count, unsigned int seed, long tick_limit, int width, int height) {
+    tournament_t* self = calloc(1, sizeof(tournament_t));
+    tournament_result_t result;
+    tournament_job_t job;
+    struct timespec begin;
+    struct timespec end;
+    int in_flight = 0;
+    int next_report = 1;
+    bool b_ok = true;
+
+    if(self == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        return 1;
+    }
+    self->mode = mode;
+    self->pairing = pairing;
+    self->tick_limit = tick_limit > 0 ? tick_limit : TOURNAMENT_DEFAULT_TICKS;
+    self->width = width;
+    self->height = height;
+    self->game_count = game_count > 0 ? game_count : TOURNAMENT_DEFAULT_GAMES;
+    self->seed = seed;
+    self->worker_count = worker_count > 0 ? worker_count : 1;
+
+    if(!load_entrants(self, entrants_path)) {
+        free(self->pairs);
+        free(self);
+        return 1;
+    }
+    if(!start_workers(self)) {
+        fprintf(stderr, "tetris: cannot start tournament workers\n");
+        free(self->pairs);
+        free(self);
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    while(self->games_done < self->game_count) {
+        // 모든 worker 가 항상 다음 게임을 갖고 있도록 채움
+        for(int w = 0; w < self->worker_count; ++w) {
+            tournament_worker_t* worker = &self->workers[w];
+            while(worker->outstanding < TOURNAMENT_JOBS_PER_WORKER && get_next_job(self, &job, in_flight)) {
+                if(!write_all(worker->job_fd, &job, sizeof(job))) {
+                    b_ok = false;
+                    break;
+                }
+                ++worker->outstanding;
+                ++in_flight;
+            }
+        }
+        if(!b_ok || in_flight == 0 || !wait_result(self, &result)) {
+            fprintf(stderr, "tetris: a tournament worker stopped\n");
+            b_ok = false;
+            break;
+        }
+
+        --self->workers[result.worker].outstanding;
+        --in_flight;
+        add_result(self, &result);
+
+        if(self->games_done * TOURNAMENT_REPORTS >= next_report * self->game_count) {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            printf("%d/%d games, %.1f s\n", self->games_done, self->game_count, (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9);
+            print_standings(self, 3);
+            fflush(stdout);
+            ++next_report;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    stop_workers(self);
+
+    const double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    printf("%s %s, %d games on %d workers in %.1f s, %.0f games/s\n", self->mode == TOURNAMENT_VERSUS ? "versus" : "score attack",
+        self->pairing == TOURNAMENT_SWISS ? "swiss" : "round robin", self->games_done, self->worker_count, seconds, seconds > 0 ? self->games_done / seconds : 0);
+    print_standings(self, self->entrant_count);
+
+    free(self->pairs);
+    free(self);
+
+    return b_ok ? 0 : 1;
+}
+
+// one entrant per line: name and the weights for height, lines, holes and bumpiness. '#' starts a comment
+static bool load_entrants(tournament_t* self, const char* path) {
+    FILE* file = fopen(path, "r");
+    char line[256];
+    int line_number = 0;
+
+    if(file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    while(fgets(line, sizeof(line), file) != NULL) {
+        char name[TOURNAMENT_NAME_SIZE];
+        bot_weights_t weights;
+        char* comment = strchr(line, '#');
+
+        ++line_number;
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+        if(strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        if(sscanf(line, "%31s %lf %lf %lf %lf", name, &weights.height, &weights.lines, &weights.holes, &weights.bumpiness) != 5) {
+            fprintf(stderr, "%s:%d: expected a name and four weights\n", path, line_number);
+            fclose(file);
+            return false;
+        }
+        if(self->entrant_count == TOURNAMENT_MAX_ENTRANTS) {
+            fprintf(stderr, "%s: more than %d entrants\n", path, TOURNAMENT_MAX_ENTRANTS);
+            fclose(file);
+            return false;
+        }
+
+        tournament_entrant_t* entrant = &self->entrants[self->entrant_count++];
+        snprintf(entrant->name, sizeof(entrant->name), "%s", name);
+        entrant->weights = weights;
+        entrant->rating = GLICKO_INITIAL_RATING;
+        entrant->deviation = GLICKO_INITIAL_DEVIATION;
+        entrant->last_opponent = -1;
+    }
+    fclose(file);
+
+    if(self->entrant_count < 2) {
+        fprintf(stderr, "%s: a tournament needs at least 2 entrants\n", path);
+        return false;
+    }
+
+    self->pair_count = self->entrant_count * (self->entrant_count - 1) / 2;
+    self->pairs = malloc(sizeof(int[2]) * self->pair_count);
+    if(self->pairs == NULL) {
+        fprintf(stderr, "tetris: out of memory\n");
+        return false;
+    }
+    int k = 0;
+    for(int i = 0; i < self->entrant_count; ++i) {
+        for(int j = i + 1; j < self->entrant_count; ++j) {
+            self->pairs[k][0] = i;
+            self->pairs[k][1] = j;
+            ++k;
+        }
+    }
+
+    return true;
+}
+
+// the children keep a copy of the entrants from fork. each closes every pipe end that is not its own
+static bool start_workers(tournament_t* self) {
+    int result_pipe[2];
+
+    self->workers = calloc(self->worker_count, sizeof(tournament_worker_t));
+    if(self->workers == NULL || pipe(result_pipe) != 0) {
+        free(self->workers);
+        return false;
+    }
+    self->result_fd = result_pipe[0];
+
+    for(int w = 0; w < self->worker_count; ++w) {
+        int job_pipe[2];
+
+        if(pipe(job_pipe) != 0) {
+            self->worker_count = w;
+            close(result_pipe[1]);
+            stop_workers(self);
+            return false;
+        }
+
+        const pid_t pid = fork();
+        if(pid == 0) {
+            for(int k = 0; k < w; ++k) {
+                close(self->workers[k].job_fd);
+            }
+            close(job_pipe[1]);
+            close(result_pipe[0]);
+            worker_main(self, w, job_pipe[0], result_pipe[1]);
+            _exit(0);
+        }
+
+        close(job_pipe[0]);
+        self->workers[w].pid = pid;
+        self->workers[w].job_fd = job_pipe[1];
+        self->workers[w].outstanding = 0;
+        if(pid < 0) {
+            close(job_pipe[1]);
+            self->worker_count = w;
+            close(result_pipe[1]);
+            stop_workers(self);
+            return false;
+        }
+    }
+
+    // 죽은 worker 의 pipe 에 쓰면 SIGPIPE 대신 write 가 실패하도록
+    signal(SIGPIPE, SIG_IGN);
+
+    // 부모가 쓰는 쪽을 닫아야 worker 가 모두 끝났을 때 read 가 0 을 돌려줌
+    close(result_pipe[1]);
+
+    return true;
+}
+
+// closing a job pipe is the stop signal, the worker sees end of file and exits
+static void stop_workers(tournament_t* self) {
+    for(int w = 0; w < self->worker_count; ++w) {
+        close(self->workers[w].job_fd);
+    }
+    for(int w = 0; w < self->worker_count; ++w) {
+        waitpid(self->workers[w].pid, NULL, 0);
+    }
+    close(self->result_fd);
+    free(self->workers);
+    self->workers = NULL;
+}
+
+// boards, bots and a one-thread pool are made once per worker and reused for every game
+static void worker_main(const tournament_t* self, int worker, int job_fd, int result_fd) {
+    thread_pool_t pool;
+    board_t board;
+    bot_t bots[2];
+    tournament_job_t job;
+    tournament_result_t result;
+
+    const bool b_pool = init_thread_pool(&pool, 1);
+    const bool b_board = create_board(&board, self->width, self->height);
+    const bool b_first = init_bot(&bots[0], self->width, self->height);
+    const bool b_second = init_bot(&bots[1], self->width, self->height);
+
+    while(b_pool && b_board && b_first && b_second && read_all(job_fd, &job, sizeof(job))) {
+        result.game = job.game;
+        result.worker = worker;
+        result.first = job.first;
+        result.second = job.second;
+        result.score = play_tournament_game(self, &job, bots, &board, &pool, &result);
+        if(!write_all(result_fd, &result, sizeof(result))) {
+            break;
+        }
+    }
+
+    free_bot(&bots[0]);
+    free_bot(&bots[1]);
+    free_board(&board);
+    if(b_pool) {
+        free_thread_pool(&pool);
+    }
+    close(job_fd);
+    close(result_fd);
+}
+
+// returns the first side's score. a game that reaches the tick limit goes to the side with more lines
+static double play_tournament_game(const tournament_t* self, const tournament_job_t* job, bot_t bots[2], board_t* board, thread_pool_t* pool, tournament_result_t* result) {
+    const int sides[2] = { job->first, job->second };
+
+    for(int i = 0; i < 2; ++i) {
+        reset_bot(&bots[i]);
+        bots[i].weights = self->entrants[sides[i]].weights;
+    }
+
+    if(self->mode == TOURNAMENT_SCORE) {
+        play_bot_game(board, &bots[0], job->seed, self->tick_limit, NULL, NULL, NULL);
+        result->first_lines = board->game_state.g_lines;
+        play_bot_game(board, &bots[1], job->seed, self->tick_limit, NULL, NULL, NULL);
+        result->second_lines = board->game_state.g_lines;
+        result->ticks = 0;
+    } else {
+        versus_t versus;
+
+        if(!init_versus(&versus, 2, self->width, self->height, job->seed, pool, get_tournament_input, bots)) {
+            result->first_lines = 0;
+            result->second_lines = 0;
+            result->ticks = 0;
+            return 0.5;
+        }
+        while(!is_versus_over(&versus) && versus.ticks < self->tick_limit) {
+            step_versus(&versus);
+        }
+        result->first_lines = versus.boards[0].game_state.g_lines;
+        result->second_lines = versus.boards[1].game_state.g_lines;
+        result->ticks = versus.ticks;
+
+        const int winner = get_versus_winner(&versus);
+        free_versus(&versus);
+        if(winner >= 0) {
+            return winner == 0 ? 1 : 0;
+        }
+    }
+
+    if(result->first_lines != result->second_lines) {
+        return result->first_lines > result->second_lines ? 1 : 0;
+    }
+
+    return 0.5;
+}
+
+static void get_tournament_input(void* ctx, int board_index, const board_t* board, input_t* input) {
+    bot_t* bots = ctx;
+    get_bot_input(&bots[board_index], board, input);
+}
+
+// round robin plays every pair once per cycle with that cycle's seed, and swaps sides on odd cycles.
+// swiss pairs a new round only when the last one is finished, since it pairs by the standings
+static bool get_next_job(tournament_t* self, tournament_job_t* job, int in_flight) {
+    if(self->games_scheduled >= self->game_count) {
+        return false;
+    }
+
+    if(self->pairing == TOURNAMENT_ROUND_ROBIN) {
+        const int cycle = self->games_scheduled / self->pair_count;
+        const int* pair = self->pairs[self->games_scheduled % self->pair_count];
+
+        job->first = pair[cycle & 1];
+        job->second = pair[!(cycle & 1)];
+        job->seed = self->seed + cycle;
+    } else {
+        if(self->round_sent == self->round_size) {
+            if(in_flight > 0) {
+                return false;
+            }
+            pair_swiss_round(self);
+        }
+        *job = self->round[self->round_sent++];
+    }
+
+    job->game = self->games_scheduled++;
+
+    return true;
+}
+
+// by points, then rating. each takes the best unpaired one below it that it did not just play,
+// with an odd count the last one sits the round out
+static void pair_swiss_round(tournament_t* self) {
+    int order[TOURNAMENT_MAX_ENTRANTS];
+    bool b_paired[TOURNAMENT_MAX_ENTRANTS] = { false };
+    const int count = self->entrant_count;
+
+    for(int i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    for(int i = 1; i < count; ++i) {
+        const int index = order[i];
+        const tournament_entrant_t* entrant = &self->entrants[index];
+        int k = i - 1;
+        while(k >= 0 && (self->entrants[order[k]].points < entrant->points
+            || (self->entrants[order[k]].points == entrant->points && self->entrants[order[k]].rating < entrant->rating))) {
+            order[k + 1] = order[k];
+            --k;
+        }
+        order[k + 1] = index;
+    }
+
+    self->round_size = 0;
+    self->round_sent = 0;
+    for(int i = 0; i < count && self->games_scheduled + self->round_size < self->game_count; ++i) {
+        const int first = order[i];
+        int second = -1;
+
+        if(b_paired[first]) {
+            continue;
+        }
+        for(int k = i + 1; k < count; ++k) {
+            if(!b_paired[order[k]] && (second < 0 || self->entrants[first].last_opponent == second)) {
+                second = order[k];
+                if(self->entrants[first].last_opponent != second) {
+                    break;
+                }
+            }
+        }
+        if(second < 0) {
+            break;
+        }
+
+        b_paired[first] = true;
+        b_paired[second] = true;
+        tournament_job_t* job = &self->round[self->round_size++];
+        job->first = (self->round_number & 1) ? second : first;
+        job->second = (self->round_number & 1) ? first : second;
+        job->seed = self->seed + self->round_number;
+    }
+    ++self->round_number;
+}
+
+static void add_result(tournament_t* self, const tournament_result_t* result) {
+    tournament_entrant_t* first = &self->entrants[result->first];
+    tournament_entrant_t* second = &self->entrants[result->second];
+    const tournament_entrant_t first_before = *first;
+
+    update_glicko(first, second, result->score);
+    update_glicko(second, &first_before, 1 - result->score);
+
+    if(result->score > 0.5) {
+        ++first->wins;
+        ++second->losses;
+    } else if(result->score < 0.5) {
+        ++first->losses;
+        ++second->wins;
+    } else {
+        ++first->draws;
+        ++second->draws;
+    }
+    first->points += result->score;
+    second->points += 1 - result->score;
+    first->last_opponent = result->second;
+    second->last_opponent = result->first;
+    ++self->games_done;
+}
+
+// Glicko with one game per rating period. the bots do not change, so the deviation only shrinks
+static void update_glicko(tournament_entrant_t* self, const tournament_entrant_t* opponent, double score) {
+    const double q = log(10) / 400;
+    const double g = 1 / sqrt(1 + 3 * q * q * opponent->deviation * opponent->deviation / (PI * PI));
+    const double expected = 1 / (1 + pow(10, -g * (self->rating - opponent->rating) / 400));
+    const double d2 = 1 / (q * q * g * g * expected * (1 - expected));
+    const double precision = 1 / (self->deviation * self->deviation) + 1 / d2;
+
+    self->rating += q / precision * g * (score - expected);
+    self->deviation = sqrt(1 / precision);
+}
+
+// the first count entrants by rating, with a 95% interval
+static void print_standings(const tournament_t* self, int count) {
+    tournament_entrant_t sorted[TOURNAMENT_MAX_ENTRANTS];
+
+    memcpy(sorted, self->entrants, sizeof(tournament_entrant_t) * self->entrant_count);
+    qsort(sorted, self->entrant_count, sizeof(tournament_entrant_t), compare_rating);
+
+    for(int i = 0; i < count && i < self->entrant_count; ++i) {
+        const tournament_entrant_t* entrant = &sorted[i];
+        printf("%3d. %-16s %6.0f ± %3.0f  games: %d, +%d =%d -%d\n", i + 1, entrant->name,
+            entrant->rating, 1.96 * entrant->deviation, entrant->wins + entrant->draws + entrant->losses, entrant->wins, entrant->draws, entrant->losses);
+    }
+}
+
+static int compare_rating(const void* a, const void* b) {
+    const double x = ((const tournament_entrant_t*)a)->rating;
+    const double y = ((const tournament_entrant_t*)b)->rating;
+    return (x < y) - (x > y);
+}
+
+// the other workers keep the result pipe open, so a worker that died is noticed by waitpid and not by end of file
+static bool wait_result(tournament_t* self, tournament_result_t* result) {
+    struct pollfd poll_fd = { self->result_fd, POLLIN, 0 };
+
+    for(;;) {
+        const int ready = poll(&poll_fd, 1, TOURNAMENT_POLL_MS);
+        if(ready < 0 && errno != EINTR) {
+            return false;
+        }
+        if(ready > 0) {
+            return read_all(self->result_fd, result, sizeof(tournament_result_t));
+        }
+
+        for(int w = 0; w < self->worker_count; ++w) {
+            if(waitpid(self->workers[w].pid, NULL, WNOHANG) != 0) {
+                return false;
+            }
+        }
+    }
+}
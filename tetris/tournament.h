@@ -0,0 +1,104 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "engine.h"
+#include "bot.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    TOURNAMENT_MAX_ENTRANTS = 256,
+    TOURNAMENT_NAME_SIZE = 32,
+    TOURNAMENT_DEFAULT_GAMES = 1000,
+    TOURNAMENT_DEFAULT_TICKS = 20000, // --ticks 가 없을 때 한 게임의 최대 tick. 끝나지 않으면 줄 수로 판정
+    TOURNAMENT_JOBS_PER_WORKER = 2, // worker 가 결과를 보내는 동안에도 다음 게임이 pipe 에 있음
+    TOURNAMENT_REPORTS = 10, // 진행 중 순위표를 찍는 횟수
+    TOURNAMENT_POLL_MS = 500 // 결과를 기다리다 worker 가 살아있는지 확인하는 간격
+};
+
+typedef enum tournament_mode {
+    TOURNAMENT_VERSUS, // 두 board 가 garbage 를 주고받음, 먼저 죽으면 패
+    TOURNAMENT_SCORE, // 같은 seed 로 따로 두고 줄 수를 비교
+    TOURNAMENT_MODE_COUNT
+} tournament_mode_t;
+
+typedef enum tournament_pairing {
+    TOURNAMENT_ROUND_ROBIN,
+    TOURNAMENT_SWISS,
+    TOURNAMENT_PAIRING_COUNT
+} tournament_pairing_t;
+
+// one line of the entrants file: a name and the four weights of the static evaluation
+typedef struct tournament_entrant_t {
+    char name[TOURNAMENT_NAME_SIZE];
+    bot_weights_t weights;
+    double rating; // Glicko
+    double deviation; // rating 의 표준편차. 95% 구간은 rating ± 1.96 * deviation
+    int wins;
+    int draws;
+    int losses;
+    double points; // 승 1, 무 0.5. swiss 짝짓기에 사용
+    int last_opponent; // swiss 에서 바로 재대결을 피하기 위해 사용
+} tournament_entrant_t;
+
+// parent to worker. both sides get the same piece seed; side decides which board each bot plays in versus
+typedef struct tournament_job_t {
+    int game;
+    int first;
+    int second;
+    unsigned int seed;
+} tournament_job_t;
+
+// worker to parent, small enough that a write to the shared pipe is atomic
+typedef struct tournament_result_t {
+    int game;
+    int worker;
+    int first;
+    int second;
+    int first_lines;
+    int second_lines;
+    long ticks;
+    double score; // first 의 점수: 승 1, 무 0.5, 패 0
+} tournament_result_t;
+
+typedef struct tournament_worker_t {
+    pid_t pid;
+    int job_fd; // parent 가 job 을 쓰는 쪽
+    int outstanding; // 보냈지만 결과가 오지 않은 job 수
+} tournament_worker_t;
+
+// the parent: entrants, pairing state and one pipe per worker. all results come back on one shared pipe
+typedef struct tournament_t {
+    tournament_entrant_t entrants[TOURNAMENT_MAX_ENTRANTS];
+    int entrant_count;
+    tournament_mode_t mode;
+    tournament_pairing_t pairing;
+    long tick_limit;
+    int width;
+    int height;
+    int game_count;
+    int games_scheduled;
+    int games_done;
+    unsigned int seed;
+    int (*pairs)[2]; // round robin: 모든 짝, 한 바퀴마다 같은 seed
+    int pair_count;
+    tournament_job_t round[TOURNAMENT_MAX_ENTRANTS / 2]; // swiss: 지금 round 의 게임
+    int round_size;
+    int round_sent;
+    int round_number;
+    tournament_worker_t* workers;
+    int worker_count;
+    int result_fd;
+} tournament_t;
+
+// tournament functions
+
+bool parse_tournament_mode(const char* name, tournament_mode_t* mode);
+bool parse_tournament_pairing(const char* name, tournament_pairing_t* pairing);
+int run_tournament(const char* entrants_path, tournament_mode_t mode, tournament_pairing_t pairing, int game_count, int worker_count, unsigned int seed, long tick_limit, int width, int height);
+
+#endif /* TOURNAMENT_H */
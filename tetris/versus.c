@@ -0,0 +1,208 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "thread_pool.h"
+#include "versus.h"
+
+static void step_one_board(void* ctx, int index);
+static void exchange_garbage(versus_t* self);
+static int pick_target(versus_t* self, int sender);
+
+// --------------------------------------------------
+// versus_t functions
+// --------------------------------------------------
+
+// every board gets the same piece seed, so the match is decided by play and not by luck
+bool init_versus(versus_t* self, int board_count, int width, int height, unsigned int seed, thread_pool_t* pool, input_fn_t input_fn, void* input_ctx) {
+    // calloc 이라 만들지 못한 board 도 free_versus 로 정리됨
+    self->boards = calloc(board_count, sizeof(board_t));
+    self->lines_before = malloc(sizeof(int) * board_count);
+    self->placement = malloc(sizeof(int) * board_count);
+    self->board_count = board_count;
+    if(self->boards == NULL || self->lines_before == NULL || self->placement == NULL) {
+        free_versus(self);
+        return false;
+    }
+
+    for(int i = 0; i < board_count; ++i) {
+        if(!create_board(&self->boards[i], width, height)) {
+            free_versus(self);
+            return false;
+        }
+    }
+
+    self->input_fn = input_fn;
+    self->input_ctx = input_ctx;
+    self->pool = pool;
+    reset_versus(self, seed);
+
+    return true;
+}
+
+// a new match on the same boards
+void reset_versus(versus_t* self, unsigned int seed) {
+    for(int i = 0; i < self->board_count; ++i) {
+        init_board(&self->boards[i], seed);
+        self->boards[i].garbage_rng_state ^= (unsigned int)(i + 1) * 0x27d4eb2fu;
+        set_begin_game(&self->boards[i].game_state, true);
+        self->placement[i] = 0;
+    }
+
+    self->alive_count = self->board_count;
+    self->rng_state = seed * 0x2545f491u ^ 0x6a09e667u;
+    if(self->rng_state == 0) {
+        self->rng_state = 0x6a09e667u;
+    }
+    self->ticks = 0;
+}
+
+void free_versus(versus_t* self) {
+    for(int i = 0; self->boards != NULL && i < self->board_count; ++i) {
+        free_board(&self->boards[i]);
+    }
+    free(self->boards);
+    free(self->lines_before);
+    free(self->placement);
+    self->boards = NULL;
+    self->lines_before = NULL;
+    self->placement = NULL;
+}
+
+// the match state only, self keeps its pool and input function. both sides need the same board size, false when the
+// board counts differ and nothing is copied
+bool copy_versus(versus_t* self, const versus_t* other) {
+    if(self->board_count != other->board_count) {
+        return false;
+    }
+
+    for(int i = 0; i < self->board_count; ++i) {
+        copy_board(&self->boards[i], &other->boards[i]);
+    }
+    memcpy(self->placement, other->placement, sizeof(int) * self->board_count);
+    self->alive_count = other->alive_count;
+    self->rng_state = other->rng_state;
+    self->ticks = other->ticks;
+
+    return true;
+}
+
+// boards are independent inside a tick, so they run in parallel. garbage is exchanged afterwards in board order
+void step_versus(versus_t* self) {
+    for(int i = 0; i < self->board_count; ++i) {
+        self->lines_before[i] = self->boards[i].game_state.g_lines;
+    }
+
+    run_thread_pool(self->pool, self->board_count, step_one_board, self);
+    exchange_garbage(self);
+    ++(self->ticks);
+}
+
+bool is_versus_over(const versus_t* self) {
+    return self->alive_count <= 1;
+}
+
+// index of the last board standing, -1 while the match is running
+int get_versus_winner(const versus_t* self) {
+    if(self->alive_count > 1) {
+        return -1;
+    }
+
+    for(int i = 0; i < self->board_count; ++i) {
+        if(self->placement[i] == 0 || self->placement[i] == 1) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// 1 줄 = 0, 2 줄 = 1, 3 줄 = 2, tetris = 4
+int get_garbage_lines(int cleared_lines) {
+    switch(cleared_lines) {
+        case 0:
+        case 1:
+            return 0;
+        case 2:
+            return 1;
+        case 3:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+static void step_one_board(void* ctx, int index) {
+    versus_t* self = ctx;
+    board_t* board = &self->boards[index];
+    input_t input = { 0, 0 };
+
+    if(board->game_state.b_game_over) {
+        return;
+    }
+
+    self->input_fn(self->input_ctx, index, board, &input);
+    step_board(board, input);
+}
+
+// runs on one thread after every board has moved, so the result does not depend on scheduling
+static void exchange_garbage(versus_t* self) {
+    for(int i = 0; i < self->board_count; ++i) {
+        board_t* board = &self->boards[i];
+
+        if(self->placement[i] != 0) {
+            continue;
+        }
+
+        if(board->game_state.b_game_over) {
+            self->placement[i] = self->alive_count;
+            --(self->alive_count);
+            continue;
+        }
+
+        int attack = get_garbage_lines(board->game_state.g_lines - self->lines_before[i]);
+        if(attack == 0) {
+            continue;
+        }
+
+        // 받을 예정인 garbage 를 먼저 상쇄
+        if(board->pending_garbage >= attack) {
+            board->pending_garbage -= attack;
+            continue;
+        }
+        attack -= board->pending_garbage;
+        board->pending_garbage = 0;
+
+        const int target = pick_target(self, i);
+        if(target >= 0) {
+            add_garbage(&self->boards[target], attack);
+        }
+    }
+
+    if(self->alive_count == 1) {
+        for(int i = 0; i < self->board_count; ++i) {
+            if(self->placement[i] == 0) {
+                self->placement[i] = 1;
+            }
+        }
+    }
+}
+
+// random opponent that is still alive
+static int pick_target(versus_t* self, int sender) {
+    if(self->alive_count <= 1) {
+        return -1;
+    }
+
+    int nth = next_random_value(&self->rng_state, 0, self->alive_count - 2);
+    for(int i = 0; i < self->board_count; ++i) {
+        if(i == sender || self->placement[i] != 0) {
+            continue;
+        }
+        if(nth-- == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
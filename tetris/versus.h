@@ -0,0 +1,44 @@
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include <stdbool.h>
+#include "engine.h"
+#include "thread_pool.h"
+
+// --------------------------------------------------
+// types and constants
+// --------------------------------------------------
+
+enum {
+    VERSUS_MIN_BOARDS = 2,
+    VERSUS_MAX_BOARDS = 1024
+};
+
+// keys for one board for the next tick. called from worker threads, one board per call
+typedef void (*input_fn_t)(void* ctx, int board_index, const board_t* board, input_t* input);
+
+typedef struct versus_t {
+    board_t* boards;
+    int* lines_before; // tick 시작 시점의 g_lines
+    int* placement; // 탈락 순위. 0 이면 아직 살아있음
+    int board_count;
+    int alive_count;
+    unsigned int rng_state; // garbage 받을 상대 선택
+    long ticks;
+    input_fn_t input_fn;
+    void* input_ctx;
+    thread_pool_t* pool;
+} versus_t;
+
+// versus_t functions
+
+bool init_versus(versus_t* self, int board_count, int width, int height, unsigned int seed, thread_pool_t* pool, input_fn_t input_fn, void* input_ctx);
+void free_versus(versus_t* self);
+void reset_versus(versus_t* self, unsigned int seed);
+bool copy_versus(versus_t* self, const versus_t* other);
+void step_versus(versus_t* self);
+bool is_versus_over(const versus_t* self);
+int get_versus_winner(const versus_t* self);
+int get_garbage_lines(int cleared_lines);
+
+#endif /* VERSUS_H */